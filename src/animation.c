@@ -0,0 +1,131 @@
+#include "animation.h"
+
+#include <assert.h>
+
+extern AnimationSystem *CreateAnimationSystem(int capacity) {
+    assert(capacity > 0);
+
+    AnimationSystem *system = malloc(sizeof(AnimationSystem));
+    system->count = 0;
+    system->capacity = capacity;
+    // Never reallocated, so pointers stored in GameNode components stay valid
+    system->animators = malloc(sizeof(AnimationComponent) * capacity);
+
+    return system;
+}
+
+extern AnimationComponent *AttachAnimationComponent(AnimationSystem *system, GameNode *node) {
+    assert(GetGameNodeComponent(node, AnimationComponent) == NULL);
+
+    SpriteComponent *sprite = GetGameNodeComponent(node, SpriteComponent);
+    assert(sprite != NULL);
+
+    if (system->count >= system->capacity) {
+        return NULL;
+    }
+
+    AnimationComponent *animator = &system->animators[system->count++];
+    animator->node = node;
+    animator->sprite = sprite;
+    animator->clip = NULL;
+    animator->time = 0.0f;
+    animator->speed = 1.0f;
+    animator->frame = 0;
+    animator->isPlaying = 0;
+
+    SetGameNodeComponent(node, AnimationComponent, animator);
+
+    return animator;
+}
+
+extern void DetachAnimationComponent(AnimationSystem *system, GameNode *node) {
+    AnimationComponent *animator = GetGameNodeComponent(node, AnimationComponent);
+    if (animator == NULL) {
+        return;
+    }
+
+    assert(animator >= system->animators && animator < system->animators + system->count);
+
+    // Keep the array packed by moving the last animator into the hole
+    AnimationComponent *last = &system->animators[--system->count];
+    if (animator != last) {
+        *animator = *last;
+        SetGameNodeComponent(animator->node, AnimationComponent, animator);
+    }
+
+    SetGameNodeComponent(node, AnimationComponent, NULL);
+}
+
+extern void PlayAnimationClip(AnimationComponent *animator, const AnimationClip *clip) {
+    assert(clip->frameCount > 0 && clip->frameDuration > 0.0f);
+
+    animator->clip = clip;
+    animator->time = 0.0f;
+    animator->frame = 0;
+    animator->isPlaying = 1;
+    animator->sprite->region = clip->frames[0];
+    if (animator->node->isStatic) {
+        MarkGameNodeChanged(animator->node);
+    }
+}
+
+// Return time in [0, period), also when it went negative by playing backward
+static F WrapAnimationTime(F time, F period) {
+    time = fmodf(time, period);
+    if (time < 0.0f) {
+        time += period;
+    }
+    return time;
+}
+
+extern void UpdateAnimationSystem(AnimationSystem *system, F delta) {
+    for (int i = 0; i < system->count; ++i) {
+        AnimationComponent *animator = &system->animators[i];
+        if (!animator->isPlaying) {
+            continue;
+        }
+
+        const AnimationClip *clip = animator->clip;
+        int frameCount = clip->frameCount;
+
+        animator->time += delta * animator->speed;
+
+        int frame = 0;
+        switch (clip->loopMode) {
+            case ANIMATION_LOOP_MODE_ONCE: {
+                int step = (int) (animator->time / clip->frameDuration);
+                if (step >= frameCount - 1) {
+                    frame = frameCount - 1;
+                    animator->isPlaying = 0;
+                } else if (animator->time <= 0.0f) {
+                    animator->time = 0.0f;
+                    animator->isPlaying = 0;
+                } else {
+                    frame = step;
+                }
+            } break;
+            case ANIMATION_LOOP_MODE_LOOP: {
+                // Wrap time so it doesn't lose precision on long running animations
+                animator->time = WrapAnimationTime(animator->time, clip->frameDuration * frameCount);
+                frame = (int) (animator->time / clip->frameDuration) % frameCount;
+            } break;
+            case ANIMATION_LOOP_MODE_PING_PONG: {
+                int stepCount = frameCount > 1 ? 2 * (frameCount - 1) : 1;
+                animator->time = WrapAnimationTime(animator->time, clip->frameDuration * stepCount);
+                frame = (int) (animator->time / clip->frameDuration) % stepCount;
+                if (frame >= frameCount) {
+                    frame = stepCount - frame;
+                }
+            } break;
+        }
+
+        if (frame != animator->frame) {
+            animator->frame = frame;
+            animator->sprite->region = clip->frames[frame];
+            // Rebuilds the static batch of the node
+            if (animator->node->isStatic) {
+                MarkGameNodeChanged(animator->node);
+            }
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef RTD_ANIMATION_H
+#define RTD_ANIMATION_H
+
+#include "cgmath.h"
+#include "game_node.h"
+
+typedef enum AnimationLoopMode {
+    ANIMATION_LOOP_MODE_ONCE,
+    ANIMATION_LOOP_MODE_LOOP,
+    ANIMATION_LOOP_MODE_PING_PONG,
+} AnimationLoopMode;
+
+// A sequence of regions over one atlas texture
+typedef struct AnimationClip {
+    const char *name;
+    // Regions in the same normalized space as SpriteComponent::region
+    const BBox2 *frames;
+    int frameCount;
+    // Seconds per frame
+    F frameDuration;
+    AnimationLoopMode loopMode;
+} AnimationClip;
+
+typedef struct AnimationComponent {
+    GameNode *node;
+    SpriteComponent *sprite;
+    const AnimationClip *clip;
+    F time;
+    // Multiplies delta, negative plays backward. A ONCE clip played backward stops at its first frame.
+    F speed;
+    int frame;
+    int isPlaying;
+} AnimationComponent;
+
+// Owns all AnimationComponents in a packed array, so they are advanced in one pass
+typedef struct AnimationSystem {
+    int count;
+    int capacity;
+    AnimationComponent *animators;
+} AnimationSystem;
+
+extern AnimationSystem *CreateAnimationSystem(int capacity);
+// The node must have a SpriteComponent. Return NULL if the system is full.
+extern AnimationComponent *AttachAnimationComponent(AnimationSystem *system, GameNode *node);
+extern void DetachAnimationComponent(AnimationSystem *system, GameNode *node);
+extern void PlayAnimationClip(AnimationComponent *animator, const AnimationClip *clip);
+// Advance all playing animators and write the region of current frame into their SpriteComponent
+extern void UpdateAnimationSystem(AnimationSystem *system, F delta);
+
+#endif // RTD_ANIMATION_H
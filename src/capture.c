@@ -0,0 +1,166 @@
+#include "capture.h"
+
+#include <string.h>
+
+#include "image.h"
+
+static void WriteCapturedFrame(FrameCapture *capture, const CapturedFrame *frame) {
+    if (capture->format == CAPTURE_FORMAT_RAW) {
+        fwrite(frame->pixels, 1, (size_t) frame->width * frame->height * 4, capture->rawFile);
+    } else {
+        char filename[300];
+        snprintf(filename, sizeof(filename), "%s_%05d.png", capture->path, frame->index);
+        SaveImageToPNG(filename, frame->width, frame->height, frame->width * 4, frame->pixels);
+    }
+
+    SDL_AtomicAdd(&capture->writtenFrameCount, 1);
+}
+
+static int RunCaptureEncoder(void *data) {
+    FrameCapture *capture = data;
+
+    for (;;) {
+        SDL_SemWait(capture->frameSem);
+
+        SDL_LockMutex(capture->mutex);
+        int queuedFrameCount = capture->queuedFrameCount;
+        int isStopping = capture->isStopping;
+        CapturedFrame *frame = &capture->frames[capture->firstFrame];
+        SDL_UnlockMutex(capture->mutex);
+
+        // Queued frames are written before stopping
+        if (queuedFrameCount == 0) {
+            if (isStopping) {
+                break;
+            }
+            continue;
+        }
+
+        WriteCapturedFrame(capture, frame);
+
+        SDL_LockMutex(capture->mutex);
+        capture->firstFrame = (capture->firstFrame + 1) % CAPTURE_QUEUE_FRAMES;
+        capture->queuedFrameCount--;
+        SDL_UnlockMutex(capture->mutex);
+    }
+
+    return 0;
+}
+
+extern FrameCapture *StartFrameCapture(RenderContext *rc, const char *path, CaptureFormat format) {
+    FrameReadback *readback = CreateFrameReadback(rc, CAPTURE_READBACK_FRAMES);
+    if (readback == NULL) {
+        return NULL;
+    }
+
+    FrameCapture *capture = malloc(sizeof(FrameCapture));
+    memset(capture, 0, sizeof(FrameCapture));
+    capture->format = format;
+    snprintf(capture->path, sizeof(capture->path), "%s", path);
+    capture->readback = readback;
+
+    if (format == CAPTURE_FORMAT_RAW) {
+        capture->rawFile = fopen(path, "wb");
+        if (capture->rawFile == NULL) {
+            printf("Failed to open capture file %s\n", path);
+            DestroyFrameReadback(rc, &capture->readback);
+            free(capture);
+            return NULL;
+        }
+    }
+
+    capture->mutex = SDL_CreateMutex();
+    capture->frameSem = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&capture->writtenFrameCount, 0);
+    capture->thread = SDL_CreateThread(RunCaptureEncoder, "FrameCapture", capture);
+    if (capture->thread == NULL) {
+        printf("Failed to create frame capture thread: %s\n", SDL_GetError());
+    }
+
+    return capture;
+}
+
+// Move the copies the GPU is done with into the encoder queue
+static void CollectCapturedFrames(RenderContext *rc, FrameCapture *capture) {
+    int width;
+    int height;
+    while (PeekFrameReadbackSize(rc, capture->readback, &width, &height)) {
+        SDL_LockMutex(capture->mutex);
+        int queuedFrameCount = capture->queuedFrameCount;
+        int nextFrame = (capture->firstFrame + queuedFrameCount) % CAPTURE_QUEUE_FRAMES;
+        SDL_UnlockMutex(capture->mutex);
+
+        int index = capture->readbackFrameCount++;
+
+        // The encoder fell behind, free the readback buffer anyway
+        if (queuedFrameCount >= CAPTURE_QUEUE_FRAMES || capture->thread == NULL) {
+            PollFrameReadback(rc, capture->readback, NULL);
+            capture->droppedEncoderCount++;
+            continue;
+        }
+
+        // Frames past the end of the queue are not touched by the encoder
+        CapturedFrame *frame = &capture->frames[nextFrame];
+        size_t pixelsSize = (size_t) width * height * 4;
+        if (pixelsSize > frame->pixelsSize) {
+            frame->pixels = realloc(frame->pixels, pixelsSize);
+            frame->pixelsSize = pixelsSize;
+        }
+        frame->index = index;
+        frame->width = width;
+        frame->height = height;
+        PollFrameReadback(rc, capture->readback, frame->pixels);
+
+        SDL_LockMutex(capture->mutex);
+        capture->queuedFrameCount++;
+        SDL_UnlockMutex(capture->mutex);
+        SDL_SemPost(capture->frameSem);
+    }
+}
+
+extern void CaptureFrame(RenderContext *rc, FrameCapture *capture) {
+    // Collect first, so this frame finds a free readback buffer if the GPU kept up
+    CollectCapturedFrames(rc, capture);
+
+    if (!QueueFrameReadback(rc, capture->readback)) {
+        capture->droppedReadbackCount++;
+    }
+}
+
+extern void StopFrameCapture(RenderContext *rc, FrameCapture **ptr) {
+    FrameCapture *capture = *ptr;
+
+    while (capture->readback->pendingCount > 0) {
+        CollectCapturedFrames(rc, capture);
+        if (capture->readback->pendingCount > 0) {
+            SDL_Delay(1);
+        }
+    }
+
+    if (capture->thread) {
+        SDL_LockMutex(capture->mutex);
+        capture->isStopping = 1;
+        SDL_UnlockMutex(capture->mutex);
+        SDL_SemPost(capture->frameSem);
+        SDL_WaitThread(capture->thread, NULL);
+    }
+
+    printf("Captured %d frames to %s, %d dropped waiting for the GPU, %d dropped waiting for the encoder\n",
+           SDL_AtomicGet(&capture->writtenFrameCount), capture->path, capture->droppedReadbackCount,
+           capture->droppedEncoderCount);
+    if (capture->rawFile) {
+        // Every frame has the size of the window
+        printf("Raw frames are RGBA of %dx%d pixels\n", capture->frames[0].width, capture->frames[0].height);
+        fclose(capture->rawFile);
+    }
+
+    for (int i = 0; i < CAPTURE_QUEUE_FRAMES; ++i) {
+        free(capture->frames[i].pixels);
+    }
+    DestroyFrameReadback(rc, &capture->readback);
+    SDL_DestroySemaphore(capture->frameSem);
+    SDL_DestroyMutex(capture->mutex);
+    free(capture);
+
+    *ptr = NULL;
+}
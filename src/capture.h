@@ -0,0 +1,64 @@
+#ifndef RTD_CAPTURE_H
+#define RTD_CAPTURE_H
+
+#include <stdio.h>
+
+#include <SDL2/SDL.h>
+
+#include "renderer.h"
+
+// Frames in flight on the GPU
+#define CAPTURE_READBACK_FRAMES 3
+// Frames read back and waiting for the encoder
+#define CAPTURE_QUEUE_FRAMES 4
+
+typedef enum CaptureFormat {
+    // One file per frame, <path>_<frame>.png
+    CAPTURE_FORMAT_PNG,
+    // RGBA frames, top row first, appended to path
+    CAPTURE_FORMAT_RAW,
+} CaptureFormat;
+
+typedef struct CapturedFrame {
+    int index;
+    int width;
+    int height;
+    unsigned char *pixels;
+    size_t pixelsSize;
+} CapturedFrame;
+
+// Records the window frame by frame. Frames are read back asynchronously and written by a thread of their own, so
+// capturing never waits for the GPU or the disk. Frames are dropped instead when either one falls behind.
+typedef struct FrameCapture {
+    CaptureFormat format;
+    char path[256];
+    FrameReadback *readback;
+    FILE *rawFile;
+
+    // Ring of frames waiting for the encoder, firstFrame and queuedFrameCount are guarded by mutex
+    CapturedFrame frames[CAPTURE_QUEUE_FRAMES];
+    int firstFrame;
+    int queuedFrameCount;
+    int isStopping;
+    SDL_mutex *mutex;
+    // Posted once per queued frame and once to stop
+    SDL_sem *frameSem;
+    SDL_Thread *thread;
+
+    // Frames read back so far, including the ones dropped for the encoder
+    int readbackFrameCount;
+    SDL_atomic_t writtenFrameCount;
+    // Frames not read back because every readback buffer was still pending
+    int droppedReadbackCount;
+    // Frames read back but not written because the encoder queue was full
+    int droppedEncoderCount;
+} FrameCapture;
+
+// NULL if capturing is not supported by rc, or the file cannot be opened
+extern FrameCapture *StartFrameCapture(RenderContext *rc, const char *path, CaptureFormat format);
+// Collect the frames still in flight and wait for the encoder to write them
+extern void StopFrameCapture(RenderContext *rc, FrameCapture **capture);
+// Capture the window, after EndDrawing and before the buffers are swapped
+extern void CaptureFrame(RenderContext *rc, FrameCapture *capture);
+
+#endif // RTD_CAPTURE_H
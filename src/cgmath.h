@@ -270,6 +270,12 @@ static inline V2 GetBBox2Size(BBox2 bbox) {
     return SubV2(bbox.max, bbox.min);
 }
 
+static inline int IsBBox2Overlapped(BBox2 a, BBox2 b) {
+    int result = a.min.x < b.max.x && a.max.x > b.min.x &&
+                 a.min.y < b.max.y && a.max.y > b.min.y;
+    return result;
+}
+
 //
 // 2D Linear System
 //
@@ -416,6 +422,21 @@ static inline T2 TranslateT2(V2 offset, T2 t) {
     return result;
 }
 
+// Return the axis aligned bounding box of the transformed bbox
+static inline BBox2 TransformBBox2(T2 t, BBox2 bbox) {
+    V2 p0 = ApplyT2(t, bbox.min);
+    V2 p1 = ApplyT2(t, MakeV2(bbox.max.x, bbox.min.y));
+    V2 p2 = ApplyT2(t, bbox.max);
+    V2 p3 = ApplyT2(t, MakeV2(bbox.min.x, bbox.max.y));
+
+    BBox2 result;
+    result.min.x = fminf(fminf(p0.x, p1.x), fminf(p2.x, p3.x));
+    result.min.y = fminf(fminf(p0.y, p1.y), fminf(p2.y, p3.y));
+    result.max.x = fmaxf(fmaxf(p0.x, p1.x), fmaxf(p2.x, p3.x));
+    result.max.y = fmaxf(fmaxf(p0.y, p1.y), fmaxf(p2.y, p3.y));
+    return result;
+}
+
 static inline V2 GetT2Scale(T2 t) {
     V2 result = MakeV2(GetV2Len(t.xAxis), GetV2Len(t.yAxis));
     return result;
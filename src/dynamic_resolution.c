@@ -0,0 +1,49 @@
+#include "dynamic_resolution.h"
+
+#include <assert.h>
+
+#include "cgmath.h"
+
+extern void InitDynamicResolution(DynamicResolution *dr, float minScale, float maxScale, float budget) {
+    assert(minScale > 0.0f && minScale <= maxScale);
+
+    dr->minScale = minScale;
+    dr->maxScale = maxScale;
+    dr->step = 0.1f;
+    dr->budget = budget;
+    dr->downThreshold = 0.95f;
+    dr->upThreshold = 0.75f;
+    dr->downFrames = 10;
+    dr->upFrames = 60;
+
+    dr->scale = maxScale;
+    dr->smoothedCost = 0.0f;
+    dr->overBudgetCounter = 0;
+    dr->underBudgetCounter = 0;
+}
+
+extern float UpdateDynamicResolution(DynamicResolution *dr, float cost) {
+    // Exponential moving average filters out single frame spikes
+    dr->smoothedCost = LerpF(dr->smoothedCost, 0.1f, cost);
+
+    if (dr->smoothedCost > dr->budget * dr->downThreshold) {
+        dr->overBudgetCounter++;
+        dr->underBudgetCounter = 0;
+    } else if (dr->smoothedCost < dr->budget * dr->upThreshold) {
+        dr->underBudgetCounter++;
+        dr->overBudgetCounter = 0;
+    } else {
+        dr->overBudgetCounter = 0;
+        dr->underBudgetCounter = 0;
+    }
+
+    if (dr->overBudgetCounter >= dr->downFrames) {
+        dr->scale = ClampF(dr->scale - dr->step, dr->minScale, dr->maxScale);
+        dr->overBudgetCounter = 0;
+    } else if (dr->underBudgetCounter >= dr->upFrames) {
+        dr->scale = ClampF(dr->scale + dr->step, dr->minScale, dr->maxScale);
+        dr->underBudgetCounter = 0;
+    }
+
+    return dr->scale;
+}
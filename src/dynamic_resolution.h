@@ -0,0 +1,29 @@
+#ifndef RTD_DYNAMIC_RESOLUTION_H
+#define RTD_DYNAMIC_RESOLUTION_H
+
+// Adjust the render scale of a pass between minScale and maxScale to keep frame cost within budget
+typedef struct DynamicResolution {
+    float minScale;
+    float maxScale;
+    // Change of scale per adjustment
+    float step;
+    // Target frame cost in seconds
+    float budget;
+    // Scale down when the smoothed cost is above budget * downThreshold, scale up when below budget * upThreshold
+    float downThreshold;
+    float upThreshold;
+    // Consecutive frames the condition must hold before adjusting. Scaling up waits longer to avoid oscillation.
+    int downFrames;
+    int upFrames;
+
+    float scale;
+    float smoothedCost;
+    int overBudgetCounter;
+    int underBudgetCounter;
+} DynamicResolution;
+
+extern void InitDynamicResolution(DynamicResolution *dr, float minScale, float maxScale, float budget);
+// cost is the measured cost in seconds of the last frame. Return the new scale.
+extern float UpdateDynamicResolution(DynamicResolution *dr, float cost);
+
+#endif // RTD_DYNAMIC_RESOLUTION_H
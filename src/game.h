@@ -1,24 +1,111 @@
 #ifndef RTD_GAME_H
 #define RTD_GAME_H
 
+#include <stdio.h>
+
 #include "window.h"
 #include "renderer.h"
 #include "time.h"
 #include "cgmath.h"
 #include "game_node.h"
+#include "tilemap.h"
+#include "particle.h"
+#include "parallax.h"
+#include "animation.h"
+#include "light.h"
+#include "post_process.h"
+#include "capture.h"
+#include "render_graph.h"
+#include "dynamic_resolution.h"
+#include "render_on_demand.h"
+#include "static_batch.h"
 #include "game_context.h"
 
+// Counters of the last frame shown in the HUD, saved before ClearDrawing resets them
+typedef struct LastFrameStats {
+    int drawCallCount;
+    int spriteCount;
+    int spriteUploadBytes;
+    float spriteUploadMs;
+    float spriteTrimmedPixels;
+    int pathTessellationCount;
+    int lightCount;
+    int shadowedLightCount;
+    int clipFlushCount;
+} LastFrameStats;
+
+// Render graph pass of a post effect, reading the result of the effect before it
+typedef struct PostEffectPass {
+    PostProcessChain *chain;
+    const PostEffect *effect;
+    RenderGraphResource source;
+    RenderGraphResource target;
+} PostEffectPass;
+
 struct GameContext {
     Window *window;
     RenderContext *rc;
     FPSCounter fpsCounter;
     int isRunning;
 
+    // CPU time in seconds spent by the last Update and Render
+    float updateCost;
+    float renderCost;
+    // One JSON object per line with the timings of every frame, NULL if disabled
+    FILE *timingsDumpFile;
+
     GameNodeTreeWalker gameNodeTreeWalker;
+    // Lines of the node hierarchy scrolled out of the top of its HUD panel by the mouse wheel
+    int hierarchyScroll;
+    AnimationSystem *animationSystem;
 
     Font *font;
 
+    // The world pass is rendered at native game resolution in virtual resolution mode, otherwise at a scale of the
+    // window chosen by dynamicResolution
+    int isVirtualResolution;
+    DynamicResolution dynamicResolution;
+
+    // Passes of the frame, declared again by every Render. F9 dumps the compiled graph.
+    RenderGraph *renderGraph;
+    RenderGraphResource lightResource;
+    RenderGraphResource worldResource;
+    // Each active post effect writes a transient resource of the world size, sharing targets with the effect before
+    // last
+    PostEffectPass postEffectPasses[MAX_POST_EFFECTS];
+    // Result of the post-processing chain, drawn to the window
+    RenderGraphResource presentedResource;
+    int isRenderGraphDumpRequested;
+    LastFrameStats lastFrame;
+
+    // Material of the bird sprite, NULL if the renderer doesn't support materials
+    Material *glintMaterial;
+
+    // Lights of the world pass, toggled by F6
+    LightingPass *lighting;
+    int isLightingEnabled;
+
+    // Applied to the world pass before it is drawn to the window, quality cycled by F7
+    PostProcessChain *postProcess;
+    ColorLUT *gradingLUT;
+
+    // Recording of the window toggled by F8, NULL while not recording
+    FrameCapture *capture;
+    const char *capturePath;
+    CaptureFormat captureFormat;
+
+    // Skip rendering while nothing changes
+    RenderOnDemand renderOnDemand;
+    // Fixed updates are not run while paused
+    int isPaused;
+
+    // Flight lane drawn over the world
+    Path *lanePath;
+    StrokeStyle laneStyle;
+
     GameNode *rootNode;
+    // Sprites of the static nodes under rootNode
+    StaticBatches *staticBatches;
 };
 
 #endif // RTD_GAME_H
\ No newline at end of file
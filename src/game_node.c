@@ -28,6 +28,14 @@ extern void AppendGameNodeChild(GameNode *parent, GameNode *child) {
     parent->lastChild = child;
 
     ++parent->childrenCount;
+
+    MarkGameNodeChanged(parent);
+}
+
+extern void MarkGameNodeChanged(GameNode *node) {
+    for (; node != NULL; node = node->parent) {
+        ++node->revision;
+    }
 }
 
 
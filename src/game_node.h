@@ -1,10 +1,12 @@
 #ifndef RTD_GAME_NODE_H
 #define RTD_GAME_NODE_H
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "cgmath.h"
 #include "game_context.h"
+#include "renderer.h"
 
 struct GameContext;
 typedef struct GameNode GameNode;
@@ -28,12 +30,23 @@ typedef struct SpriteComponent {
     const char *texturePath;
     BBox2 region;
     V2 anchor;
+    // NULL for the built-in sprite shader
+    Material *material;
+    // Loaded from texturePath when first drawn, so its alpha hull is only computed once. Destroy it and set it to
+    // NULL after changing texturePath.
+    Texture *texture;
 } SpriteComponent;
 
 typedef enum ComponentName {
     COMPONENT_NAME_ScriptComponent,
     COMPONENT_NAME_TransformComponent,
     COMPONENT_NAME_SpriteComponent,
+    COMPONENT_NAME_TilemapComponent,
+    COMPONENT_NAME_ParticleEmitterComponent,
+    COMPONENT_NAME_AnimationComponent,
+    COMPONENT_NAME_LightComponent,
+    COMPONENT_NAME_LightOccluderComponent,
+    COMPONENT_NAME_ParallaxLayerComponent,
 
     COMPONENT_NAME_COUNT,
 } ComponentName;
@@ -54,6 +67,12 @@ typedef struct GameNodeTreeWalker {
 
 struct GameNode {
     const char *name;
+    // The transform and sprite of the node don't change from frame to frame, so its sprite is drawn from a static
+    // batch, see StaticBatches
+    int isStatic;
+    // Bumped by MarkGameNodeChanged on the node and all its ancestors, so the revision of the root changes with
+    // anything in the tree
+    uint32_t revision;
 
     GameNode *parent;
 
@@ -73,9 +92,23 @@ struct GameNode {
 
 extern GameNode *CreateGameNode(struct GameContext *c, const char *name);
 extern void AppendGameNodeChild(GameNode *parent, GameNode *child);
+// Call after changing the transform or sprite of a static node or the transform of one of its ancestors. Appending a
+// child marks the parent itself.
+extern void MarkGameNodeChanged(GameNode *node);
 extern T2 GetGameNodeWorldTransform(GameNode *node);
 extern void WalkToNextGameNode(GameNodeTreeWalker *walker);
 
+// Quad of sprite drawn with texture, transform is updated to the space of dst
+static inline void GetSpriteQuad(const SpriteComponent *sprite, const Texture *texture, T2 *transform, BBox2 *dst,
+                                 BBox2 *src) {
+    V2 texSize = MakeV2((F) texture->width, (F) texture->height);
+    *src = MakeBBox2(HadamardMulV2(sprite->region.min, texSize), HadamardMulV2(sprite->region.max, texSize));
+    *dst = *src;
+
+    V2 offset = HadamardMulV2(sprite->anchor, GetBBox2Size(*src));
+    *transform = DotT2(*transform, MakeT2FromTranslation(NegV2(offset)));
+}
+
 static inline GameNodeTreeWalker *BeginWalkGameNodeTree(GameNodeTreeWalker *walker, GameNode *node) {
     walker->node = node;
     walker->level = 1;
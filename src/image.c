@@ -1,5 +1,7 @@
 #include "image.h"
 
+#include <stdint.h>
+
 #define STBI_ONLY_PNG
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -96,4 +98,309 @@ extern void DestroyImage(Image **ptr) {
     }
 
     *ptr = NULL;
-}
\ No newline at end of file
+}
+
+static int CompareHullPoint(const void *a, const void *b) {
+    const V2 *p = a;
+    const V2 *q = b;
+    if (p->x != q->x) {
+        return p->x < q->x ? -1 : 1;
+    }
+    if (p->y != q->y) {
+        return p->y < q->y ? -1 : 1;
+    }
+    return 0;
+}
+
+// Andrew's monotone chain. Write the counter-clockwise hull of points into hull, which must have room for
+// pointCount + 1 points, and return its vertex count. points are sorted in place.
+static int CalcConvexHull(V2 *points, int pointCount, V2 *hull) {
+    qsort(points, (size_t) pointCount, sizeof(V2), CompareHullPoint);
+
+    int count = 0;
+    // Lower hull
+    for (int i = 0; i < pointCount; ++i) {
+        while (count >= 2 && !IsV2Left(SubV2(hull[count - 1], hull[count - 2]), SubV2(points[i], hull[count - 2]))) {
+            count--;
+        }
+        hull[count++] = points[i];
+    }
+    // Upper hull
+    int lowerCount = count + 1;
+    for (int i = pointCount - 2; i >= 0; --i) {
+        while (count >= lowerCount && !IsV2Left(SubV2(hull[count - 1], hull[count - 2]), SubV2(points[i], hull[count - 2]))) {
+            count--;
+        }
+        hull[count++] = points[i];
+    }
+
+    // The first point is repeated at the end
+    return count - 1;
+}
+
+static int IsInBBox2(BBox2 bbox, V2 p) {
+    F epsilon = 1e-3f;
+    return p.x >= bbox.min.x - epsilon && p.x <= bbox.max.x + epsilon &&
+           p.y >= bbox.min.y - epsilon && p.y <= bbox.max.y + epsilon;
+}
+
+// Drop the edge whose removal grows the polygon the least, by extending its two neighbour edges until they meet.
+// The polygon keeps enclosing the original one and stays inside bbox. Return 0 if no edge can be dropped.
+static int DropConvexHullEdge(V2 *hull, int *count, BBox2 bbox) {
+    int n = *count;
+    int best = -1;
+    F bestArea = 0.0f;
+    V2 bestPoint = ZeroV2();
+
+    for (int i = 0; i < n; ++i) {
+        V2 prev = hull[(i + n - 1) % n];
+        V2 p0 = hull[i];
+        V2 p1 = hull[(i + 1) % n];
+        V2 next = hull[(i + 2) % n];
+
+        V2 d0 = SubV2(p0, prev);
+        V2 d1 = SubV2(next, p1);
+        F denom = CrossV2(d0, d1);
+        // The neighbour edges only meet beyond the dropped edge if they turn towards each other
+        if (denom <= 0.0f) {
+            continue;
+        }
+
+        F t = CrossV2(SubV2(p1, p0), d1) / denom;
+        V2 point = AddV2(p0, MulV2(t, d0));
+        if (t < 0.0f || !IsInBBox2(bbox, point)) {
+            continue;
+        }
+
+        F area = fabsf(CrossV2(SubV2(point, p0), SubV2(p1, p0))) / 2.0f;
+        if (best < 0 || area < bestArea) {
+            best = i;
+            bestArea = area;
+            bestPoint = point;
+        }
+    }
+
+    if (best < 0) {
+        return 0;
+    }
+
+    hull[best] = bestPoint;
+    int removed = (best + 1) % n;
+    memmove(&hull[removed], &hull[removed + 1], sizeof(V2) * (size_t) (n - removed - 1));
+    *count = n - 1;
+
+    return 1;
+}
+
+extern void CalcImageAlphaHull(const Image *image, AlphaHull *hull) {
+    hull->vertexCount = 0;
+
+    int pixelSize = image->channel == IMAGE_CHANNEL_RGBA ? 4 : 1;
+    int alphaOffset = image->channel == IMAGE_CHANNEL_RGBA ? 3 : 0;
+
+    // The corners of the non-transparent span of each row. Only the extremes of a row can be on the hull.
+    V2 *points = malloc(sizeof(V2) * (size_t) image->height * 4);
+    int pointCount = 0;
+    BBox2 bbox = MakeBBox2(MakeV2((F) image->width, (F) image->height), ZeroV2());
+
+    for (int y = 0; y < image->height; ++y) {
+        const unsigned char *row = image->data + image->stride * y;
+        int minX = -1;
+        int maxX = -1;
+        for (int x = 0; x < image->width; ++x) {
+            if (row[x * pixelSize + alphaOffset] != 0) {
+                if (minX < 0) {
+                    minX = x;
+                }
+                maxX = x;
+            }
+        }
+
+        if (minX < 0) {
+            continue;
+        }
+
+        // Rows are stored from the top
+        F top = (F) (image->height - y);
+        F bottom = top - 1.0f;
+        points[pointCount++] = MakeV2((F) minX, bottom);
+        points[pointCount++] = MakeV2((F) minX, top);
+        points[pointCount++] = MakeV2((F) (maxX + 1), bottom);
+        points[pointCount++] = MakeV2((F) (maxX + 1), top);
+
+        bbox.min = MakeV2(MinF(bbox.min.x, (F) minX), MinF(bbox.min.y, bottom));
+        bbox.max = MakeV2(fmaxf(bbox.max.x, (F) (maxX + 1)), fmaxf(bbox.max.y, top));
+    }
+
+    if (pointCount == 0) {
+        free(points);
+        return;
+    }
+
+    V2 *convexHull = malloc(sizeof(V2) * (size_t) (pointCount + 1));
+    int count = CalcConvexHull(points, pointCount, convexHull);
+    while (count > MAX_ALPHA_HULL_VERTICES && DropConvexHullEdge(convexHull, &count, bbox)) {
+    }
+
+    F rectArea = (bbox.max.x - bbox.min.x) * (bbox.max.y - bbox.min.y);
+    if (count <= MAX_ALPHA_HULL_VERTICES) {
+        hull->vertexCount = count;
+        memcpy(hull->vertices, convexHull, sizeof(V2) * (size_t) count);
+    }
+
+    // Extra vertices aren't worth it unless they cut a fair amount of the trimmed rect
+    if (hull->vertexCount == 0 || GetAlphaHullArea(hull) > rectArea * 0.9f) {
+        hull->vertexCount = 4;
+        hull->vertices[0] = bbox.min;
+        hull->vertices[1] = MakeV2(bbox.max.x, bbox.min.y);
+        hull->vertices[2] = bbox.max;
+        hull->vertices[3] = MakeV2(bbox.min.x, bbox.max.y);
+    }
+
+    free(convexHull);
+    free(points);
+}
+
+extern int SaveImageToTGA(const char *filename, int width, int height, int stride, const unsigned char *data) {
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        printf("Failed to save image %s\n", filename);
+        return 0;
+    }
+
+    // Uncompressed true color with 8 bits of alpha, rows from the top
+    unsigned char header[18] = {0};
+    header[2] = 2;
+    header[12] = (unsigned char) (width & 0xFF);
+    header[13] = (unsigned char) (width >> 8);
+    header[14] = (unsigned char) (height & 0xFF);
+    header[15] = (unsigned char) (height >> 8);
+    header[16] = 32;
+    header[17] = 0x28;
+    fwrite(header, 1, sizeof(header), file);
+
+    // TGA stores BGRA
+    unsigned char *row = malloc((size_t) width * 4);
+    for (int y = 0; y < height; ++y) {
+        const unsigned char *src = data + (size_t) stride * y;
+        for (int x = 0; x < width; ++x) {
+            row[x * 4 + 0] = src[x * 4 + 2];
+            row[x * 4 + 1] = src[x * 4 + 1];
+            row[x * 4 + 2] = src[x * 4 + 0];
+            row[x * 4 + 3] = src[x * 4 + 3];
+        }
+        fwrite(row, 1, (size_t) width * 4, file);
+    }
+    free(row);
+
+    int isOk = !ferror(file);
+    fclose(file);
+    if (!isOk) {
+        printf("Failed to save image %s\n", filename);
+    }
+    return isOk;
+}
+
+static void PutPNGUint32(unsigned char *dst, uint32_t value) {
+    dst[0] = (unsigned char) (value >> 24);
+    dst[1] = (unsigned char) (value >> 16);
+    dst[2] = (unsigned char) (value >> 8);
+    dst[3] = (unsigned char) value;
+}
+
+static uint32_t UpdatePNGCRC(const uint32_t *crcTable, uint32_t crc, const unsigned char *data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void WritePNGChunk(FILE *file, const uint32_t *crcTable, const char *type, const unsigned char *data, size_t size) {
+    unsigned char buf[4];
+    PutPNGUint32(buf, (uint32_t) size);
+    fwrite(buf, 1, 4, file);
+    fwrite(type, 1, 4, file);
+    fwrite(data, 1, size, file);
+
+    uint32_t crc = UpdatePNGCRC(crcTable, 0xFFFFFFFFu, (const unsigned char *) type, 4);
+    crc = UpdatePNGCRC(crcTable, crc, data, size);
+    PutPNGUint32(buf, crc ^ 0xFFFFFFFFu);
+    fwrite(buf, 1, 4, file);
+}
+
+extern int SaveImageToPNG(const char *filename, int width, int height, int stride, const unsigned char *data) {
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        printf("Failed to save image %s\n", filename);
+        return 0;
+    }
+
+    uint32_t crcTable[256];
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crcTable[i] = c;
+    }
+
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(signature, 1, sizeof(signature), file);
+
+    // 8 bits RGBA, no interlacing
+    unsigned char header[13] = {0};
+    PutPNGUint32(header, (uint32_t) width);
+    PutPNGUint32(header + 4, (uint32_t) height);
+    header[8] = 8;
+    header[9] = 6;
+    WritePNGChunk(file, crcTable, "IHDR", header, sizeof(header));
+
+    // Rows with filter type 0, wrapped in a zlib stream of stored deflate blocks. Compression is left to whoever
+    // archives the files, so encoding costs little more than a copy.
+    size_t rowSize = (size_t) width * 4 + 1;
+    size_t rawSize = rowSize * height;
+    size_t blockCount = (rawSize + 0xFFFE) / 0xFFFF;
+    size_t zlibSize = 2 + blockCount * 5 + rawSize + 4;
+    unsigned char *zlib = malloc(zlibSize);
+    unsigned char *dst = zlib;
+    *dst++ = 0x78;
+    *dst++ = 0x01;
+
+    uint32_t adlerA = 1;
+    uint32_t adlerB = 0;
+    size_t blockRemaining = 0;
+    size_t rawRemaining = rawSize;
+    for (int y = 0; y < height; ++y) {
+        const unsigned char *src = data + (size_t) stride * y;
+        for (size_t x = 0; x < rowSize; ++x) {
+            if (blockRemaining == 0) {
+                blockRemaining = rawRemaining < 0xFFFF ? rawRemaining : 0xFFFF;
+                rawRemaining -= blockRemaining;
+                *dst++ = rawRemaining == 0 ? 1 : 0;
+                *dst++ = (unsigned char) (blockRemaining & 0xFF);
+                *dst++ = (unsigned char) (blockRemaining >> 8);
+                *dst++ = (unsigned char) (~blockRemaining & 0xFF);
+                *dst++ = (unsigned char) ((~blockRemaining >> 8) & 0xFF);
+            }
+
+            unsigned char value = x == 0 ? 0 : src[x - 1];
+            *dst++ = value;
+            blockRemaining--;
+
+            adlerA = (adlerA + value) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+    }
+    PutPNGUint32(dst, (adlerB << 16) | adlerA);
+
+    WritePNGChunk(file, crcTable, "IDAT", zlib, zlibSize);
+    WritePNGChunk(file, crcTable, "IEND", NULL, 0);
+    free(zlib);
+
+    int isOk = !ferror(file);
+    fclose(file);
+    if (!isOk) {
+        printf("Failed to save image %s\n", filename);
+    }
+    return isOk;
+}
@@ -3,6 +3,8 @@
 
 #include <stdlib.h>
 
+#include "cgmath.h"
+
 typedef enum ImageSource {
     IMAGE_SOURCE_FILE,
     IMAGE_SOURCE_BITMAP,
@@ -23,8 +25,42 @@ typedef struct Image {
     unsigned char *data;
 } Image;
 
+#define MAX_ALPHA_HULL_VERTICES 8
+
+// Convex polygon enclosing every pixel with non-zero alpha, within the trimmed bounding box of those pixels
+typedef struct AlphaHull {
+    // 0 if every pixel is transparent
+    int vertexCount;
+    // Counter-clockwise, in pixels from the bottom left of the image like texture coordinates
+    V2 vertices[MAX_ALPHA_HULL_VERTICES];
+} AlphaHull;
+
 extern Image *LoadImageFromFilename(const char *filename);
 extern Image *LoadImageFromGrayBitmap(int width, int height, int stride, const unsigned char *data);
 extern void DestroyImage(Image **image);
+// Write RGBA pixels, top row first, as an uncompressed TGA. Return 0 on failure.
+extern int SaveImageToTGA(const char *filename, int width, int height, int stride, const unsigned char *data);
+// Write RGBA pixels, top row first, as a PNG with uncompressed image data. Return 0 on failure.
+extern int SaveImageToPNG(const char *filename, int width, int height, int stride, const unsigned char *data);
+
+extern void CalcImageAlphaHull(const Image *image, AlphaHull *hull);
+
+static inline F GetAlphaHullArea(const AlphaHull *hull) {
+    F area = 0.0f;
+    for (int i = 0; i < hull->vertexCount; ++i) {
+        area += CrossV2(hull->vertices[i], hull->vertices[(i + 1) % hull->vertexCount]);
+    }
+    return area / 2.0f;
+}
+
+static inline int IsAlphaHullInBBox2(const AlphaHull *hull, BBox2 bbox) {
+    for (int i = 0; i < hull->vertexCount; ++i) {
+        V2 p = hull->vertices[i];
+        if (p.x < bbox.min.x || p.x > bbox.max.x || p.y < bbox.min.y || p.y > bbox.max.y) {
+            return 0;
+        }
+    }
+    return 1;
+}
 
 #endif // RTD_IMAGE_H
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "light.h"
+
+#include <assert.h>
+#include <string.h>
+
+extern LightOccluderComponent *CreateLightOccluderComponent(const V2 *vertices, int vertexCount) {
+    assert(vertexCount >= 2);
+
+    LightOccluderComponent *occluder = malloc(sizeof(LightOccluderComponent));
+    occluder->vertexCount = vertexCount;
+    occluder->vertices = malloc(sizeof(V2) * vertexCount);
+    memcpy(occluder->vertices, vertices, sizeof(V2) * vertexCount);
+    occluder->isDirty = 1;
+    occluder->builtTransform = IdentityT2();
+    occluder->occluder = NULL;
+
+    return occluder;
+}
+
+extern void DestroyLightOccluderComponent(RenderContext *rc, LightOccluderComponent **ptr) {
+    LightOccluderComponent *occluder = *ptr;
+
+    if (occluder->occluder) {
+        DestroyLightOccluder(rc, &occluder->occluder);
+    }
+
+    free(occluder->vertices);
+    free(occluder);
+
+    *ptr = NULL;
+}
+
+extern LightingPass *CreateLightingPass(int width, int height, F scale, V4 ambient) {
+    LightingPass *pass = malloc(sizeof(LightingPass));
+    pass->width = width;
+    pass->height = height;
+    pass->scale = scale;
+    pass->ambient = ambient;
+    pass->lightCount = 0;
+    pass->lightCapacity = 0;
+    pass->lights = NULL;
+    pass->occluderCount = 0;
+    pass->occluderCapacity = 0;
+    pass->occluders = NULL;
+    pass->rebuiltOccluderCount = 0;
+
+    return pass;
+}
+
+extern void DestroyLightingPass(LightingPass **ptr) {
+    LightingPass *pass = *ptr;
+
+    free(pass->lights);
+    free(pass->occluders);
+    free(pass);
+
+    *ptr = NULL;
+}
+
+extern void BeginLightingPass(LightingPass *pass) {
+    pass->lightCount = 0;
+    pass->occluderCount = 0;
+    pass->rebuiltOccluderCount = 0;
+}
+
+extern void AddLight(LightingPass *pass, const LightComponent *light, T2 transform) {
+    if (pass->lightCount == pass->lightCapacity) {
+        pass->lightCapacity = pass->lightCapacity > 0 ? pass->lightCapacity * 2 : 16;
+        pass->lights = realloc(pass->lights, sizeof(PointLight) * pass->lightCapacity);
+    }
+
+    PointLight *pointLight = &pass->lights[pass->lightCount++];
+    pointLight->position = transform.origin;
+    pointLight->radius = light->radius;
+    pointLight->color = light->color;
+}
+
+static int IsT2Equal(T2 a, T2 b) {
+    return IsV2Equal(a.xAxis, b.xAxis) && IsV2Equal(a.yAxis, b.yAxis) && IsV2Equal(a.origin, b.origin);
+}
+
+extern void AddLightOccluder(RenderContext *rc, LightingPass *pass, LightOccluderComponent *occluder, T2 transform) {
+    if (occluder->occluder == NULL) {
+        occluder->occluder = CreateLightOccluder(rc);
+        occluder->isDirty = 1;
+    }
+
+    // Static occluders keep their shadow geometry on GPU across frames
+    if (occluder->isDirty || !IsT2Equal(occluder->builtTransform, transform)) {
+        V2 *worldVertices = malloc(sizeof(V2) * occluder->vertexCount);
+        for (int i = 0; i < occluder->vertexCount; ++i) {
+            worldVertices[i] = ApplyT2(transform, occluder->vertices[i]);
+        }
+        UploadLightOccluder(rc, occluder->occluder, worldVertices, occluder->vertexCount);
+        free(worldVertices);
+
+        occluder->builtTransform = transform;
+        occluder->isDirty = 0;
+        pass->rebuiltOccluderCount++;
+    }
+
+    if (pass->occluderCount == pass->occluderCapacity) {
+        pass->occluderCapacity = pass->occluderCapacity > 0 ? pass->occluderCapacity * 2 : 16;
+        pass->occluders = realloc(pass->occluders, sizeof(LightOccluder *) * pass->occluderCapacity);
+    }
+    pass->occluders[pass->occluderCount++] = occluder->occluder;
+}
+
+extern void RenderLightingPass(RenderContext *rc, LightingPass *pass, RenderTarget *target, float width, float height,
+                               float pointToPixel, T2 camera) {
+    if (target == NULL) {
+        return;
+    }
+
+    BeginRenderTargetView(rc, target, width, height, pointToPixel * pass->scale);
+    SetCameraTransform(rc, camera);
+    DrawLights(rc, pass->ambient, pass->lights, pass->lightCount, pass->occluders, pass->occluderCount);
+    EndRenderTarget(rc);
+}
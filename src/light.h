@@ -0,0 +1,65 @@
+#ifndef RTD_LIGHT_H
+#define RTD_LIGHT_H
+
+#include "cgmath.h"
+#include "renderer.h"
+
+// Point light at the origin of its node
+typedef struct LightComponent {
+    // In world points
+    F radius;
+    // Straight alpha, alpha scales the intensity
+    V4 color;
+} LightComponent;
+
+// Polygon blocking lights, in the space of its node. Shadow geometry is built in world space, so it is only rebuilt
+// when the node moves, or when isDirty is set after vertices are changed.
+typedef struct LightOccluderComponent {
+    int vertexCount;
+    V2 *vertices;
+    int isDirty;
+
+    // World transform the shadow geometry was built with
+    T2 builtTransform;
+    LightOccluder *occluder;
+} LightOccluderComponent;
+
+// Lights and occluders collected each frame, drawn into a low resolution target multiplied over the world
+typedef struct LightingPass {
+    // Size in pixels of the light target, which is provided by the caller, e.g. as a render graph resource
+    int width;
+    int height;
+    // Resolution of the light target relative to the view it lights
+    F scale;
+    V4 ambient;
+
+    int lightCount;
+    int lightCapacity;
+    PointLight *lights;
+
+    int occluderCount;
+    int occluderCapacity;
+    LightOccluder **occluders;
+
+    // Occluders whose shadow geometry was rebuilt since BeginLightingPass
+    int rebuiltOccluderCount;
+} LightingPass;
+
+// vertices are copied
+extern LightOccluderComponent *CreateLightOccluderComponent(const V2 *vertices, int vertexCount);
+extern void DestroyLightOccluderComponent(RenderContext *rc, LightOccluderComponent **occluder);
+
+// width and height are the largest view in pixels of the light target, already multiplied by scale
+extern LightingPass *CreateLightingPass(int width, int height, F scale, V4 ambient);
+extern void DestroyLightingPass(LightingPass **pass);
+
+extern void BeginLightingPass(LightingPass *pass);
+extern void AddLight(LightingPass *pass, const LightComponent *light, T2 transform);
+// Rebuild the shadow geometry if the occluder moved since it was last added
+extern void AddLightOccluder(RenderContext *rc, LightingPass *pass, LightOccluderComponent *occluder, T2 transform);
+// Draw the collected lights into target, of the size of the pass, for a view of width x height points seen through
+// camera. Must not be called while another target is current, target is composited later with CompositeLighting.
+extern void RenderLightingPass(RenderContext *rc, LightingPass *pass, RenderTarget *target, float width, float height,
+                               float pointToPixel, T2 camera);
+
+#endif // RTD_LIGHT_H
@@ -1,38 +1,39 @@
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <SDL2/SDL.h>
 
 #define WINDOW_WIDTH 576
 #define WINDOW_HEIGHT 768
+#define MAX_ANIMATORS 1024
+// Native resolution of the playfield in world units
+#define GAME_WIDTH 144
+#define GAME_HEIGHT 256
+// Bounds of the world pass resolution scale, relative to the window resolution
+#define MIN_RESOLUTION_SCALE 0.5f
+#define MAX_RESOLUTION_SCALE 1.0f
+// Resolution of the light target relative to the world pass
+#define LIGHT_RESOLUTION_SCALE 0.5f
+#define GRADING_LUT_SIZE 16
+#define FRAME_BUDGET (1.0f / 60.0f)
+// Longest time without a frame in render on demand mode, so the HUD is refreshed
+#define MAX_IDLE_SECONDS 1.0f
 
 #include "game.h"
 
-static void OnFixedUpdateBackground(GameNode *node, void *data, float delta) {
-//    TransformComponent *transform = GetGameNodeComponent(node, TransformComponent);
-//    transform->transform = TranslateT2(MakeV2(-40.0f * delta, 0.0f), transform->transform);
-}
+const char GLINT_FRAGMENT_SHADER[] = {
+#include "shader/draw_sprite_glint.frag.gen"
+};
 
+// Sky repeated endlessly, drifting slowly and scrolling at half the speed of the world
 static GameNode *CreateBackgroundGameNode(GameContext *c, const char *name) {
     GameNode *node = CreateGameNode(c, name);
 
-    ScriptComponent *script = malloc(sizeof(ScriptComponent));
-    script->data = NULL;
-    script->onReady = NULL;
-    script->onFixedUpdate = OnFixedUpdateBackground;
-    SetGameNodeComponent(node, ScriptComponent, script);
-
-    TransformComponent *transform = malloc(sizeof(TransformComponent));
-    transform->translation = ZeroV2();
-    transform->rotation = 0.0f;
-    transform->scale = OneV2();
-    SetGameNodeComponent(node, TransformComponent, transform);
-
-    SpriteComponent *sprite = malloc(sizeof(SpriteComponent));
-    sprite->texturePath = "assets/sprites/background_day.png";
-    sprite->region = OneBBox2();
-    sprite->anchor = MakeV2(0.0f, 0.0f);
-    SetGameNodeComponent(node, SpriteComponent, sprite);
+    ParallaxLayerComponent *layer = CreateParallaxLayerComponent("assets/sprites/background_day.png",
+                                                                 MakeV2(0.5f, 1.0f));
+    layer->velocity = MakeV2(-10.0f, 0.0f);
+    SetGameNodeComponent(node, ParallaxLayerComponent, layer);
 
     return node;
 }
@@ -61,13 +62,57 @@ static GameNode *CreateBirdGameNode(GameContext *c) {
     sprite->texturePath = "assets/sprites/bird_blue_0.png";
     sprite->region = OneBBox2();
     sprite->anchor = MakeV2(0.5f, 0.5f);
+    sprite->material = c->glintMaterial;
+    sprite->texture = NULL;
     SetGameNodeComponent(node, SpriteComponent, sprite);
 
+    LightComponent *light = malloc(sizeof(LightComponent));
+    light->radius = 64.0f;
+    light->color = MakeV4(1.0f, 0.8f, 0.5f, 1.0f);
+    SetGameNodeComponent(node, LightComponent, light);
+
+    return node;
+}
+
+// Static occluder casting the shadows of the lights around it
+static GameNode *CreatePillarGameNode(GameContext *c, const char *name, V2 translation) {
+    GameNode *node = CreateGameNode(c, name);
+
+    TransformComponent *transform = malloc(sizeof(TransformComponent));
+    transform->translation = translation;
+    transform->rotation = 0.0f;
+    transform->scale = OneV2();
+    SetGameNodeComponent(node, TransformComponent, transform);
+
+    V2 vertices[] = {
+        MakeV2(-6.0f, -20.0f), MakeV2(6.0f, -20.0f), MakeV2(6.0f, 20.0f), MakeV2(-6.0f, 20.0f),
+    };
+    LightOccluderComponent *occluder = CreateLightOccluderComponent(vertices, 4);
+    SetGameNodeComponent(node, LightOccluderComponent, occluder);
+
+    return node;
+}
+
+static GameNode *CreateLampGameNode(GameContext *c, const char *name, V2 translation, V4 color) {
+    GameNode *node = CreateGameNode(c, name);
+
+    TransformComponent *transform = malloc(sizeof(TransformComponent));
+    transform->translation = translation;
+    transform->rotation = 0.0f;
+    transform->scale = OneV2();
+    SetGameNodeComponent(node, TransformComponent, transform);
+
+    LightComponent *light = malloc(sizeof(LightComponent));
+    light->radius = 96.0f;
+    light->color = color;
+    SetGameNodeComponent(node, LightComponent, light);
+
     return node;
 }
 
 static GameNode *CreateGroundGameNode(GameContext *c, const char *name) {
     GameNode *node = CreateGameNode(c, name);
+    node->isStatic = 1;
 
     TransformComponent *transform = malloc(sizeof(TransformComponent));
     transform->translation = ZeroV2();
@@ -79,6 +124,8 @@ static GameNode *CreateGroundGameNode(GameContext *c, const char *name) {
     sprite->texturePath = "assets/sprites/ground.png";
     sprite->region = OneBBox2();
     sprite->anchor = ZeroV2();
+    sprite->material = NULL;
+    sprite->texture = NULL;
     SetGameNodeComponent(node, SpriteComponent, sprite);
 
     return node;
@@ -96,16 +143,91 @@ static void LoadGameNodes(GameContext *c) {
     GameNode *ground = CreateGroundGameNode(c, "Ground 1");
     AppendGameNodeChild(mainNode, ground);
 
+    GameNode *pillar = CreatePillarGameNode(c, "Pillar 1", MakeV2(72.0f, 150.0f));
+    AppendGameNodeChild(mainNode, pillar);
+
+    GameNode *lamp = CreateLampGameNode(c, "Lamp 1", MakeV2(110.0f, 170.0f), MakeV4(0.5f, 0.7f, 1.0f, 1.0f));
+    AppendGameNodeChild(mainNode, lamp);
+
     c->rootNode = mainNode;
 }
 
+// Warm colors with a little more contrast
+static ColorLUT *CreateGradingLUT(RenderContext *rc) {
+    static unsigned char data[GRADING_LUT_SIZE * GRADING_LUT_SIZE * GRADING_LUT_SIZE * 4];
+
+    for (int g = 0; g < GRADING_LUT_SIZE; ++g) {
+        for (int b = 0; b < GRADING_LUT_SIZE; ++b) {
+            for (int r = 0; r < GRADING_LUT_SIZE; ++r) {
+                F in[3] = {(F) r, (F) g, (F) b};
+                F tint[3] = {1.06f, 1.0f, 0.9f};
+                unsigned char *texel = &data[((g * GRADING_LUT_SIZE + b) * GRADING_LUT_SIZE + r) * 4];
+                for (int i = 0; i < 3; ++i) {
+                    F x = in[i] / (GRADING_LUT_SIZE - 1);
+                    F curve = x * x * (3.0f - 2.0f * x);
+                    F out = MinF((x + (curve - x) * 0.4f) * tint[i], 1.0f);
+                    texel[i] = (unsigned char) (out * 255.0f + 0.5f);
+                }
+                texel[3] = 255;
+            }
+        }
+    }
+
+    return CreateColorLUT(rc, data, GRADING_LUT_SIZE);
+}
+
 static void SetupGame(GameContext *c) {
     SDL_Init(0);
 
     c->window = CreateGameWindow("Flappy Bird", WINDOW_WIDTH, WINDOW_HEIGHT);
-    c->rc = CreateRenderContext(WINDOW_WIDTH, WINDOW_HEIGHT, c->window->pointToPixel);
+    // SDL_GetPrefPath returns a writable directory ending with a path separator, or NULL on failure
+    char *prefPath = SDL_GetPrefPath("coeuvre", "rtd");
+    c->rc = CreateRenderContext(WINDOW_WIDTH, WINDOW_HEIGHT, c->window->pointToPixel, prefPath);
+    SDL_free(prefPath);
+
+    c->animationSystem = CreateAnimationSystem(MAX_ANIMATORS);
+
+    c->isVirtualResolution = 1;
+    InitDynamicResolution(&c->dynamicResolution, MIN_RESOLUTION_SCALE, MAX_RESOLUTION_SCALE, FRAME_BUDGET);
+    c->renderGraph = CreateRenderGraph();
+    c->isRenderGraphDumpRequested = 0;
+    c->hierarchyScroll = 0;
+    memset(&c->lastFrame, 0, sizeof(LastFrameStats));
+
+    float pointToPixel = c->window->pointToPixel * MAX_RESOLUTION_SCALE;
+
+    // Sized for the largest world pass, which also covers the native game resolution
+    float lightPointToPixel = pointToPixel * LIGHT_RESOLUTION_SCALE;
+    c->lighting = CreateLightingPass((int) CeilF(WINDOW_WIDTH * lightPointToPixel),
+                                     (int) CeilF(WINDOW_HEIGHT * lightPointToPixel), LIGHT_RESOLUTION_SCALE,
+                                     MakeV4(0.25f, 0.25f, 0.35f, 1.0f));
+    c->isLightingEnabled = 0;
+
+    c->gradingLUT = CreateGradingLUT(c->rc);
+    c->postProcess = CreatePostProcessChain(POST_QUALITY_HIGH);
+    AddPostEffect(c->postProcess, POST_EFFECT_BLOOM, "Bloom", POST_QUALITY_HIGH);
+    PostEffect *grading = AddPostEffect(c->postProcess, POST_EFFECT_COLOR_GRADING, "Color grading", POST_QUALITY_MEDIUM);
+    grading->colorGrading.lut = c->gradingLUT;
+    AddPostEffect(c->postProcess, POST_EFFECT_VIGNETTE, "Vignette", POST_QUALITY_LOW);
+    InitRenderOnDemand(&c->renderOnDemand, MAX_IDLE_SECONDS);
+    c->isPaused = 0;
+
+    // A warm band of light sweeping over the bird every two seconds
+    c->glintMaterial = CreateMaterial(c->rc, "Glint", GLINT_FRAGMENT_SHADER, 1);
+    if (c->glintMaterial) {
+        c->glintMaterial->params[0] = MakeV4(1.0f, 0.9f, 0.6f, 0.8f);
+        c->glintMaterial->params[1] = MakeV4(0.5f, 0.15f, 0.5f, 0.0f);
+    }
 
     LoadGameNodes(c);
+    c->staticBatches = CreateStaticBatches();
+
+    c->lanePath = CreatePath();
+    MovePathTo(c->lanePath, MakeV2(0.0f, GAME_HEIGHT * 0.5f));
+    CubicPathTo(c->lanePath, MakeV2(GAME_WIDTH * 0.25f, GAME_HEIGHT * 0.8f), MakeV2(GAME_WIDTH * 0.5f, GAME_HEIGHT * 0.2f),
+                MakeV2(GAME_WIDTH * 0.75f, GAME_HEIGHT * 0.5f));
+    QuadPathTo(c->lanePath, MakeV2(GAME_WIDTH * 0.9f, GAME_HEIGHT * 0.7f), MakeV2(GAME_WIDTH, GAME_HEIGHT * 0.6f));
+    c->laneStyle = MakeStrokeStyle(2.0f, STROKE_JOIN_ROUND, STROKE_CAP_ROUND);
 
 #ifdef PLATFORM_WIN32
     char *font = "C:/Windows/Fonts/Arial.ttf";
@@ -119,6 +241,9 @@ static void ProcessSystemEvent(GameContext *c) {
     SDL_Event event;
 
     while (SDL_PollEvent(&event)) {
+        // Input, window changes and wake ups can all change what is on screen
+        RequestRedraw(&c->renderOnDemand);
+
         switch (event.type) {
             case SDL_QUIT: {
                 c->isRunning = 0;
@@ -128,11 +253,39 @@ static void ProcessSystemEvent(GameContext *c) {
             case SDL_KEYDOWN: {
                 if (event.key.keysym.sym == SDLK_ESCAPE) {
                     c->isRunning = 0;
+                } else if (event.key.keysym.sym == SDLK_F1) {
+                    c->isVirtualResolution = !c->isVirtualResolution;
+                } else if (event.key.keysym.sym == SDLK_F2) {
+                    c->rc->isOpaquePassEnabled = !c->rc->isOpaquePassEnabled;
+                } else if (event.key.keysym.sym == SDLK_F3) {
+                    c->rc->debugMode = (RenderDebugMode) ((c->rc->debugMode + 1) % RENDER_DEBUG_MODE_COUNT);
+                } else if (event.key.keysym.sym == SDLK_F4) {
+                    c->renderOnDemand.isEnabled = !c->renderOnDemand.isEnabled;
+                } else if (event.key.keysym.sym == SDLK_F5) {
+                    c->isPaused = !c->isPaused;
+                } else if (event.key.keysym.sym == SDLK_F6) {
+                    c->isLightingEnabled = !c->isLightingEnabled;
+                } else if (event.key.keysym.sym == SDLK_F7) {
+                    c->postProcess->quality = (PostQuality) ((c->postProcess->quality + 1) % POST_QUALITY_COUNT);
+                } else if (event.key.keysym.sym == SDLK_F8) {
+                    if (c->capture) {
+                        StopFrameCapture(c->rc, &c->capture);
+                    } else {
+                        c->capture = StartFrameCapture(c->rc, c->capturePath, c->captureFormat);
+                    }
+                } else if (event.key.keysym.sym == SDLK_F9) {
+                    c->isRenderGraphDumpRequested = 1;
                 }
 
                 break;
             }
 
+            case SDL_MOUSEWHEEL: {
+                // Clamped to the node count by ExecuteHUDPass
+                c->hierarchyScroll -= event.wheel.y;
+                break;
+            }
+
             default: break;
         }
     }
@@ -152,10 +305,88 @@ static void DoScriptFixedUpdate(GameNode *node, float delta) {
     onFixedUpdate(node, script->data, delta);
 }
 
+static void DoParticleEmitterUpdate(GameContext *c, GameNode *node, float delta) {
+    ParticleEmitterComponent *emitter = GetGameNodeComponent(node, ParticleEmitterComponent);
+    if (emitter == NULL) {
+        return;
+    }
+
+    UpdateParticleEmitter(emitter, GetGameNodeWorldTransform(node), delta);
+
+    // Particles are left out of the scene hash. Alive ones move every step and an emitting one spawns new ones, so
+    // the next step will change the frame. Requested only when stepping, so nothing is redrawn while paused.
+    if (emitter->pool.count > 0 || emitter->emitRate > 0.0f) {
+        RequestRedraw(&c->renderOnDemand);
+    }
+}
+
+static void DoParallaxLayerUpdate(GameNode *node, float delta) {
+    ParallaxLayerComponent *layer = GetGameNodeComponent(node, ParallaxLayerComponent);
+    if (layer == NULL) {
+        return;
+    }
+
+    UpdateParallaxLayer(layer, delta);
+}
+
 static void Update(GameContext *c, float delta) {
     for (GameNodeTreeWalker *walker = BeginWalkGameNodeTree(&c->gameNodeTreeWalker, c->rootNode); HasNextGameNode(walker); WalkToNextGameNode(walker)) {
         DoScriptFixedUpdate(walker->node, delta);
+        DoParticleEmitterUpdate(c, walker->node, delta);
+        DoParallaxLayerUpdate(walker->node, delta);
+    }
+
+    UpdateAnimationSystem(c->animationSystem, delta);
+}
+
+// Digest of everything Render draws from the scene, see RenderOnDemand
+static uint64_t HashGameScene(GameContext *c) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (GameNodeTreeWalker *walker = BeginWalkGameNodeTree(&c->gameNodeTreeWalker, c->rootNode); HasNextGameNode(walker); WalkToNextGameNode(walker)) {
+        GameNode *node = walker->node;
+
+        TransformComponent *transform = GetGameNodeComponent(node, TransformComponent);
+        if (transform) {
+            hash = HashSceneBytes(hash, transform, sizeof(TransformComponent));
+        }
+
+        SpriteComponent *sprite = GetGameNodeComponent(node, SpriteComponent);
+        if (sprite) {
+            hash = HashSceneBytes(hash, sprite, sizeof(SpriteComponent));
+        }
+
+        LightComponent *light = GetGameNodeComponent(node, LightComponent);
+        if (light) {
+            hash = HashSceneBytes(hash, light, sizeof(LightComponent));
+        }
+
+        // Shadows are rebuilt from the vertices, whether or not isDirty was set
+        LightOccluderComponent *occluder = GetGameNodeComponent(node, LightOccluderComponent);
+        if (occluder) {
+            hash = HashSceneBytes(hash, occluder->vertices, sizeof(V2) * occluder->vertexCount);
+        }
+
+        TilemapComponent *tilemap = GetGameNodeComponent(node, TilemapComponent);
+        if (tilemap) {
+            hash = HashSceneBytes(hash, &tilemap->revision, sizeof(tilemap->revision));
+        }
+
+        ParallaxLayerComponent *layer = GetGameNodeComponent(node, ParallaxLayerComponent);
+        if (layer) {
+            hash = HashSceneBytes(hash, &layer->scroll, sizeof(layer->scroll));
+        }
     }
+
+    hash = HashSceneBytes(hash, &c->lanePath->hash, sizeof(c->lanePath->hash));
+    hash = HashSceneBytes(hash, &c->laneStyle, sizeof(c->laneStyle));
+    hash = HashSceneBytes(hash, &c->hierarchyScroll, sizeof(c->hierarchyScroll));
+    hash = HashSceneBytes(hash, &c->isVirtualResolution, sizeof(c->isVirtualResolution));
+    hash = HashSceneBytes(hash, &c->isLightingEnabled, sizeof(c->isLightingEnabled));
+    hash = HashSceneBytes(hash, &c->postProcess->quality, sizeof(c->postProcess->quality));
+    hash = HashSceneBytes(hash, &c->dynamicResolution.scale, sizeof(c->dynamicResolution.scale));
+
+    return hash;
 }
 
 static void RenderSprite(RenderContext *rc, T2 transform, GameNode *node) {
@@ -164,48 +395,199 @@ static void RenderSprite(RenderContext *rc, T2 transform, GameNode *node) {
         return;
     }
 
-    Texture *texture = LoadTexture(rc, sprite->texturePath);
-    if (texture == NULL) {
+    if (sprite->texture == NULL) {
+        sprite->texture = LoadTexture(rc, sprite->texturePath);
+        if (sprite->texture == NULL) {
+            return;
+        }
+    }
+
+    BBox2 dst;
+    BBox2 src;
+    GetSpriteQuad(sprite, sprite->texture, &transform, &dst, &src);
+
+    DrawTextureWithMaterial(rc, transform, dst, sprite->texture, src, OneV4(), sprite->material);
+}
+
+static void RenderNodeParallaxLayer(RenderContext *rc, GameNode *node) {
+    ParallaxLayerComponent *layer = GetGameNodeComponent(node, ParallaxLayerComponent);
+    if (layer == NULL) {
         return;
     }
 
-    V2 texSize = MakeV2((F) texture->width, (F) texture->height);
-    BBox2 src = MakeBBox2(HadamardMulV2(sprite->region.min, texSize), HadamardMulV2(sprite->region.max, texSize));
+    // Covers the view, wherever the node is
+    RenderParallaxLayer(rc, layer);
+}
 
-    BBox2 dst = src;
+static void RenderNodeTilemap(RenderContext *rc, T2 transform, GameNode *node) {
+    TilemapComponent *tilemap = GetGameNodeComponent(node, TilemapComponent);
+    if (tilemap == NULL) {
+        return;
+    }
 
-    V2 offset = HadamardMulV2(sprite->anchor, GetBBox2Size(src));
-    transform = DotT2(transform, MakeT2FromTranslation(NegV2(offset)));
+    RenderTilemap(rc, transform, tilemap);
+}
 
-    DrawTexture(rc, transform, dst, texture, src, OneV4());
+static void RenderNodeParticleEmitter(RenderContext *rc, GameNode *node) {
+    ParticleEmitterComponent *emitter = GetGameNodeComponent(node, ParticleEmitterComponent);
+    if (emitter == NULL) {
+        return;
+    }
 
-    DestroyTexture(rc, &texture);
+    // Particles are simulated in world space
+    RenderParticleEmitter(rc, emitter);
 }
 
-static void RenderNode(RenderContext *rc, GameNode *node) {
+static void RenderNode(RenderContext *rc, StaticBatches *staticBatches, GameNode *node) {
     T2 transform = GetGameNodeWorldTransform(node);
 
-    RenderSprite(rc, transform, node);
+    RenderNodeParallaxLayer(rc, node);
+    RenderNodeTilemap(rc, transform, node);
+    if (!RenderStaticBatchOfNode(rc, staticBatches, node)) {
+        RenderSprite(rc, transform, node);
+    }
+    RenderNodeParticleEmitter(rc, node);
 
     // Debug draw transform origin in the world space
     DrawRect(rc, transform, MakeBBox2CenSize(MakeV2(0.0f, 0.0f), MakeV2(2.0f, 2.0f)), 0.0f, 0.0f, OneV4(), ZeroV4());
 }
 
-static void Render(GameContext *c) {
+static void CollectNodeLights(RenderContext *rc, LightingPass *pass, GameNode *node) {
+    LightComponent *light = GetGameNodeComponent(node, LightComponent);
+    LightOccluderComponent *occluder = GetGameNodeComponent(node, LightOccluderComponent);
+    if (light == NULL && occluder == NULL) {
+        return;
+    }
+
+    T2 transform = GetGameNodeWorldTransform(node);
+    if (light) {
+        AddLight(pass, light, transform);
+    }
+    if (occluder) {
+        AddLightOccluder(rc, pass, occluder, transform);
+    }
+}
+
+#define BATCH_BREAK_LOG_LINES 8
+
+// Break counts of last frame by reason, followed by the first breaks in order
+static void DrawBatchBreakLog(GameContext *c, float fontSize, float *y) {
     RenderContext *rc = c->rc;
-    int lastDrawCallCount = rc->drawCallCount;
+    const BatchBreakLog *log = GetBatchBreakLog(rc);
+    float lineHeight = GetFontLineHeight(rc, c->font, fontSize);
+    char buf[128];
 
-    ClearDrawing(rc);
+    snprintf(buf, sizeof(buf), "Batch breaks: %d", log->entryCount);
+    DrawLineText(rc, c->font, fontSize, 0.0f, *y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    *y -= lineHeight;
+
+    for (int reason = 0; reason < BATCH_BREAK_REASON_COUNT; ++reason) {
+        if (log->counts[reason] > 0) {
+            snprintf(buf, sizeof(buf), "%s: %d", GetBatchBreakReasonName((BatchBreakReason) reason), log->counts[reason]);
+            DrawLineText(rc, c->font, fontSize, fontSize, *y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+            *y -= lineHeight;
+        }
+    }
+
+    int count = log->entryCount < BATCH_BREAK_LOG_LINES ? log->entryCount : BATCH_BREAK_LOG_LINES;
+    for (int i = 0; i < count; ++i) {
+        const BatchBreak *entry = &log->entries[i];
+        snprintf(buf, sizeof(buf), "#%d before sprite %d: %s", i, entry->spriteIndex, GetBatchBreakReasonName(entry->reason));
+        DrawLineText(rc, c->font, fontSize, fontSize, *y, buf, MakeV4(1.0f, 1.0f, 0.0f, 1.0f));
+        *y -= lineHeight;
+    }
+}
+
+// In virtual resolution mode the world is rendered 1:1 at native game resolution and scaled up afterwards
+// Otherwise it is rendered at window resolution scaled by dynamic resolution
+static T2 GetWorldCamera(GameContext *c) {
+    if (c->isVirtualResolution) {
+        return IdentityT2();
+    }
+    return MakeT2(MakeV2(144.0f, 128.0f), 0.0f, MakeV2(2.0f, 2.0f));
+}
+
+static void ExecuteLightingPass(RenderContext *rc, RenderGraph *graph, void *data) {
+    GameContext *c = data;
 
-    SetCameraTransform(rc, MakeT2(MakeV2(144.0f, 128.0f), 0.0f, MakeV2(2.0f, 2.0f)));
+    BeginLightingPass(c->lighting);
+    for (GameNodeTreeWalker *walker = BeginWalkGameNodeTree(&c->gameNodeTreeWalker, c->rootNode); HasNextGameNode(walker); WalkToNextGameNode(walker)) {
+        CollectNodeLights(rc, c->lighting, walker->node);
+    }
+
+    // Same view as the world pass below, at a lower resolution
+    RenderTarget *target = GetRenderGraphTarget(graph, c->lightResource);
+    if (c->isVirtualResolution) {
+        RenderLightingPass(rc, c->lighting, target, GAME_WIDTH, GAME_HEIGHT, 1.0f, GetWorldCamera(c));
+    } else {
+        RenderLightingPass(rc, c->lighting, target, rc->width, rc->height,
+                           rc->pointToPixel * c->dynamicResolution.scale, GetWorldCamera(c));
+    }
+}
 
+static void ExecuteWorldPass(RenderContext *rc, RenderGraph *graph, void *data) {
+    GameContext *c = data;
+
+    RenderTarget *target = GetRenderGraphTarget(graph, c->worldResource);
+    if (c->isVirtualResolution) {
+        BeginRenderTarget(rc, target);
+    } else {
+        BeginRenderTargetView(rc, target, rc->width, rc->height, rc->pointToPixel * c->dynamicResolution.scale);
+        SetCameraTransform(rc, GetWorldCamera(c));
+    }
+
+    UpdateStaticBatches(rc, c->staticBatches, c->rootNode);
+    SetRenderLayer(rc, "Scene");
     for (GameNodeTreeWalker *walker = BeginWalkGameNodeTree(&c->gameNodeTreeWalker, c->rootNode); HasNextGameNode(walker); WalkToNextGameNode(walker)) {
-        RenderNode(rc, walker->node);
+        RenderNode(rc, c->staticBatches, walker->node);
     }
 
-    DrawRect(rc, IdentityT2(), MakeBBox2(MakeV2(0.0f, 0.0f), MakeV2(144.0f, 256.0f)),
+    SetRenderLayer(rc, "Overlay");
+    DrawPathStroke(rc, IdentityT2(), c->lanePath, &c->laneStyle, MakeV4(1.0f, 1.0f, 1.0f, 0.5f));
+
+    DrawRect(rc, IdentityT2(), MakeBBox2(MakeV2(0.0f, 0.0f), MakeV2(GAME_WIDTH, GAME_HEIGHT)),
              0.0f, 1.0f, ZeroV4(), MakeV4(1.0f, 1.0f, 0.0f, 1.0f));
 
+    if (c->isLightingEnabled) {
+        SetRenderLayer(rc, "Lighting");
+        CompositeLighting(rc, GetRenderGraphTarget(graph, c->lightResource));
+    }
+
+    EndRenderTarget(rc);
+}
+
+static void ExecutePostEffectPass(RenderContext *rc, RenderGraph *graph, void *data) {
+    PostEffectPass *pass = data;
+
+    RenderTarget *source = GetRenderGraphTarget(graph, pass->source);
+    RenderTarget *target = GetRenderGraphTarget(graph, pass->target);
+    if (source && target) {
+        RunPostEffect(rc, pass->chain, pass->effect, source, target);
+    }
+}
+
+static void ExecutePresentPass(RenderContext *rc, RenderGraph *graph, void *data) {
+    GameContext *c = data;
+
+    RenderTarget *presented = GetRenderGraphTarget(graph, c->presentedResource);
+    if (presented == NULL) {
+        return;
+    }
+
+    if (c->isVirtualResolution) {
+        DrawRenderTargetUpscaled(rc, presented);
+    } else {
+        DrawRenderTargetStretched(rc, presented);
+    }
+
+    // Keep the HUD out of debug views so it stays readable
+    ResolveRenderDebugView(rc);
+}
+
+static void ExecuteHUDPass(RenderContext *rc, RenderGraph *graph, void *data) {
+    GameContext *c = data;
+    const LastFrameStats *last = &c->lastFrame;
+
     SetCameraTransform(rc, IdentityT2());
 
     float fontSize = 16.0f;
@@ -219,11 +601,138 @@ static void Render(GameContext *c) {
     DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
     y -= lineHeight;
 
-    snprintf(buf, BUF_SIZE, "Draw calls: %d", lastDrawCallCount);
+    snprintf(buf, BUF_SIZE, "Draw calls: %d", last->drawCallCount);
+    DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    y -= lineHeight;
+
+    if (last->spriteCount > 0) {
+        snprintf(buf, BUF_SIZE, "Sprites: %d, %d B/sprite, %.1f KB in %.3f ms",
+                 last->spriteCount, last->spriteUploadBytes / last->spriteCount,
+                 last->spriteUploadBytes / 1024.0f, last->spriteUploadMs);
+        DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+        y -= lineHeight;
+
+        snprintf(buf, BUF_SIZE, "Trimmed: %.1f K px, paths tessellated: %d",
+                 last->spriteTrimmedPixels / 1000.0f, last->pathTessellationCount);
+        DrawLineText(rc, c->font, fontSize, fontSize, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+        y -= lineHeight;
+    }
+
+    snprintf(buf, BUF_SIZE, "CPU: update %.2f ms, render %.2f ms", c->updateCost * 1000.0f, c->renderCost * 1000.0f);
+    DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    y -= lineHeight;
+
+    if (!c->isVirtualResolution) {
+        snprintf(buf, BUF_SIZE, "Resolution scale: %.2f", c->dynamicResolution.scale);
+        DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+        y -= lineHeight;
+    }
+
+    const RenderTimings *timings = GetRenderTimings(rc);
+    snprintf(buf, BUF_SIZE, "GPU: %.2f ms", timings->gpuMs);
+    DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    y -= lineHeight;
+
+    // Compare with the opaque pass toggled by F2 to see the overdraw it saves
+    snprintf(buf, BUF_SIZE, "Fragments: %.2f M, opaque pass %s", timings->fragmentCount / 1e6,
+             rc->isOpaquePassEnabled ? "on" : "off");
+    DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    y -= lineHeight;
+
+    static const char *debugModeNames[RENDER_DEBUG_MODE_COUNT] = {"off", "overdraw", "batch id"};
+    snprintf(buf, BUF_SIZE, "Debug view (F3): %s", debugModeNames[rc->debugMode]);
+    DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    y -= lineHeight;
+
+    snprintf(buf, BUF_SIZE, "Lighting (F6): %s, %d lights, %d shadowed, %d occluders rebuilt",
+             c->isLightingEnabled ? "on" : "off", last->lightCount, last->shadowedLightCount,
+             c->lighting->rebuiltOccluderCount);
+    DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    y -= lineHeight;
+
+    static const char *postQualityNames[POST_QUALITY_COUNT] = {"off", "low", "medium", "high"};
+    snprintf(buf, BUF_SIZE, "Post quality (F7): %s, %d effects", postQualityNames[c->postProcess->quality],
+             c->postProcess->lastEffectCount);
     DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
     y -= lineHeight;
 
-    // Draw game node tree hierarchy
+    if (c->capture) {
+        snprintf(buf, BUF_SIZE, "Capture (F8): %d frames, dropped %d GPU, %d encoder",
+                 SDL_AtomicGet(&c->capture->writtenFrameCount), c->capture->droppedReadbackCount,
+                 c->capture->droppedEncoderCount);
+    } else {
+        snprintf(buf, BUF_SIZE, "Capture (F8): off");
+    }
+    DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    y -= lineHeight;
+
+    snprintf(buf, BUF_SIZE, "Render graph (F9): %d passes, %d culled, %d transient in %d targets, %d aliased",
+             graph->passCount, graph->culledPassCount, graph->transientCount, graph->targetCount,
+             graph->aliasedCount);
+    DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    y -= lineHeight;
+
+    snprintf(buf, BUF_SIZE, "Static batches: %d for %d nodes, rebuilt %d times", c->staticBatches->batchCount,
+             c->staticBatches->nodeCount, c->staticBatches->rebuildCount);
+    DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    y -= lineHeight;
+
+    const RenderOnDemand *rod = &c->renderOnDemand;
+    snprintf(buf, BUF_SIZE, "Render on demand (F4): %s, %d skipped, idle %.1f s%s", rod->isEnabled ? "on" : "off",
+             rod->skippedFrameCount, rod->idleSeconds, c->isPaused ? ", paused (F5)" : "");
+    DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    y -= lineHeight;
+
+    for (int i = 0; i < timings->passCount; ++i) {
+        const RenderPassTiming *pass = &timings->passes[i];
+        if (pass->gpuMs < 0.0f) {
+            snprintf(buf, BUF_SIZE, "%s: out of timer queries, %d draws", pass->name, pass->drawCallCount);
+        } else {
+            snprintf(buf, BUF_SIZE, "%s: %.2f ms, %d draws", pass->name, pass->gpuMs, pass->drawCallCount);
+        }
+        DrawLineText(rc, c->font, fontSize, fontSize, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+        y -= lineHeight;
+
+        for (int layer = 0; layer < pass->layerCount; ++layer) {
+            snprintf(buf, BUF_SIZE, "[%s]: %.2f ms", pass->layers[layer].name, pass->layers[layer].gpuMs);
+            DrawLineText(rc, c->font, fontSize, 2.0f * fontSize, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+            y -= lineHeight;
+        }
+
+        for (int program = 0; program < RENDER_PROGRAM_COUNT; ++program) {
+            if (pass->programGPUMs[program] > 0.0f) {
+                snprintf(buf, BUF_SIZE, "%s: %.2f ms", GetRenderProgramName((RenderProgramKind) program), pass->programGPUMs[program]);
+                DrawLineText(rc, c->font, fontSize, 2.0f * fontSize, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+                y -= lineHeight;
+            }
+        }
+    }
+
+    if (rc->debugMode != RENDER_DEBUG_MODE_NONE) {
+        DrawBatchBreakLog(c, fontSize, &y);
+    }
+
+    snprintf(buf, BUF_SIZE, "Clip flushes: %d, node hierarchy scrolled by the mouse wheel", last->clipFlushCount);
+    DrawLineText(rc, c->font, fontSize, 0.0f, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
+    y -= lineHeight;
+
+    // Draw game node tree hierarchy in a panel filling the rest of the window, scrolled by whole lines
+    float panelTop = y + ascent;
+    int nodeCount = 0;
+    for (GameNodeTreeWalker *walker = BeginWalkGameNodeTree(&c->gameNodeTreeWalker, c->rootNode); HasNextGameNode(walker); WalkToNextGameNode(walker)) {
+        nodeCount++;
+    }
+    int visibleLineCount = (int) (panelTop / lineHeight);
+    if (c->hierarchyScroll > nodeCount - visibleLineCount) {
+        c->hierarchyScroll = nodeCount - visibleLineCount;
+    }
+    if (c->hierarchyScroll < 0) {
+        c->hierarchyScroll = 0;
+    }
+    y += c->hierarchyScroll * lineHeight;
+
+    // Axis aligned, so the lines stay in the batch of the text above
+    PushClipRect(rc, IdentityT2(), MakeBBox2(ZeroV2(), MakeV2(rc->width, panelTop)));
     for (GameNodeTreeWalker *walker = BeginWalkGameNodeTree(&c->gameNodeTreeWalker, c->rootNode); HasNextGameNode(walker); WalkToNextGameNode(walker)) {
         GameNode *node = walker->node;
         float indent = (walker->level - 1) * fontSize;
@@ -231,6 +740,124 @@ static void Render(GameContext *c) {
         DrawLineText(rc, c->font, fontSize, indent, y, buf, MakeV4(1.0f, 1.0f, 1.0f, 1.0f));
         y -= lineHeight;
     }
+    PopClipRect(rc);
+}
+
+static void Render(GameContext *c) {
+    RenderContext *rc = c->rc;
+    LastFrameStats *last = &c->lastFrame;
+    last->drawCallCount = rc->drawCallCount;
+    last->spriteCount = rc->spriteCount;
+    last->spriteUploadBytes = rc->spriteUploadBytes;
+    last->spriteUploadMs = rc->spriteUploadMs;
+    last->spriteTrimmedPixels = rc->spriteTrimmedPixels;
+    last->pathTessellationCount = rc->pathTessellationCount;
+    last->lightCount = rc->lightCount;
+    last->shadowedLightCount = rc->shadowedLightCount;
+    last->clipFlushCount = rc->clipFlushCount;
+
+    ClearDrawing(rc);
+
+    RenderGraph *graph = c->renderGraph;
+    BeginRenderGraph(graph);
+
+    // Filtered, so the upscaled light stays smooth
+    c->lightResource = CreateRenderGraphTarget(graph, "Light", c->lighting->width, c->lighting->height,
+                                               TEXTURE_FILTER_LINEAR);
+    int worldWidth = GAME_WIDTH;
+    int worldHeight = GAME_HEIGHT;
+    TextureFilter worldFilter = TEXTURE_FILTER_NEAREST;
+    if (!c->isVirtualResolution) {
+        // Sized for the largest scale, lower scales render into a part of it
+        float pointToPixel = c->window->pointToPixel * MAX_RESOLUTION_SCALE;
+        worldWidth = (int) CeilF(WINDOW_WIDTH * pointToPixel);
+        worldHeight = (int) CeilF(WINDOW_HEIGHT * pointToPixel);
+        worldFilter = TEXTURE_FILTER_LINEAR;
+    }
+    c->worldResource = CreateRenderGraphTarget(graph, "World", worldWidth, worldHeight, worldFilter);
+    // Only orders the passes
+    RenderGraphResource windowResource = ImportRenderGraphTarget(graph, "Window", NULL);
+    MarkRenderGraphOutput(graph, windowResource);
+
+    // Culled when lighting is disabled, since nothing reads the light target then
+    int pass = AddRenderGraphPass(graph, "Lighting", RENDER_GRAPH_PASS_NONE, ExecuteLightingPass, c);
+    WriteRenderGraphResource(graph, pass, c->lightResource);
+
+    pass = AddRenderGraphPass(graph, "World", RENDER_GRAPH_PASS_NONE, ExecuteWorldPass, c);
+    if (c->isLightingEnabled) {
+        ReadRenderGraphResource(graph, pass, c->lightResource);
+    }
+    WriteRenderGraphResource(graph, pass, c->worldResource);
+
+    // Each effect is timed as a pass of its own. Its result is dead once the next effect has read it, so the effect
+    // after that one writes into the same target. Debug views show what was drawn, not the post-processed result.
+    BeginPostProcessChain(rc, c->postProcess);
+    c->presentedResource = c->worldResource;
+    for (int i = 0; i < c->postProcess->effectCount && rc->debugMode == RENDER_DEBUG_MODE_NONE; ++i) {
+        const PostEffect *effect = &c->postProcess->effects[i];
+        if (!IsPostEffectActive(c->postProcess, effect)) {
+            continue;
+        }
+
+        PostEffectPass *effectPass = &c->postEffectPasses[i];
+        effectPass->chain = c->postProcess;
+        effectPass->effect = effect;
+        effectPass->source = c->presentedResource;
+        effectPass->target = CreateRenderGraphTarget(graph, effect->name, worldWidth, worldHeight, worldFilter);
+
+        pass = AddRenderGraphPass(graph, effect->name, RENDER_GRAPH_PASS_NONE, ExecutePostEffectPass, effectPass);
+        ReadRenderGraphResource(graph, pass, effectPass->source);
+        WriteRenderGraphResource(graph, pass, effectPass->target);
+        c->presentedResource = effectPass->target;
+    }
+
+    pass = AddRenderGraphPass(graph, "Present", RENDER_GRAPH_PASS_NONE, ExecutePresentPass, c);
+    ReadRenderGraphResource(graph, pass, c->presentedResource);
+    WriteRenderGraphResource(graph, pass, windowResource);
+
+    pass = AddRenderGraphPass(graph, "HUD", RENDER_GRAPH_PASS_NONE, ExecuteHUDPass, c);
+    WriteRenderGraphResource(graph, pass, windowResource);
+
+    CompileRenderGraph(rc, graph);
+    ExecuteRenderGraph(rc, graph);
+
+    if (c->isRenderGraphDumpRequested) {
+        DumpRenderGraph(rc, graph, stdout);
+        c->isRenderGraphDumpRequested = 0;
+    }
+
+    EndDrawing(rc);
+}
+
+static void DumpFrameTimings(GameContext *c, int frameIndex) {
+    FILE *file = c->timingsDumpFile;
+    if (file == NULL) {
+        return;
+    }
+
+    // GPU timings lag behind CPU timings, so they carry their own frame index
+    const RenderTimings *timings = GetRenderTimings(c->rc);
+    fprintf(file, "{\"frame\":%d,\"cpuUpdateMs\":%.4f,\"cpuRenderMs\":%.4f,"
+                  "\"sprites\":%d,\"spriteUploadBytes\":%d,\"spriteUploadMs\":%.4f,\"spriteTrimmedPixels\":%.0f,"
+                  "\"skippedFrames\":%d,\"gpuFrame\":%d,\"gpuMs\":%.4f,\"gpuFragments\":%llu,\"gpuDroppedFrames\":%d,\"passes\":[",
+            frameIndex, c->updateCost * 1000.0f, c->renderCost * 1000.0f,
+            c->rc->spriteCount, c->rc->spriteUploadBytes, c->rc->spriteUploadMs, c->rc->spriteTrimmedPixels,
+            c->renderOnDemand.skippedFrameCount, timings->frameIndex, timings->gpuMs, (unsigned long long) timings->fragmentCount, timings->droppedFrameCount);
+    for (int i = 0; i < timings->passCount; ++i) {
+        const RenderPassTiming *pass = &timings->passes[i];
+        fprintf(file, "%s{\"name\":\"%s\",\"gpuMs\":%.4f,\"drawCalls\":%d,\"programs\":{",
+                i > 0 ? "," : "", pass->name, pass->gpuMs, pass->drawCallCount);
+        for (int program = 0; program < RENDER_PROGRAM_COUNT; ++program) {
+            fprintf(file, "%s\"%s\":%.4f", program > 0 ? "," : "",
+                    GetRenderProgramName((RenderProgramKind) program), pass->programGPUMs[program]);
+        }
+        fprintf(file, "},\"layers\":{");
+        for (int layer = 0; layer < pass->layerCount; ++layer) {
+            fprintf(file, "%s\"%s\":%.4f", layer > 0 ? "," : "", pass->layers[layer].name, pass->layers[layer].gpuMs);
+        }
+        fprintf(file, "}}");
+    }
+    fprintf(file, "]}\n");
 }
 
 static int RunMainLoop(GameContext *c) {
@@ -238,28 +865,148 @@ static int RunMainLoop(GameContext *c) {
 
     InitFPSCounter(&c->fpsCounter);
     Tick lastUpdate = GetCurrentTick();
+    int frameIndex = 0;
     while (c->isRunning) {
         ProcessSystemEvent(c);
 
         Tick now = GetCurrentTick();
         float delta = TickToSecond(now - lastUpdate);
         lastUpdate = now;
-        Update(c, delta);
+        if (!c->isPaused) {
+            Update(c, delta);
+        }
+
+        Tick updated = GetCurrentTick();
+        c->updateCost = TickToSecond(updated - now);
+
+        SetRenderOnDemandScene(&c->renderOnDemand, HashGameScene(c));
+        int timeoutMs = 0;
+        if (!ShouldRenderFrame(&c->renderOnDemand, &timeoutMs)) {
+            // Leave the event in the queue for ProcessSystemEvent
+            SDL_WaitEventTimeout(NULL, timeoutMs);
+            CountSkippedFrame(&c->renderOnDemand, TickToSecond(GetCurrentTick() - updated));
+            continue;
+        }
 
         Render(c);
+        c->renderCost = TickToSecond(GetCurrentTick() - updated);
+
+        // Frame time includes waiting for vsync, so the cost is the larger of CPU work and GPU time
+        float cpuCost = c->updateCost + c->renderCost;
+        float gpuCost = GetRenderTimings(c->rc)->gpuMs / 1000.0f;
+        UpdateDynamicResolution(&c->dynamicResolution, cpuCost > gpuCost ? cpuCost : gpuCost);
+
+        DumpFrameTimings(c, frameIndex++);
+
+        if (c->capture) {
+            CaptureFrame(c->rc, c->capture);
+        }
+
         SwapWindowBuffers(c->window);
         CountOneFrame(&c->fpsCounter);
+        CountRenderedFrame(&c->renderOnDemand);
+    }
+
+    if (c->timingsDumpFile) {
+        fclose(c->timingsDumpFile);
+    }
+
+    if (c->capture) {
+        StopFrameCapture(c->rc, &c->capture);
     }
 
     return 0;
 }
 
-int main(int argc, char *argv[]) {
-    (void)argc; (void)argv;
+// Render the scene once at native game resolution with the software renderer and save it, without a window or GL
+static int RenderThumbnail(GameContext *c, const char *filename) {
+    SDL_Init(0);
+
+    c->rc = CreateSoftwareRenderContext(GAME_WIDTH, GAME_HEIGHT, 0);
+    LoadGameNodes(c);
+    c->staticBatches = CreateStaticBatches();
+
+    ClearDrawing(c->rc);
+    UpdateStaticBatches(c->rc, c->staticBatches, c->rootNode);
+    for (GameNodeTreeWalker *walker = BeginWalkGameNodeTree(&c->gameNodeTreeWalker, c->rootNode); HasNextGameNode(walker); WalkToNextGameNode(walker)) {
+        RenderNode(c->rc, c->staticBatches, walker->node);
+    }
+    EndDrawing(c->rc);
+
+    const RenderTimings *timings = GetRenderTimings(c->rc);
+    printf("Thumbnail rasterized in %.2f ms, %llu fragments\n", timings->gpuMs, (unsigned long long) timings->fragmentCount);
+
+    return SaveImageToTGA(filename, GAME_WIDTH, GAME_HEIGHT, GAME_WIDTH * 4, GetSoftwareFramebuffer(c->rc)) ? 0 : 1;
+}
+
+#define SPRITE_BENCHMARK_REPEAT_COUNT 20
+
+// Compare the vertex layouts of sprites on the GL driver of this machine, then exit
+static int RunSpriteUploadBenchmark(GameContext *c, int spriteCount) {
+    SDL_Init(0);
+
+    c->window = CreateGameWindow("Flappy Bird", WINDOW_WIDTH, WINDOW_HEIGHT);
+    c->rc = CreateRenderContext(WINDOW_WIDTH, WINDOW_HEIGHT, c->window->pointToPixel, NULL);
+
+    SpriteUploadBenchmark results[SPRITE_UPLOAD_BENCHMARK_LAYOUT_COUNT];
+    BenchmarkSpriteUpload(c->rc, spriteCount, SPRITE_BENCHMARK_REPEAT_COUNT, results);
 
+    printf("%d sprites, averaged over %d fills and uploads\n", spriteCount, SPRITE_BENCHMARK_REPEAT_COUNT);
+    for (int i = 0; i < SPRITE_UPLOAD_BENCHMARK_LAYOUT_COUNT; ++i) {
+        const SpriteUploadBenchmark *result = &results[i];
+        printf("%-6s: %3d B/sprite, fill %.2f ns/sprite, upload %.1f MB/s\n", result->layout, result->bytesPerSprite,
+               result->fillNsPerSprite, result->uploadMBPerSecond);
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
     GameContext *context = malloc(sizeof(GameContext));
+    context->updateCost = 0.0f;
+    context->renderCost = 0.0f;
+    context->timingsDumpFile = NULL;
+    context->capture = NULL;
+    context->capturePath = "capture";
+    context->captureFormat = CAPTURE_FORMAT_PNG;
+    int isCapturing = 0;
+    const char *thumbnailFilename = NULL;
+    int benchmarkSpriteCount = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--dump-timings") == 0 && i + 1 < argc) {
+            const char *filename = argv[++i];
+            context->timingsDumpFile = fopen(filename, "w");
+            if (context->timingsDumpFile == NULL) {
+                printf("Failed to open timings dump file: %s\n", filename);
+            }
+        } else if (strcmp(argv[i], "--thumbnail") == 0 && i + 1 < argc) {
+            thumbnailFilename = argv[++i];
+        } else if (strcmp(argv[i], "--bench-sprites") == 0 && i + 1 < argc) {
+            benchmarkSpriteCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            // Record from the first frame, into raw frames if the path ends with .raw
+            context->capturePath = argv[++i];
+            size_t length = strlen(context->capturePath);
+            if (length >= 4 && strcmp(context->capturePath + length - 4, ".raw") == 0) {
+                context->captureFormat = CAPTURE_FORMAT_RAW;
+            }
+            isCapturing = 1;
+        }
+    }
+
+    if (thumbnailFilename) {
+        return RenderThumbnail(context, thumbnailFilename);
+    }
+    if (benchmarkSpriteCount > 0) {
+        return RunSpriteUploadBenchmark(context, benchmarkSpriteCount);
+    }
 
     SetupGame(context);
 
+    if (isCapturing) {
+        context->capture = StartFrameCapture(context->rc, context->capturePath, context->captureFormat);
+    }
+
     return RunMainLoop(context);
 }
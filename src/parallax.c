@@ -0,0 +1,62 @@
+#include "parallax.h"
+
+#include <math.h>
+
+extern ParallaxLayerComponent *CreateParallaxLayerComponent(const char *texturePath, V2 factor) {
+    ParallaxLayerComponent *layer = malloc(sizeof(ParallaxLayerComponent));
+    layer->texturePath = texturePath;
+    layer->factor = factor;
+    layer->tileSize = ZeroV2();
+    layer->velocity = ZeroV2();
+    layer->color = OneV4();
+    layer->scroll = ZeroV2();
+    layer->texture = NULL;
+    return layer;
+}
+
+extern void DestroyParallaxLayerComponent(RenderContext *rc, ParallaxLayerComponent **ptr) {
+    ParallaxLayerComponent *layer = *ptr;
+
+    if (layer->texture) {
+        DestroyTexture(rc, &layer->texture);
+    }
+    free(layer);
+
+    *ptr = NULL;
+}
+
+static V2 GetParallaxTileSize(ParallaxLayerComponent *layer) {
+    if (layer->tileSize.x > 0.0f && layer->tileSize.y > 0.0f) {
+        return layer->tileSize;
+    }
+    if (layer->texture) {
+        return MakeV2((F) layer->texture->width, (F) layer->texture->height);
+    }
+    return ZeroV2();
+}
+
+extern void UpdateParallaxLayer(ParallaxLayerComponent *layer, F delta) {
+    layer->scroll = AddV2(layer->scroll, MulV2(delta, layer->velocity));
+
+    // Whole tiles don't change the picture, dropping them keeps precision
+    V2 tileSize = GetParallaxTileSize(layer);
+    if (tileSize.x > 0.0f && tileSize.y > 0.0f) {
+        layer->scroll = MakeV2(fmodf(layer->scroll.x, tileSize.x), fmodf(layer->scroll.y, tileSize.y));
+    }
+}
+
+extern void RenderParallaxLayer(RenderContext *rc, ParallaxLayerComponent *layer) {
+    if (layer->texture == NULL) {
+        layer->texture = LoadTexture(rc, layer->texturePath);
+        if (layer->texture == NULL) {
+            return;
+        }
+    }
+
+    // The layer moves by factor times what the camera moves, so a tile corner sits at camera * (1 - factor)
+    BBox2 view = GetViewBBox2(rc, IdentityT2());
+    V2 camera = MulV2(0.5f, AddV2(view.min, view.max));
+    V2 origin = AddV2(HadamardMulV2(camera, SubV2(OneV2(), layer->factor)), layer->scroll);
+
+    DrawTextureRepeated(rc, layer->texture, GetParallaxTileSize(layer), origin, layer->color);
+}
@@ -0,0 +1,30 @@
+#ifndef RTD_PARALLAX_H
+#define RTD_PARALLAX_H
+
+#include "cgmath.h"
+#include "renderer.h"
+
+// Layer of a texture repeated endlessly behind or in front of the world, drawn as one quad covering the view
+// whatever the size of the world. The transform of its node is not used.
+typedef struct ParallaxLayerComponent {
+    const char *texturePath;
+    // How much the layer follows the camera on each axis. 1 scrolls with the world, 0 stays fixed on screen and
+    // values in between are for layers in the distance.
+    V2 factor;
+    // Size of one repetition in world points, the size of the texture if zero
+    V2 tileSize;
+    // Points per second the layer scrolls by itself, e.g. clouds
+    V2 velocity;
+    V4 color;
+
+    // Offset accumulated from velocity, wrapped into one tile
+    V2 scroll;
+    Texture *texture;
+} ParallaxLayerComponent;
+
+extern ParallaxLayerComponent *CreateParallaxLayerComponent(const char *texturePath, V2 factor);
+extern void DestroyParallaxLayerComponent(RenderContext *rc, ParallaxLayerComponent **layer);
+extern void UpdateParallaxLayer(ParallaxLayerComponent *layer, F delta);
+extern void RenderParallaxLayer(RenderContext *rc, ParallaxLayerComponent *layer);
+
+#endif // RTD_PARALLAX_H
@@ -0,0 +1,251 @@
+#include "particle.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define PARTICLE_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+#define PARTICLE_POOL_ARRAY_COUNT 10
+#define PARTICLE_POOL_ALIGNMENT 32
+
+static void InitParticlePool(ParticlePool *pool, int maxParticles) {
+    int capacity = (maxParticles + PARTICLE_POOL_LANES - 1) / PARTICLE_POOL_LANES * PARTICLE_POOL_LANES;
+    size_t arraySize = sizeof(F) * capacity;
+
+    pool->count = 0;
+    pool->capacity = capacity;
+    pool->memory = calloc(1, arraySize * PARTICLE_POOL_ARRAY_COUNT + PARTICLE_POOL_ALIGNMENT);
+
+    // arraySize is multiple of 32 bytes, so every array starts at an aligned address
+    unsigned char *base = (unsigned char *) (((uintptr_t) pool->memory + PARTICLE_POOL_ALIGNMENT - 1) &
+                                             ~(uintptr_t) (PARTICLE_POOL_ALIGNMENT - 1));
+    F **arrays[PARTICLE_POOL_ARRAY_COUNT] = {
+        &pool->posX, &pool->posY, &pool->velX, &pool->velY, &pool->life,
+        &pool->colorR, &pool->colorG, &pool->colorB, &pool->colorA, &pool->size,
+    };
+    for (int i = 0; i < PARTICLE_POOL_ARRAY_COUNT; ++i) {
+        *arrays[i] = (F *) (base + arraySize * i);
+    }
+}
+
+extern ParticleEmitterComponent *CreateParticleEmitterComponent(const char *texturePath, int maxParticles) {
+    assert(maxParticles > 0);
+
+    ParticleEmitterComponent *emitter = malloc(sizeof(ParticleEmitterComponent));
+    emitter->texturePath = texturePath;
+    emitter->emitRate = 0.0f;
+    emitter->lifetime = 1.0f;
+    emitter->lifetimeVariance = 0.0f;
+    emitter->velocity = ZeroV2();
+    emitter->velocityVariance = ZeroV2();
+    emitter->gravity = ZeroV2();
+    emitter->startColor = OneV4();
+    emitter->colorVelocity = ZeroV4();
+    emitter->startSize = 1.0f;
+    emitter->sizeVelocity = 0.0f;
+    emitter->emitAccumulator = 0.0f;
+    emitter->randomState = 0x9E3779B9u;
+    emitter->texture = NULL;
+
+    InitParticlePool(&emitter->pool, maxParticles);
+
+    return emitter;
+}
+
+extern void DestroyParticleEmitterComponent(RenderContext *rc, ParticleEmitterComponent **ptr) {
+    ParticleEmitterComponent *emitter = *ptr;
+
+    if (emitter->texture) {
+        DestroyTexture(rc, &emitter->texture);
+    }
+
+    free(emitter->pool.memory);
+    free(emitter);
+
+    *ptr = NULL;
+}
+
+// Return a random number in [-1, 1] using xorshift32
+static inline F NextParticleRandom(ParticleEmitterComponent *emitter) {
+    uint32_t x = emitter->randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    emitter->randomState = x;
+    return (F) (x >> 8) / (F) (1 << 23) - 1.0f;
+}
+
+static void EmitParticles(ParticleEmitterComponent *emitter, V2 origin, F delta) {
+    ParticlePool *pool = &emitter->pool;
+
+    emitter->emitAccumulator += emitter->emitRate * delta;
+    int n = (int) emitter->emitAccumulator;
+    emitter->emitAccumulator -= n;
+
+    if (n > pool->capacity - pool->count) {
+        n = pool->capacity - pool->count;
+    }
+
+    for (int i = pool->count; i < pool->count + n; ++i) {
+        pool->posX[i] = origin.x;
+        pool->posY[i] = origin.y;
+        pool->velX[i] = emitter->velocity.x + emitter->velocityVariance.x * NextParticleRandom(emitter);
+        pool->velY[i] = emitter->velocity.y + emitter->velocityVariance.y * NextParticleRandom(emitter);
+        pool->life[i] = emitter->lifetime + emitter->lifetimeVariance * NextParticleRandom(emitter);
+        pool->colorR[i] = emitter->startColor.r;
+        pool->colorG[i] = emitter->startColor.g;
+        pool->colorB[i] = emitter->startColor.b;
+        pool->colorA[i] = emitter->startColor.a;
+        pool->size[i] = emitter->startSize;
+    }
+
+    pool->count += n;
+}
+
+#if defined(__AVX__)
+
+static void IntegrateParticles(ParticleEmitterComponent *emitter, F delta) {
+    ParticlePool *pool = &emitter->pool;
+
+    __m256 dt = _mm256_set1_ps(delta);
+    __m256 zero = _mm256_setzero_ps();
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 gravityX = _mm256_set1_ps(emitter->gravity.x * delta);
+    __m256 gravityY = _mm256_set1_ps(emitter->gravity.y * delta);
+    __m256 dr = _mm256_set1_ps(emitter->colorVelocity.r * delta);
+    __m256 dg = _mm256_set1_ps(emitter->colorVelocity.g * delta);
+    __m256 db = _mm256_set1_ps(emitter->colorVelocity.b * delta);
+    __m256 da = _mm256_set1_ps(emitter->colorVelocity.a * delta);
+    __m256 ds = _mm256_set1_ps(emitter->sizeVelocity * delta);
+
+    for (int i = 0; i < pool->count; i += 8) {
+        __m256 velX = _mm256_add_ps(_mm256_load_ps(pool->velX + i), gravityX);
+        __m256 velY = _mm256_add_ps(_mm256_load_ps(pool->velY + i), gravityY);
+        _mm256_store_ps(pool->velX + i, velX);
+        _mm256_store_ps(pool->velY + i, velY);
+        _mm256_store_ps(pool->posX + i, _mm256_add_ps(_mm256_load_ps(pool->posX + i), _mm256_mul_ps(velX, dt)));
+        _mm256_store_ps(pool->posY + i, _mm256_add_ps(_mm256_load_ps(pool->posY + i), _mm256_mul_ps(velY, dt)));
+        _mm256_store_ps(pool->life + i, _mm256_sub_ps(_mm256_load_ps(pool->life + i), dt));
+        _mm256_store_ps(pool->colorR + i, _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_load_ps(pool->colorR + i), dr), zero), one));
+        _mm256_store_ps(pool->colorG + i, _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_load_ps(pool->colorG + i), dg), zero), one));
+        _mm256_store_ps(pool->colorB + i, _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_load_ps(pool->colorB + i), db), zero), one));
+        _mm256_store_ps(pool->colorA + i, _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_load_ps(pool->colorA + i), da), zero), one));
+        _mm256_store_ps(pool->size + i, _mm256_max_ps(_mm256_add_ps(_mm256_load_ps(pool->size + i), ds), zero));
+    }
+}
+
+#elif defined(PARTICLE_USE_SSE)
+
+static void IntegrateParticles(ParticleEmitterComponent *emitter, F delta) {
+    ParticlePool *pool = &emitter->pool;
+
+    __m128 dt = _mm_set1_ps(delta);
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 gravityX = _mm_set1_ps(emitter->gravity.x * delta);
+    __m128 gravityY = _mm_set1_ps(emitter->gravity.y * delta);
+    __m128 dr = _mm_set1_ps(emitter->colorVelocity.r * delta);
+    __m128 dg = _mm_set1_ps(emitter->colorVelocity.g * delta);
+    __m128 db = _mm_set1_ps(emitter->colorVelocity.b * delta);
+    __m128 da = _mm_set1_ps(emitter->colorVelocity.a * delta);
+    __m128 ds = _mm_set1_ps(emitter->sizeVelocity * delta);
+
+    for (int i = 0; i < pool->count; i += 4) {
+        __m128 velX = _mm_add_ps(_mm_load_ps(pool->velX + i), gravityX);
+        __m128 velY = _mm_add_ps(_mm_load_ps(pool->velY + i), gravityY);
+        _mm_store_ps(pool->velX + i, velX);
+        _mm_store_ps(pool->velY + i, velY);
+        _mm_store_ps(pool->posX + i, _mm_add_ps(_mm_load_ps(pool->posX + i), _mm_mul_ps(velX, dt)));
+        _mm_store_ps(pool->posY + i, _mm_add_ps(_mm_load_ps(pool->posY + i), _mm_mul_ps(velY, dt)));
+        _mm_store_ps(pool->life + i, _mm_sub_ps(_mm_load_ps(pool->life + i), dt));
+        _mm_store_ps(pool->colorR + i, _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_load_ps(pool->colorR + i), dr), zero), one));
+        _mm_store_ps(pool->colorG + i, _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_load_ps(pool->colorG + i), dg), zero), one));
+        _mm_store_ps(pool->colorB + i, _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_load_ps(pool->colorB + i), db), zero), one));
+        _mm_store_ps(pool->colorA + i, _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_load_ps(pool->colorA + i), da), zero), one));
+        _mm_store_ps(pool->size + i, _mm_max_ps(_mm_add_ps(_mm_load_ps(pool->size + i), ds), zero));
+    }
+}
+
+#else
+
+static void IntegrateParticles(ParticleEmitterComponent *emitter, F delta) {
+    ParticlePool *pool = &emitter->pool;
+
+    for (int i = 0; i < pool->count; ++i) {
+        pool->velX[i] += emitter->gravity.x * delta;
+        pool->velY[i] += emitter->gravity.y * delta;
+        pool->posX[i] += pool->velX[i] * delta;
+        pool->posY[i] += pool->velY[i] * delta;
+        pool->life[i] -= delta;
+        pool->colorR[i] = Clamp01F(pool->colorR[i] + emitter->colorVelocity.r * delta);
+        pool->colorG[i] = Clamp01F(pool->colorG[i] + emitter->colorVelocity.g * delta);
+        pool->colorB[i] = Clamp01F(pool->colorB[i] + emitter->colorVelocity.b * delta);
+        pool->colorA[i] = Clamp01F(pool->colorA[i] + emitter->colorVelocity.a * delta);
+        pool->size[i] = pool->size[i] + emitter->sizeVelocity * delta;
+        if (pool->size[i] < 0.0f) {
+            pool->size[i] = 0.0f;
+        }
+    }
+}
+
+#endif
+
+// Remove dead particles by moving the last alive particle into their slot
+static void CompactParticlePool(ParticlePool *pool) {
+    int i = 0;
+    while (i < pool->count) {
+        if (pool->life[i] > 0.0f) {
+            ++i;
+            continue;
+        }
+
+        int last = --pool->count;
+        pool->posX[i] = pool->posX[last];
+        pool->posY[i] = pool->posY[last];
+        pool->velX[i] = pool->velX[last];
+        pool->velY[i] = pool->velY[last];
+        pool->life[i] = pool->life[last];
+        pool->colorR[i] = pool->colorR[last];
+        pool->colorG[i] = pool->colorG[last];
+        pool->colorB[i] = pool->colorB[last];
+        pool->colorA[i] = pool->colorA[last];
+        pool->size[i] = pool->size[last];
+    }
+}
+
+extern void UpdateParticleEmitter(ParticleEmitterComponent *emitter, T2 transform, F delta) {
+    IntegrateParticles(emitter, delta);
+    CompactParticlePool(&emitter->pool);
+    EmitParticles(emitter, transform.origin, delta);
+}
+
+extern void RenderParticleEmitter(RenderContext *rc, ParticleEmitterComponent *emitter) {
+    ParticlePool *pool = &emitter->pool;
+    if (pool->count == 0) {
+        return;
+    }
+
+    if (emitter->texture == NULL) {
+        emitter->texture = LoadTexture(rc, emitter->texturePath);
+        if (emitter->texture == NULL) {
+            return;
+        }
+    }
+
+    ParticleInstances instances;
+    instances.count = pool->count;
+    instances.posX = pool->posX;
+    instances.posY = pool->posY;
+    instances.size = pool->size;
+    instances.colorR = pool->colorR;
+    instances.colorG = pool->colorG;
+    instances.colorB = pool->colorB;
+    instances.colorA = pool->colorA;
+
+    DrawParticles(rc, emitter->texture, &instances);
+}
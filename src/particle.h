@@ -0,0 +1,62 @@
+#ifndef RTD_PARTICLE_H
+#define RTD_PARTICLE_H
+
+#include <stdint.h>
+
+#include "cgmath.h"
+#include "renderer.h"
+
+// Capacity of particle pools is rounded up to multiple of this, so SIMD kernels never need a scalar tail
+#define PARTICLE_POOL_LANES 8
+
+// Structure of arrays of alive particles, the first count elements of each array are valid
+typedef struct ParticlePool {
+    int count;
+    int capacity;
+    F *posX;
+    F *posY;
+    F *velX;
+    F *velY;
+    // Remaining life in seconds
+    F *life;
+    F *colorR;
+    F *colorG;
+    F *colorB;
+    F *colorA;
+    F *size;
+    // Allocation backing all the arrays above
+    void *memory;
+} ParticlePool;
+
+typedef struct ParticleEmitterComponent {
+    const char *texturePath;
+
+    // Particles emitted per second
+    F emitRate;
+    // Life in seconds of new particles is lifetime +/- lifetimeVariance
+    F lifetime;
+    F lifetimeVariance;
+    // Velocity of new particles is velocity +/- velocityVariance for each axis
+    V2 velocity;
+    V2 velocityVariance;
+    V2 gravity;
+    V4 startColor;
+    // Change of color per second, results are clamped into [0, 1]
+    V4 colorVelocity;
+    F startSize;
+    // Change of size per second, results are clamped to be non-negative
+    F sizeVelocity;
+
+    F emitAccumulator;
+    uint32_t randomState;
+    ParticlePool pool;
+    Texture *texture;
+} ParticleEmitterComponent;
+
+extern ParticleEmitterComponent *CreateParticleEmitterComponent(const char *texturePath, int maxParticles);
+extern void DestroyParticleEmitterComponent(RenderContext *rc, ParticleEmitterComponent **emitter);
+// Emit new particles at the origin of transform, integrate all particles and remove dead ones
+extern void UpdateParticleEmitter(ParticleEmitterComponent *emitter, T2 transform, F delta);
+extern void RenderParticleEmitter(RenderContext *rc, ParticleEmitterComponent *emitter);
+
+#endif // RTD_PARTICLE_H
@@ -0,0 +1,451 @@
+#include "path.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Curves and arcs are never split into more segments than this
+#define PATH_MAX_SEGMENTS 256
+
+extern Path *CreatePath(void) {
+    Path *path = malloc(sizeof(Path));
+    path->commandCount = 0;
+    path->commandCapacity = 0;
+    path->commands = NULL;
+    ClearPath(path);
+    return path;
+}
+
+extern void DestroyPath(Path **ptr) {
+    Path *path = *ptr;
+
+    free(path->commands);
+    free(path);
+
+    *ptr = NULL;
+}
+
+extern void ClearPath(Path *path) {
+    path->commandCount = 0;
+    // FNV-1a offset basis
+    path->hash = 0xCBF29CE484222325ull;
+}
+
+static void AddPathCommand(Path *path, PathCommandKind kind, V2 p0, V2 p1, V2 p2) {
+    if (path->commandCount == path->commandCapacity) {
+        path->commandCapacity = path->commandCapacity * 2 + 16;
+        path->commands = realloc(path->commands, sizeof(PathCommand) * path->commandCapacity);
+    }
+
+    PathCommand *command = &path->commands[path->commandCount++];
+    memset(command, 0, sizeof(PathCommand));
+    command->kind = kind;
+    command->points[0] = p0;
+    command->points[1] = p1;
+    command->points[2] = p2;
+
+    // FNV-1a over the bytes of the command
+    const unsigned char *bytes = (const unsigned char *) command;
+    for (size_t i = 0; i < sizeof(PathCommand); ++i) {
+        path->hash ^= bytes[i];
+        path->hash *= 0x100000001B3ull;
+    }
+}
+
+extern void MovePathTo(Path *path, V2 p) {
+    AddPathCommand(path, PATH_COMMAND_MOVE, p, ZeroV2(), ZeroV2());
+}
+
+extern void LinePathTo(Path *path, V2 p) {
+    AddPathCommand(path, PATH_COMMAND_LINE, p, ZeroV2(), ZeroV2());
+}
+
+extern void QuadPathTo(Path *path, V2 c, V2 p) {
+    AddPathCommand(path, PATH_COMMAND_QUAD, c, p, ZeroV2());
+}
+
+extern void CubicPathTo(Path *path, V2 c1, V2 c2, V2 p) {
+    AddPathCommand(path, PATH_COMMAND_CUBIC, c1, c2, p);
+}
+
+extern void ClosePath(Path *path) {
+    AddPathCommand(path, PATH_COMMAND_CLOSE, ZeroV2(), ZeroV2(), ZeroV2());
+}
+
+//
+// Flattening
+//
+
+// Points of one sub-path, with consecutive duplicates removed
+typedef struct Polyline {
+    int count;
+    int capacity;
+    V2 *points;
+    int isClosed;
+} Polyline;
+
+static void AddPolylinePoint(Polyline *polyline, V2 p) {
+    if (polyline->count > 0 && IsV2Equal(polyline->points[polyline->count - 1], p)) {
+        return;
+    }
+
+    if (polyline->count == polyline->capacity) {
+        polyline->capacity = polyline->capacity * 2 + 16;
+        polyline->points = realloc(polyline->points, sizeof(V2) * polyline->capacity);
+    }
+    polyline->points[polyline->count++] = p;
+}
+
+// Wang's formula: segments needed so a uniformly split Bezier curve of degree stays within tolerance
+static int CalcCurveSegmentCount(F degreeFactor, F secondDifference, F tolerance) {
+    F n = CeilF(sqrtf(degreeFactor * secondDifference / tolerance));
+    return (int) ClampF(n, 1.0f, (F) PATH_MAX_SEGMENTS);
+}
+
+static void FlattenQuad(Polyline *polyline, V2 p0, V2 p1, V2 p2, F tolerance) {
+    F dd = GetV2Len(AddV2(SubV2(p0, MulV2(2.0f, p1)), p2));
+    int n = CalcCurveSegmentCount(0.25f, dd, tolerance);
+
+    for (int i = 1; i <= n; ++i) {
+        F t = (F) i / n;
+        F u = 1.0f - t;
+        V2 p = AddV2(AddV2(MulV2(u * u, p0), MulV2(2.0f * u * t, p1)), MulV2(t * t, p2));
+        AddPolylinePoint(polyline, p);
+    }
+}
+
+static void FlattenCubic(Polyline *polyline, V2 p0, V2 p1, V2 p2, V2 p3, F tolerance) {
+    F dd0 = GetV2Len(AddV2(SubV2(p0, MulV2(2.0f, p1)), p2));
+    F dd1 = GetV2Len(AddV2(SubV2(p1, MulV2(2.0f, p2)), p3));
+    int n = CalcCurveSegmentCount(0.75f, dd0 > dd1 ? dd0 : dd1, tolerance);
+
+    for (int i = 1; i <= n; ++i) {
+        F t = (F) i / n;
+        F u = 1.0f - t;
+        V2 p = AddV2(AddV2(MulV2(u * u * u, p0), MulV2(3.0f * u * u * t, p1)),
+                     AddV2(MulV2(3.0f * u * t * t, p2), MulV2(t * t * t, p3)));
+        AddPolylinePoint(polyline, p);
+    }
+}
+
+// Flatten the sub-path starting at command start into polyline, return the index of the next sub-path
+static int FlattenSubPath(const Path *path, int start, F tolerance, Polyline *polyline) {
+    polyline->count = 0;
+    polyline->isClosed = 0;
+
+    V2 current = ZeroV2();
+    int i = start;
+    for (; i < path->commandCount; ++i) {
+        const PathCommand *command = &path->commands[i];
+
+        if (command->kind == PATH_COMMAND_MOVE) {
+            if (i != start) {
+                break;
+            }
+            current = command->points[0];
+            AddPolylinePoint(polyline, current);
+            continue;
+        }
+
+        // Drawing without a move starts from the origin
+        if (polyline->count == 0) {
+            AddPolylinePoint(polyline, current);
+        }
+
+        switch (command->kind) {
+            case PATH_COMMAND_LINE: {
+                current = command->points[0];
+                AddPolylinePoint(polyline, current);
+            } break;
+            case PATH_COMMAND_QUAD: {
+                FlattenQuad(polyline, current, command->points[0], command->points[1], tolerance);
+                current = command->points[1];
+            } break;
+            case PATH_COMMAND_CUBIC: {
+                FlattenCubic(polyline, current, command->points[0], command->points[1], command->points[2], tolerance);
+                current = command->points[2];
+            } break;
+            case PATH_COMMAND_CLOSE: {
+                polyline->isClosed = 1;
+            } break;
+            default: break;
+        }
+
+        if (polyline->isClosed) {
+            ++i;
+            break;
+        }
+    }
+
+    // The closing segment is implicit
+    if (polyline->isClosed && polyline->count > 1 &&
+        IsV2Equal(polyline->points[0], polyline->points[polyline->count - 1])) {
+        polyline->count--;
+    }
+
+    return i;
+}
+
+//
+// Mesh
+//
+
+static int AddMeshVertex(PathMesh *mesh, V2 p) {
+    if (mesh->vertexCount == mesh->vertexCapacity) {
+        mesh->vertexCapacity = mesh->vertexCapacity * 2 + 64;
+        mesh->vertices = realloc(mesh->vertices, sizeof(V2) * mesh->vertexCapacity);
+    }
+
+    // Indices are 16 bits, vertices past that are dropped by AddMeshTriangle
+    mesh->vertices[mesh->vertexCount] = p;
+    return mesh->vertexCount++;
+}
+
+static void AddMeshTriangle(PathMesh *mesh, int a, int b, int c) {
+    if (a > UINT16_MAX || b > UINT16_MAX || c > UINT16_MAX) {
+        return;
+    }
+
+    if (mesh->indexCount + 3 > mesh->indexCapacity) {
+        mesh->indexCapacity = mesh->indexCapacity * 2 + 96;
+        mesh->indices = realloc(mesh->indices, sizeof(uint16_t) * mesh->indexCapacity);
+    }
+
+    mesh->indices[mesh->indexCount++] = (uint16_t) a;
+    mesh->indices[mesh->indexCount++] = (uint16_t) b;
+    mesh->indices[mesh->indexCount++] = (uint16_t) c;
+}
+
+static void ResetPathMesh(PathMesh *mesh) {
+    mesh->vertexCount = 0;
+    mesh->indexCount = 0;
+}
+
+extern void FreePathMesh(PathMesh *mesh) {
+    free(mesh->vertices);
+    free(mesh->indices);
+    memset(mesh, 0, sizeof(PathMesh));
+}
+
+//
+// Fill
+//
+
+static int IsPointInTriangle(V2 p, V2 a, V2 b, V2 c) {
+    return CrossV2(SubV2(b, a), SubV2(p, a)) >= 0.0f &&
+           CrossV2(SubV2(c, b), SubV2(p, b)) >= 0.0f &&
+           CrossV2(SubV2(a, c), SubV2(p, c)) >= 0.0f;
+}
+
+// Ear clipping of a simple polygon. Self-intersecting polygons are filled as a fan from the remaining vertices.
+static void TriangulatePolygon(PathMesh *mesh, const V2 *points, int count) {
+    int base = mesh->vertexCount;
+    for (int i = 0; i < count; ++i) {
+        AddMeshVertex(mesh, points[i]);
+    }
+
+    // Work on a counter-clockwise list of remaining vertices
+    F area = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        area += CrossV2(points[i], points[(i + 1) % count]);
+    }
+
+    int *remaining = malloc(sizeof(int) * count);
+    for (int i = 0; i < count; ++i) {
+        remaining[i] = area >= 0.0f ? i : count - 1 - i;
+    }
+
+    int n = count;
+    int guard = 0;
+    int i = 0;
+    while (n > 3 && guard < n) {
+        int i0 = remaining[(i + n - 1) % n];
+        int i1 = remaining[i % n];
+        int i2 = remaining[(i + 1) % n];
+        V2 a = points[i0];
+        V2 b = points[i1];
+        V2 c = points[i2];
+
+        F cross = CrossV2(SubV2(b, a), SubV2(c, a));
+        if (cross == 0.0f) {
+            // Collinear vertex, drop it without a triangle
+            memmove(&remaining[i % n], &remaining[i % n + 1], sizeof(int) * (n - i % n - 1));
+            n--;
+            guard = 0;
+            continue;
+        }
+
+        int isEar = cross > 0.0f;
+        for (int j = 0; isEar && j < n; ++j) {
+            int k = remaining[j];
+            if (k != i0 && k != i1 && k != i2 && IsPointInTriangle(points[k], a, b, c)) {
+                isEar = 0;
+            }
+        }
+
+        if (isEar) {
+            AddMeshTriangle(mesh, base + i0, base + i1, base + i2);
+            memmove(&remaining[i % n], &remaining[i % n + 1], sizeof(int) * (n - i % n - 1));
+            n--;
+            guard = 0;
+        } else {
+            i++;
+            guard++;
+        }
+    }
+
+    for (int j = 1; j + 1 < n; ++j) {
+        AddMeshTriangle(mesh, base + remaining[0], base + remaining[j], base + remaining[j + 1]);
+    }
+
+    free(remaining);
+}
+
+extern void TessellatePathFill(const Path *path, F tolerance, PathMesh *mesh) {
+    ResetPathMesh(mesh);
+
+    Polyline polyline = {0};
+    for (int start = 0; start < path->commandCount;) {
+        start = FlattenSubPath(path, start, tolerance, &polyline);
+        // Every sub-path is filled as if it was closed
+        if (polyline.count > 1 && IsV2Equal(polyline.points[0], polyline.points[polyline.count - 1])) {
+            polyline.count--;
+        }
+        if (polyline.count >= 3) {
+            TriangulatePolygon(mesh, polyline.points, polyline.count);
+        }
+    }
+    free(polyline.points);
+}
+
+//
+// Stroke
+//
+
+// Triangle fan around center from direction from to direction to, turning counter-clockwise if ccw
+static void AddArc(PathMesh *mesh, V2 center, V2 from, V2 to, F radius, int ccw, F tolerance) {
+    F angle = atan2f(CrossV2(from, to), DotV2(from, to));
+    if (ccw && angle < 0.0f) {
+        angle += 2.0f * PI;
+    } else if (!ccw && angle > 0.0f) {
+        angle -= 2.0f * PI;
+    }
+
+    // Segments whose sagitta stays within tolerance
+    F step = radius > tolerance ? 2.0f * acosf(1.0f - tolerance / radius) : PI;
+    int n = (int) ClampF(CeilF(fabsf(angle) / step), 1.0f, (F) PATH_MAX_SEGMENTS);
+
+    int centerIndex = AddMeshVertex(mesh, center);
+    int prev = AddMeshVertex(mesh, AddV2(center, MulV2(radius, from)));
+    for (int i = 1; i <= n; ++i) {
+        F a = angle * i / n;
+        F c = cosf(a);
+        F s = sinf(a);
+        V2 dir = MakeV2(from.x * c - from.y * s, from.x * s + from.y * c);
+        int next = AddMeshVertex(mesh, AddV2(center, MulV2(radius, dir)));
+        AddMeshTriangle(mesh, centerIndex, prev, next);
+        prev = next;
+    }
+}
+
+static void AddQuad(PathMesh *mesh, V2 a, V2 b, V2 c, V2 d) {
+    int ia = AddMeshVertex(mesh, a);
+    int ib = AddMeshVertex(mesh, b);
+    int ic = AddMeshVertex(mesh, c);
+    int id = AddMeshVertex(mesh, d);
+    AddMeshTriangle(mesh, ia, ib, ic);
+    AddMeshTriangle(mesh, ia, ic, id);
+}
+
+// Fill the outer side of the corner at p between the segments with unit directions d0 and d1
+static void AddJoin(PathMesh *mesh, V2 p, V2 d0, V2 d1, F halfWidth, const StrokeStyle *style, F tolerance) {
+    F cross = CrossV2(d0, d1);
+    if (fabsf(cross) < 1e-6f && DotV2(d0, d1) > 0.0f) {
+        return;
+    }
+
+    // The outer side is to the right of a left turn
+    F side = cross > 0.0f ? -1.0f : 1.0f;
+    V2 n0 = MulV2(side, PerpV2(d0));
+    V2 n1 = MulV2(side, PerpV2(d1));
+
+    switch (style->join) {
+        case STROKE_JOIN_ROUND: {
+            AddArc(mesh, p, n0, n1, halfWidth, cross > 0.0f, tolerance);
+        } break;
+        case STROKE_JOIN_MITER: {
+            V2 miter = NormalizeV2(AddV2(n0, n1));
+            F cosHalf = DotV2(miter, n0);
+            if (cosHalf > 1e-6f && 1.0f / cosHalf <= style->miterLimit) {
+                V2 tip = AddV2(p, MulV2(halfWidth / cosHalf, miter));
+                AddQuad(mesh, p, AddV2(p, MulV2(halfWidth, n0)), tip, AddV2(p, MulV2(halfWidth, n1)));
+                break;
+            }
+        }
+        // fallthrough
+        case STROKE_JOIN_BEVEL: {
+            int ip = AddMeshVertex(mesh, p);
+            int i0 = AddMeshVertex(mesh, AddV2(p, MulV2(halfWidth, n0)));
+            int i1 = AddMeshVertex(mesh, AddV2(p, MulV2(halfWidth, n1)));
+            AddMeshTriangle(mesh, ip, i0, i1);
+        } break;
+    }
+}
+
+// Cap at p of a line leaving in unit direction dir
+static void AddCap(PathMesh *mesh, V2 p, V2 dir, F halfWidth, const StrokeStyle *style, F tolerance) {
+    V2 normal = PerpV2(dir);
+
+    switch (style->cap) {
+        case STROKE_CAP_SQUARE: {
+            V2 ext = MulV2(halfWidth, dir);
+            V2 n = MulV2(halfWidth, normal);
+            AddQuad(mesh, SubV2(p, n), AddV2(SubV2(p, n), ext), AddV2(AddV2(p, n), ext), AddV2(p, n));
+        } break;
+        case STROKE_CAP_ROUND: {
+            AddArc(mesh, p, NegV2(normal), normal, halfWidth, 1, tolerance);
+        } break;
+        default: break;
+    }
+}
+
+static void StrokePolyline(PathMesh *mesh, const Polyline *polyline, const StrokeStyle *style, F tolerance) {
+    int count = polyline->count;
+    const V2 *points = polyline->points;
+    F halfWidth = style->width / 2.0f;
+
+    if (count < 2) {
+        return;
+    }
+
+    int segmentCount = polyline->isClosed ? count : count - 1;
+    for (int i = 0; i < segmentCount; ++i) {
+        V2 p0 = points[i];
+        V2 p1 = points[(i + 1) % count];
+        V2 dir = NormalizeV2(SubV2(p1, p0));
+        V2 n = MulV2(halfWidth, PerpV2(dir));
+        AddQuad(mesh, SubV2(p0, n), SubV2(p1, n), AddV2(p1, n), AddV2(p0, n));
+
+        // Join with the next segment
+        if (polyline->isClosed || i + 1 < segmentCount) {
+            V2 p2 = points[(i + 2) % count];
+            V2 nextDir = NormalizeV2(SubV2(p2, p1));
+            AddJoin(mesh, p1, dir, nextDir, halfWidth, style, tolerance);
+        }
+    }
+
+    if (!polyline->isClosed) {
+        AddCap(mesh, points[0], NormalizeV2(SubV2(points[0], points[1])), halfWidth, style, tolerance);
+        AddCap(mesh, points[count - 1], NormalizeV2(SubV2(points[count - 1], points[count - 2])), halfWidth, style, tolerance);
+    }
+}
+
+extern void TessellatePathStroke(const Path *path, const StrokeStyle *style, F tolerance, PathMesh *mesh) {
+    ResetPathMesh(mesh);
+
+    Polyline polyline = {0};
+    for (int start = 0; start < path->commandCount;) {
+        start = FlattenSubPath(path, start, tolerance, &polyline);
+        StrokePolyline(mesh, &polyline, style, tolerance);
+    }
+    free(polyline.points);
+}
@@ -0,0 +1,86 @@
+#ifndef RTD_PATH_H
+#define RTD_PATH_H
+
+#include <stdint.h>
+
+#include "cgmath.h"
+
+typedef enum PathCommandKind {
+    PATH_COMMAND_MOVE,
+    PATH_COMMAND_LINE,
+    PATH_COMMAND_QUAD,
+    PATH_COMMAND_CUBIC,
+    PATH_COMMAND_CLOSE,
+} PathCommandKind;
+
+typedef struct PathCommand {
+    PathCommandKind kind;
+    // Control points followed by the end point, unused points are zero
+    V2 points[3];
+} PathCommand;
+
+// Sequence of sub-paths, each started by MovePathTo
+typedef struct Path {
+    int commandCount;
+    int commandCapacity;
+    PathCommand *commands;
+    // Hash of the commands, updated as they are added
+    uint64_t hash;
+} Path;
+
+typedef enum StrokeJoin {
+    STROKE_JOIN_MITER,
+    STROKE_JOIN_BEVEL,
+    STROKE_JOIN_ROUND,
+} StrokeJoin;
+
+typedef enum StrokeCap {
+    STROKE_CAP_BUTT,
+    STROKE_CAP_SQUARE,
+    STROKE_CAP_ROUND,
+} StrokeCap;
+
+typedef struct StrokeStyle {
+    F width;
+    StrokeJoin join;
+    StrokeCap cap;
+    // Miter joins longer than miterLimit * width / 2 fall back to bevel
+    F miterLimit;
+} StrokeStyle;
+
+// Triangles in the local space of the path
+typedef struct PathMesh {
+    int vertexCount;
+    int vertexCapacity;
+    V2 *vertices;
+    int indexCount;
+    int indexCapacity;
+    uint16_t *indices;
+} PathMesh;
+
+extern Path *CreatePath(void);
+extern void DestroyPath(Path **path);
+// Remove all commands, keeping the memory
+extern void ClearPath(Path *path);
+extern void MovePathTo(Path *path, V2 p);
+extern void LinePathTo(Path *path, V2 p);
+extern void QuadPathTo(Path *path, V2 c, V2 p);
+extern void CubicPathTo(Path *path, V2 c1, V2 c2, V2 p);
+// Connect the end of the current sub-path to its start
+extern void ClosePath(Path *path);
+
+// Curves are flattened so they never deviate from the exact path by more than tolerance
+extern void TessellatePathFill(const Path *path, F tolerance, PathMesh *mesh);
+extern void TessellatePathStroke(const Path *path, const StrokeStyle *style, F tolerance, PathMesh *mesh);
+extern void FreePathMesh(PathMesh *mesh);
+
+static inline StrokeStyle MakeStrokeStyle(F width, StrokeJoin join, StrokeCap cap) {
+    StrokeStyle result;
+    result.width = width;
+    result.join = join;
+    result.cap = cap;
+    result.miterLimit = 4.0f;
+    return result;
+}
+
+#endif // RTD_PATH_H
@@ -0,0 +1,292 @@
+#include "post_process.h"
+
+#include <stdio.h>
+
+// Runs a pooled target may stay unused before it is destroyed, e.g. after the quality was lowered
+#define POOLED_RENDER_TARGET_MAX_IDLE_RUNS 120
+
+extern PostProcessChain *CreatePostProcessChain(PostQuality quality) {
+    PostProcessChain *chain = malloc(sizeof(PostProcessChain));
+    chain->quality = quality;
+    chain->effectCount = 0;
+    chain->runIndex = 0;
+    chain->pooledTargetCount = 0;
+    chain->lastEffectCount = 0;
+
+    return chain;
+}
+
+extern void DestroyPostProcessChain(RenderContext *rc, PostProcessChain **ptr) {
+    PostProcessChain *chain = *ptr;
+
+    for (int i = 0; i < chain->pooledTargetCount; ++i) {
+        DestroyRenderTarget(rc, &chain->pooledTargets[i].target);
+    }
+
+    free(chain);
+
+    *ptr = NULL;
+}
+
+extern PostEffect *AddPostEffect(PostProcessChain *chain, PostEffectKind kind, const char *name, PostQuality minQuality) {
+    if (chain->effectCount >= MAX_POST_EFFECTS) {
+        printf("Too many post effects, %s is not added\n", name);
+        return NULL;
+    }
+
+    PostEffect *effect = &chain->effects[chain->effectCount++];
+    effect->kind = kind;
+    effect->name = name;
+    effect->minQuality = minQuality;
+    effect->isEnabled = 1;
+
+    switch (kind) {
+        case POST_EFFECT_BLOOM: {
+            effect->bloom.threshold = 0.8f;
+            effect->bloom.knee = 0.2f;
+            effect->bloom.intensity = 0.6f;
+            effect->bloom.levelCount = 5;
+            break;
+        }
+
+        case POST_EFFECT_COLOR_GRADING: {
+            effect->colorGrading.lut = NULL;
+            effect->colorGrading.strength = 1.0f;
+            break;
+        }
+
+        case POST_EFFECT_VIGNETTE: {
+            effect->vignette.intensity = 0.4f;
+            effect->vignette.radius = 0.35f;
+            effect->vignette.softness = 0.45f;
+            break;
+        }
+    }
+
+    return effect;
+}
+
+static RenderTarget *AcquirePooledTarget(RenderContext *rc, PostProcessChain *chain, int width, int height) {
+    for (int i = 0; i < chain->pooledTargetCount; ++i) {
+        PooledRenderTarget *pooled = &chain->pooledTargets[i];
+        if (!pooled->isInUse && pooled->target->width == width && pooled->target->height == height) {
+            pooled->isInUse = 1;
+            pooled->lastUsedRun = chain->runIndex;
+            return pooled->target;
+        }
+    }
+
+    if (chain->pooledTargetCount >= MAX_POOLED_RENDER_TARGETS) {
+        printf("Too many pooled render targets, %dx%d is not created\n", width, height);
+        return NULL;
+    }
+
+    RenderTarget *target = CreateRenderTarget(rc, width, height, TEXTURE_FILTER_LINEAR);
+    if (target == NULL) {
+        return NULL;
+    }
+
+    PooledRenderTarget *pooled = &chain->pooledTargets[chain->pooledTargetCount++];
+    pooled->target = target;
+    pooled->isInUse = 1;
+    pooled->lastUsedRun = chain->runIndex;
+
+    return target;
+}
+
+static void ReleasePooledTarget(PostProcessChain *chain, RenderTarget *target) {
+    for (int i = 0; i < chain->pooledTargetCount; ++i) {
+        if (chain->pooledTargets[i].target == target) {
+            chain->pooledTargets[i].isInUse = 0;
+            return;
+        }
+    }
+}
+
+// Release everything acquired by the last run, and destroy targets idle for too long
+static void ResetPooledTargets(RenderContext *rc, PostProcessChain *chain) {
+    int count = 0;
+    for (int i = 0; i < chain->pooledTargetCount; ++i) {
+        PooledRenderTarget pooled = chain->pooledTargets[i];
+        if (chain->runIndex - pooled.lastUsedRun > POOLED_RENDER_TARGET_MAX_IDLE_RUNS) {
+            DestroyRenderTarget(rc, &pooled.target);
+            continue;
+        }
+        pooled.isInUse = 0;
+        chain->pooledTargets[count++] = pooled;
+    }
+    chain->pooledTargetCount = count;
+}
+
+// Draw into target with the same view as source
+static void BeginPostTargetView(RenderContext *rc, RenderTarget *target, RenderTarget *source) {
+    BeginRenderTargetView(rc, target, (float) source->viewWidth, (float) source->viewHeight, 1.0f);
+}
+
+// Target of the same size as source with the same view, NULL if none could be acquired
+static RenderTarget *BeginPostTargetLike(RenderContext *rc, PostProcessChain *chain, RenderTarget *source) {
+    RenderTarget *target = AcquirePooledTarget(rc, chain, source->width, source->height);
+    if (target) {
+        BeginPostTargetView(rc, target, source);
+    }
+    return target;
+}
+
+// Threshold and downsample into a chain of half size levels, then upsample back accumulating each level into
+// result. Return 0 without drawing into result if no level could be acquired.
+static int RunBloom(RenderContext *rc, PostProcessChain *chain, const BloomSettings *bloom, RenderTarget *source,
+                    RenderTarget *result) {
+    RenderTarget *levels[MAX_BLOOM_LEVELS];
+    int levelCount = 0;
+    int maxLevelCount = bloom->levelCount < MAX_BLOOM_LEVELS ? bloom->levelCount : MAX_BLOOM_LEVELS;
+
+    RenderTarget *previous = source;
+    for (int i = 0; i < maxLevelCount; ++i) {
+        int width = previous->width / 2;
+        int height = previous->height / 2;
+        int viewWidth = previous->viewWidth / 2;
+        int viewHeight = previous->viewHeight / 2;
+        if (viewWidth < 1 || viewHeight < 1) {
+            break;
+        }
+
+        RenderTarget *level = AcquirePooledTarget(rc, chain, width, height);
+        if (level == NULL) {
+            break;
+        }
+
+        // Only the first level is thresholded
+        BeginRenderTargetView(rc, level, (float) viewWidth, (float) viewHeight, 1.0f);
+        if (i == 0) {
+            DrawBloomDownsample(rc, previous, bloom->threshold, bloom->knee);
+        } else {
+            DrawBloomDownsample(rc, previous, 0.0f, 0.0f);
+        }
+        EndRenderTarget(rc);
+
+        levels[levelCount++] = level;
+        previous = level;
+    }
+
+    if (levelCount == 0) {
+        return 0;
+    }
+
+    RenderTarget *accumulated = levels[levelCount - 1];
+    for (int i = levelCount - 2; i >= 0; --i) {
+        RenderTarget *target = BeginPostTargetLike(rc, chain, levels[i]);
+        if (target == NULL) {
+            break;
+        }
+        DrawBloomUpsample(rc, levels[i], accumulated, 1.0f);
+        EndRenderTarget(rc);
+
+        ReleasePooledTarget(chain, accumulated);
+        accumulated = target;
+    }
+
+    BeginPostTargetView(rc, result, source);
+    DrawBloomUpsample(rc, source, accumulated, bloom->intensity);
+    EndRenderTarget(rc);
+
+    for (int i = 0; i < levelCount; ++i) {
+        ReleasePooledTarget(chain, levels[i]);
+    }
+    ReleasePooledTarget(chain, accumulated);
+
+    return 1;
+}
+
+// Return 0 without drawing into target if the effect can't run
+static int DrawPostEffect(RenderContext *rc, PostProcessChain *chain, const PostEffect *effect, RenderTarget *source,
+                          RenderTarget *target) {
+    if (effect->kind == POST_EFFECT_BLOOM) {
+        return RunBloom(rc, chain, &effect->bloom, source, target);
+    }
+
+    if (effect->kind == POST_EFFECT_COLOR_GRADING && effect->colorGrading.lut == NULL) {
+        return 0;
+    }
+
+    BeginPostTargetView(rc, target, source);
+
+    switch (effect->kind) {
+        case POST_EFFECT_COLOR_GRADING: {
+            DrawColorGrading(rc, source, effect->colorGrading.lut, effect->colorGrading.strength);
+            break;
+        }
+
+        case POST_EFFECT_VIGNETTE: {
+            const VignetteSettings *vignette = &effect->vignette;
+            DrawVignette(rc, source, vignette->intensity, vignette->radius, vignette->softness);
+            break;
+        }
+
+        default: break;
+    }
+
+    EndRenderTarget(rc);
+
+    return 1;
+}
+
+extern RenderTarget *RunPostProcessChain(RenderContext *rc, PostProcessChain *chain, RenderTarget *source) {
+    BeginPostProcessChain(rc, chain);
+
+    // Debug views show what was drawn, not the post-processed result
+    if (source == NULL || rc->debugMode != RENDER_DEBUG_MODE_NONE) {
+        return source;
+    }
+
+    RenderTarget *current = source;
+    for (int i = 0; i < chain->effectCount; ++i) {
+        const PostEffect *effect = &chain->effects[i];
+        if (!IsPostEffectActive(chain, effect)) {
+            continue;
+        }
+
+        RenderTarget *result = AcquirePooledTarget(rc, chain, current->width, current->height);
+        if (result == NULL) {
+            continue;
+        }
+
+        BeginRenderPass(rc, effect->name);
+        int isDrawn = DrawPostEffect(rc, chain, effect, current, result);
+        EndRenderPass(rc);
+
+        if (isDrawn) {
+            if (current != source) {
+                ReleasePooledTarget(chain, current);
+            }
+            current = result;
+            chain->lastEffectCount++;
+        } else {
+            ReleasePooledTarget(chain, result);
+        }
+    }
+
+    return current;
+}
+
+extern void BeginPostProcessChain(RenderContext *rc, PostProcessChain *chain) {
+    chain->runIndex++;
+    chain->lastEffectCount = 0;
+    ResetPooledTargets(rc, chain);
+}
+
+extern int IsPostEffectActive(const PostProcessChain *chain, const PostEffect *effect) {
+    return effect->isEnabled && chain->quality >= effect->minQuality;
+}
+
+extern int RunPostEffect(RenderContext *rc, PostProcessChain *chain, const PostEffect *effect, RenderTarget *source,
+                         RenderTarget *target) {
+    if (DrawPostEffect(rc, chain, effect, source, target)) {
+        chain->lastEffectCount++;
+        return 1;
+    }
+
+    BeginPostTargetView(rc, target, source);
+    DrawRenderTargetStretched(rc, source);
+    EndRenderTarget(rc);
+    return 0;
+}
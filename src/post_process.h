@@ -0,0 +1,105 @@
+#ifndef RTD_POST_PROCESS_H
+#define RTD_POST_PROCESS_H
+
+#include "cgmath.h"
+#include "renderer.h"
+
+#define MAX_POST_EFFECTS 8
+#define MAX_POOLED_RENDER_TARGETS 16
+#define MAX_BLOOM_LEVELS 6
+
+// Effects are skipped when the quality of the chain is below their minQuality
+typedef enum PostQuality {
+    POST_QUALITY_OFF,
+    POST_QUALITY_LOW,
+    POST_QUALITY_MEDIUM,
+    POST_QUALITY_HIGH,
+
+    POST_QUALITY_COUNT,
+} PostQuality;
+
+typedef enum PostEffectKind {
+    POST_EFFECT_BLOOM,
+    POST_EFFECT_COLOR_GRADING,
+    POST_EFFECT_VIGNETTE,
+} PostEffectKind;
+
+typedef struct BloomSettings {
+    // Brightness kept by the first downsample, with a soft transition of knee around it
+    F threshold;
+    F knee;
+    F intensity;
+    // Levels of the mip chain, each half the size of the previous one, starting at half the source
+    int levelCount;
+} BloomSettings;
+
+typedef struct ColorGradingSettings {
+    // Owned by the caller
+    ColorLUT *lut;
+    F strength;
+} ColorGradingSettings;
+
+typedef struct VignetteSettings {
+    F intensity;
+    // In heights of the view from its center
+    F radius;
+    F softness;
+} VignetteSettings;
+
+typedef struct PostEffect {
+    PostEffectKind kind;
+    // Name of the render pass the effect is timed as
+    const char *name;
+    PostQuality minQuality;
+    int isEnabled;
+
+    union {
+        BloomSettings bloom;
+        ColorGradingSettings colorGrading;
+        VignetteSettings vignette;
+    };
+} PostEffect;
+
+// Targets reused across frames, acquired by size. Targets not used for a while are destroyed.
+typedef struct PooledRenderTarget {
+    RenderTarget *target;
+    int isInUse;
+    int lastUsedRun;
+} PooledRenderTarget;
+
+// Effects run in order, each one reading the result of the previous one and writing into a pooled target
+typedef struct PostProcessChain {
+    PostQuality quality;
+    int effectCount;
+    PostEffect effects[MAX_POST_EFFECTS];
+
+    int runIndex;
+    int pooledTargetCount;
+    PooledRenderTarget pooledTargets[MAX_POOLED_RENDER_TARGETS];
+    // Effects run by the last RunPostProcessChain
+    int lastEffectCount;
+} PostProcessChain;
+
+extern PostProcessChain *CreatePostProcessChain(PostQuality quality);
+extern void DestroyPostProcessChain(RenderContext *rc, PostProcessChain **chain);
+
+// Append an effect with default settings, NULL if the chain is full
+extern PostEffect *AddPostEffect(PostProcessChain *chain, PostEffectKind kind, const char *name, PostQuality minQuality);
+
+// Run the effects on the view of source, each in its own render pass. Return the target holding the result, which
+// stays valid until the next run, or source itself if no effect ran. Must be called outside of render passes and
+// targets.
+extern RenderTarget *RunPostProcessChain(RenderContext *rc, PostProcessChain *chain, RenderTarget *source);
+
+// Start a run where the caller provides the target of every effect, e.g. from a render graph, instead of
+// RunPostProcessChain. Release the pooled targets of the last run.
+extern void BeginPostProcessChain(RenderContext *rc, PostProcessChain *chain);
+// Whether effect runs at the quality of chain
+extern int IsPostEffectActive(const PostProcessChain *chain, const PostEffect *effect);
+// Run effect on the view of source into target, which must be at least the size of source. If the effect can't run,
+// e.g. the pool is full, source is copied instead so target can always be read next. Return 1 if the effect ran.
+// Must be called outside of render targets.
+extern int RunPostEffect(RenderContext *rc, PostProcessChain *chain, const PostEffect *effect, RenderTarget *source,
+                         RenderTarget *target);
+
+#endif // RTD_POST_PROCESS_H
@@ -0,0 +1,405 @@
+#include "render_graph.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "time.h"
+
+// Frames a target may stay unused before it is destroyed, e.g. after a transient resource changed size
+#define RENDER_GRAPH_TARGET_MAX_IDLE_FRAMES 120
+
+extern RenderGraph *CreateRenderGraph(void) {
+    RenderGraph *graph = malloc(sizeof(RenderGraph));
+    memset(graph, 0, sizeof(RenderGraph));
+    return graph;
+}
+
+extern void DestroyRenderGraph(RenderContext *rc, RenderGraph **ptr) {
+    RenderGraph *graph = *ptr;
+
+    for (int i = 0; i < graph->targetCount; ++i) {
+        DestroyRenderTarget(rc, &graph->targets[i].target);
+    }
+
+    free(graph);
+
+    *ptr = NULL;
+}
+
+extern void BeginRenderGraph(RenderGraph *graph) {
+    graph->passCount = 0;
+    graph->resourceCount = 0;
+    graph->executionCount = 0;
+}
+
+static RenderGraphResource AddRenderGraphResource(RenderGraph *graph, const char *name) {
+    if (graph->resourceCount >= MAX_RENDER_GRAPH_RESOURCES) {
+        printf("Too many render graph resources, %s is not added\n", name);
+        return -1;
+    }
+
+    RenderGraphResourceNode *resource = &graph->resources[graph->resourceCount];
+    memset(resource, 0, sizeof(RenderGraphResourceNode));
+    resource->name = name;
+    resource->physicalTarget = -1;
+
+    return graph->resourceCount++;
+}
+
+extern RenderGraphResource ImportRenderGraphTarget(RenderGraph *graph, const char *name, RenderTarget *target) {
+    RenderGraphResource index = AddRenderGraphResource(graph, name);
+    if (index >= 0) {
+        graph->resources[index].isImported = 1;
+        graph->resources[index].target = target;
+    }
+    return index;
+}
+
+extern RenderGraphResource CreateRenderGraphTarget(RenderGraph *graph, const char *name, int width, int height,
+                                                   TextureFilter filter) {
+    RenderGraphResource index = AddRenderGraphResource(graph, name);
+    if (index >= 0) {
+        graph->resources[index].width = width;
+        graph->resources[index].height = height;
+        graph->resources[index].filter = filter;
+    }
+    return index;
+}
+
+extern void MarkRenderGraphOutput(RenderGraph *graph, RenderGraphResource resource) {
+    if (resource >= 0) {
+        graph->resources[resource].isOutput = 1;
+    }
+}
+
+extern int AddRenderGraphPass(RenderGraph *graph, const char *name, int flags, RenderGraphPassFn *execute, void *data) {
+    if (graph->passCount >= MAX_RENDER_GRAPH_PASSES) {
+        printf("Too many render graph passes, %s is not added\n", name);
+        return -1;
+    }
+
+    RenderGraphPassNode *pass = &graph->passes[graph->passCount];
+    memset(pass, 0, sizeof(RenderGraphPassNode));
+    pass->name = name;
+    pass->flags = flags;
+    pass->execute = execute;
+    pass->data = data;
+
+    return graph->passCount++;
+}
+
+extern void ReadRenderGraphResource(RenderGraph *graph, int pass, RenderGraphResource resource) {
+    if (pass < 0 || resource < 0) {
+        return;
+    }
+
+    RenderGraphPassNode *node = &graph->passes[pass];
+    assert(node->readCount < MAX_RENDER_GRAPH_PASS_RESOURCES);
+    node->reads[node->readCount++] = resource;
+}
+
+extern void WriteRenderGraphResource(RenderGraph *graph, int pass, RenderGraphResource resource) {
+    if (pass < 0 || resource < 0) {
+        return;
+    }
+
+    RenderGraphPassNode *node = &graph->passes[pass];
+    assert(node->writeCount < MAX_RENDER_GRAPH_PASS_RESOURCES);
+    node->writes[node->writeCount++] = resource;
+}
+
+static int IsRenderGraphPassReading(const RenderGraphPassNode *pass, RenderGraphResource resource) {
+    for (int i = 0; i < pass->readCount; ++i) {
+        if (pass->reads[i] == resource) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int IsRenderGraphPassWriting(const RenderGraphPassNode *pass, RenderGraphResource resource) {
+    for (int i = 0; i < pass->writeCount; ++i) {
+        if (pass->writes[i] == resource) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Pass a must run after pass b: b was declared first and a reads or writes what b writes, or a writes what b reads.
+// A reader only sees the writes declared before it, and a writer never runs before an earlier reader.
+static int IsRenderGraphPassDependent(const RenderGraph *graph, int a, int b) {
+    const RenderGraphPassNode *passA = &graph->passes[a];
+    const RenderGraphPassNode *passB = &graph->passes[b];
+
+    if (b >= a) {
+        return 0;
+    }
+
+    for (int i = 0; i < passB->writeCount; ++i) {
+        RenderGraphResource resource = passB->writes[i];
+        if (IsRenderGraphPassReading(passA, resource) || IsRenderGraphPassWriting(passA, resource)) {
+            return 1;
+        }
+    }
+    for (int i = 0; i < passB->readCount; ++i) {
+        if (IsRenderGraphPassWriting(passA, passB->reads[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void CullRenderGraphPasses(RenderGraph *graph) {
+    int isNeeded[MAX_RENDER_GRAPH_RESOURCES];
+    for (int i = 0; i < graph->resourceCount; ++i) {
+        isNeeded[i] = graph->resources[i].isOutput;
+    }
+    for (int i = 0; i < graph->passCount; ++i) {
+        graph->passes[i].isCulled = 1;
+    }
+
+    // Walk back from the outputs until no more pass is found to contribute
+    int isChanged = 1;
+    while (isChanged) {
+        isChanged = 0;
+        for (int i = 0; i < graph->passCount; ++i) {
+            RenderGraphPassNode *pass = &graph->passes[i];
+            if (!pass->isCulled) {
+                continue;
+            }
+
+            for (int w = 0; w < pass->writeCount; ++w) {
+                if (isNeeded[pass->writes[w]]) {
+                    pass->isCulled = 0;
+                    break;
+                }
+            }
+
+            if (!pass->isCulled) {
+                for (int r = 0; r < pass->readCount; ++r) {
+                    isNeeded[pass->reads[r]] = 1;
+                }
+                isChanged = 1;
+            }
+        }
+    }
+
+    graph->culledPassCount = 0;
+    for (int i = 0; i < graph->passCount; ++i) {
+        graph->culledPassCount += graph->passes[i].isCulled;
+    }
+}
+
+// Topological order of the passes left, the earliest declared pass that is ready goes first
+static int OrderRenderGraphPasses(RenderGraph *graph) {
+    int isScheduled[MAX_RENDER_GRAPH_PASSES] = {0};
+    int aliveCount = graph->passCount - graph->culledPassCount;
+
+    graph->executionCount = 0;
+    while (graph->executionCount < aliveCount) {
+        int next = -1;
+        for (int i = 0; i < graph->passCount && next < 0; ++i) {
+            if (graph->passes[i].isCulled || isScheduled[i]) {
+                continue;
+            }
+
+            int isReady = 1;
+            for (int j = 0; j < graph->passCount && isReady; ++j) {
+                if (!graph->passes[j].isCulled && !isScheduled[j] && IsRenderGraphPassDependent(graph, i, j)) {
+                    isReady = 0;
+                }
+            }
+            if (isReady) {
+                next = i;
+            }
+        }
+
+        if (next < 0) {
+            printf("Render graph has a dependency cycle, passes run in declaration order\n");
+            graph->executionCount = 0;
+            for (int i = 0; i < graph->passCount; ++i) {
+                if (!graph->passes[i].isCulled) {
+                    graph->executionOrder[graph->executionCount++] = i;
+                }
+            }
+            return 0;
+        }
+
+        isScheduled[next] = 1;
+        graph->executionOrder[graph->executionCount++] = next;
+    }
+
+    return 1;
+}
+
+static void EvictIdleRenderGraphTargets(RenderContext *rc, RenderGraph *graph) {
+    int count = 0;
+    for (int i = 0; i < graph->targetCount; ++i) {
+        RenderGraphTarget target = graph->targets[i];
+        if (graph->frameIndex - target.lastUsedFrame > RENDER_GRAPH_TARGET_MAX_IDLE_FRAMES) {
+            DestroyRenderTarget(rc, &target.target);
+            continue;
+        }
+        target.busyUntil = -1;
+        graph->targets[count++] = target;
+    }
+    graph->targetCount = count;
+}
+
+static int AcquireRenderGraphTarget(RenderContext *rc, RenderGraph *graph, RenderGraphResourceNode *resource) {
+    for (int i = 0; i < graph->targetCount; ++i) {
+        RenderGraphTarget *target = &graph->targets[i];
+        if (target->busyUntil < resource->firstUse && target->filter == resource->filter &&
+            target->target->width == resource->width && target->target->height == resource->height) {
+            if (target->busyUntil >= 0) {
+                resource->isAliased = 1;
+                graph->aliasedCount++;
+            }
+            target->busyUntil = resource->lastUse;
+            target->lastUsedFrame = graph->frameIndex;
+            return i;
+        }
+    }
+
+    if (graph->targetCount >= MAX_RENDER_GRAPH_TARGETS) {
+        printf("Too many render graph targets, %s has none\n", resource->name);
+        return -1;
+    }
+
+    RenderTarget *renderTarget = CreateRenderTarget(rc, resource->width, resource->height, resource->filter);
+    if (renderTarget == NULL) {
+        return -1;
+    }
+
+    RenderGraphTarget *target = &graph->targets[graph->targetCount];
+    target->target = renderTarget;
+    target->filter = resource->filter;
+    target->busyUntil = resource->lastUse;
+    target->lastUsedFrame = graph->frameIndex;
+    return graph->targetCount++;
+}
+
+// Give each transient resource a target for its lifetime, reusing targets of resources already dead
+static void AssignRenderGraphTargets(RenderContext *rc, RenderGraph *graph) {
+    for (int i = 0; i < graph->resourceCount; ++i) {
+        RenderGraphResourceNode *resource = &graph->resources[i];
+        resource->firstUse = -1;
+        resource->lastUse = -1;
+        resource->physicalTarget = -1;
+        resource->isAliased = 0;
+    }
+
+    for (int position = 0; position < graph->executionCount; ++position) {
+        const RenderGraphPassNode *pass = &graph->passes[graph->executionOrder[position]];
+        for (int i = 0; i < pass->readCount + pass->writeCount; ++i) {
+            RenderGraphResource index = i < pass->readCount ? pass->reads[i] : pass->writes[i - pass->readCount];
+            RenderGraphResourceNode *resource = &graph->resources[index];
+            if (resource->firstUse < 0) {
+                resource->firstUse = position;
+            }
+            resource->lastUse = position;
+        }
+    }
+
+    graph->transientCount = 0;
+    graph->aliasedCount = 0;
+    for (int position = 0; position < graph->executionCount; ++position) {
+        for (int i = 0; i < graph->resourceCount; ++i) {
+            RenderGraphResourceNode *resource = &graph->resources[i];
+            if (!resource->isImported && resource->firstUse == position) {
+                resource->physicalTarget = AcquireRenderGraphTarget(rc, graph, resource);
+                graph->transientCount++;
+            }
+        }
+    }
+}
+
+extern int CompileRenderGraph(RenderContext *rc, RenderGraph *graph) {
+    graph->frameIndex++;
+
+    CullRenderGraphPasses(graph);
+    int isOrdered = OrderRenderGraphPasses(graph);
+    EvictIdleRenderGraphTargets(rc, graph);
+    AssignRenderGraphTargets(rc, graph);
+
+    return isOrdered;
+}
+
+extern void ExecuteRenderGraph(RenderContext *rc, RenderGraph *graph) {
+    for (int position = 0; position < graph->executionCount; ++position) {
+        RenderGraphPassNode *pass = &graph->passes[graph->executionOrder[position]];
+        int isRenderPass = !(pass->flags & RENDER_GRAPH_PASS_OWN_RENDER_PASSES);
+
+        Tick start = GetCurrentTick();
+        if (isRenderPass) {
+            BeginRenderPass(rc, pass->name);
+        }
+        pass->execute(rc, graph, pass->data);
+        if (isRenderPass) {
+            EndRenderPass(rc);
+        }
+        pass->cpuMs = TickToSecond(GetCurrentTick() - start) * 1000.0f;
+    }
+}
+
+extern RenderTarget *GetRenderGraphTarget(RenderGraph *graph, RenderGraphResource resource) {
+    if (resource < 0) {
+        return NULL;
+    }
+
+    const RenderGraphResourceNode *node = &graph->resources[resource];
+    if (node->isImported) {
+        return node->target;
+    }
+    return node->physicalTarget >= 0 ? graph->targets[node->physicalTarget].target : NULL;
+}
+
+static void DumpRenderGraphResource(RenderGraph *graph, const char *access, RenderGraphResource index, FILE *file) {
+    const RenderGraphResourceNode *resource = &graph->resources[index];
+    fprintf(file, "    %s %s", access, resource->name);
+    if (resource->isImported) {
+        fprintf(file, " (imported%s)", resource->isOutput ? ", output" : "");
+    } else {
+        fprintf(file, " (transient %dx%d, target %d%s, alive in passes %d-%d)", resource->width, resource->height,
+                resource->physicalTarget, resource->isAliased ? " aliased" : "", resource->firstUse, resource->lastUse);
+    }
+    fprintf(file, "\n");
+}
+
+extern void DumpRenderGraph(RenderContext *rc, RenderGraph *graph, FILE *file) {
+    const RenderTimings *timings = GetRenderTimings(rc);
+
+    fprintf(file, "Render graph: %d passes, %d culled, %d transient resources in %d targets, %d aliased\n",
+            graph->passCount, graph->culledPassCount, graph->transientCount, graph->targetCount, graph->aliasedCount);
+
+    for (int position = 0; position < graph->executionCount; ++position) {
+        const RenderGraphPassNode *pass = &graph->passes[graph->executionOrder[position]];
+
+        // GPU timings are a few frames behind, matched by name
+        float gpuMs = 0.0f;
+        for (int i = 0; i < timings->passCount; ++i) {
+            if (strcmp(timings->passes[i].name, pass->name) == 0) {
+                gpuMs = timings->passes[i].gpuMs;
+            }
+        }
+
+        if (pass->flags & RENDER_GRAPH_PASS_OWN_RENDER_PASSES) {
+            fprintf(file, "  %d. %s: cpu %.3f ms, gpu in its own passes\n", position, pass->name, pass->cpuMs);
+        } else {
+            fprintf(file, "  %d. %s: cpu %.3f ms, gpu %.3f ms\n", position, pass->name, pass->cpuMs, gpuMs);
+        }
+        for (int i = 0; i < pass->readCount; ++i) {
+            DumpRenderGraphResource(graph, "read", pass->reads[i], file);
+        }
+        for (int i = 0; i < pass->writeCount; ++i) {
+            DumpRenderGraphResource(graph, "write", pass->writes[i], file);
+        }
+    }
+
+    for (int i = 0; i < graph->passCount; ++i) {
+        if (graph->passes[i].isCulled) {
+            fprintf(file, "  culled: %s\n", graph->passes[i].name);
+        }
+    }
+}
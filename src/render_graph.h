@@ -0,0 +1,121 @@
+#ifndef RTD_RENDER_GRAPH_H
+#define RTD_RENDER_GRAPH_H
+
+#include <stdio.h>
+
+#include "renderer.h"
+
+#define MAX_RENDER_GRAPH_PASSES MAX_RENDER_PASSES
+#define MAX_RENDER_GRAPH_RESOURCES 32
+#define MAX_RENDER_GRAPH_PASS_RESOURCES 8
+#define MAX_RENDER_GRAPH_TARGETS 16
+
+typedef struct RenderGraph RenderGraph;
+
+// Index of a resource in its graph, only valid for the frame it was declared in
+typedef int RenderGraphResource;
+
+typedef void RenderGraphPassFn(RenderContext *rc, RenderGraph *graph, void *data);
+
+typedef enum RenderGraphPassFlag {
+    RENDER_GRAPH_PASS_NONE = 0,
+    // The pass begins render passes of its own, e.g. RunPostProcessChain, so it is not wrapped in one
+    RENDER_GRAPH_PASS_OWN_RENDER_PASSES = 1,
+} RenderGraphPassFlag;
+
+typedef struct RenderGraphResourceNode {
+    const char *name;
+    // Imported resources are owned outside the graph. target may be NULL for resources only used to order passes,
+    // like the window.
+    int isImported;
+    int isOutput;
+    RenderTarget *target;
+    // Transient resources are created by the graph, sharing targets with resources whose lifetimes don't overlap
+    int width;
+    int height;
+    TextureFilter filter;
+
+    // Compiled, positions in the execution order
+    int firstUse;
+    int lastUse;
+    int physicalTarget;
+    // The target was used by another resource earlier in the frame
+    int isAliased;
+} RenderGraphResourceNode;
+
+typedef struct RenderGraphPassNode {
+    const char *name;
+    int flags;
+    RenderGraphPassFn *execute;
+    void *data;
+    int readCount;
+    RenderGraphResource reads[MAX_RENDER_GRAPH_PASS_RESOURCES];
+    int writeCount;
+    RenderGraphResource writes[MAX_RENDER_GRAPH_PASS_RESOURCES];
+
+    // Compiled
+    int isCulled;
+    // CPU time of the callback in the last execution
+    float cpuMs;
+} RenderGraphPassNode;
+
+typedef struct RenderGraphTarget {
+    RenderTarget *target;
+    TextureFilter filter;
+    // Position in the execution order after which the target is free again, -1 if free for the whole frame
+    int busyUntil;
+    int lastUsedFrame;
+} RenderGraphTarget;
+
+// Passes and resources are declared again every frame, then compiled and executed. Passes run in an order where
+// every reader runs after the writers of what it reads declared before it, and every writer after the readers and
+// writers of the same resource declared before it. Passes not contributing to an output resource are culled.
+struct RenderGraph {
+    int passCount;
+    RenderGraphPassNode passes[MAX_RENDER_GRAPH_PASSES];
+    int resourceCount;
+    RenderGraphResourceNode resources[MAX_RENDER_GRAPH_RESOURCES];
+
+    int executionCount;
+    int executionOrder[MAX_RENDER_GRAPH_PASSES];
+
+    // Backing transient resources, kept across frames
+    int targetCount;
+    RenderGraphTarget targets[MAX_RENDER_GRAPH_TARGETS];
+    int frameIndex;
+
+    // Of the last compilation
+    int culledPassCount;
+    int transientCount;
+    // Transient resources backed by a target already used by another resource of the same frame
+    int aliasedCount;
+};
+
+extern RenderGraph *CreateRenderGraph(void);
+extern void DestroyRenderGraph(RenderContext *rc, RenderGraph **graph);
+
+// Forget the passes and resources of the last frame
+extern void BeginRenderGraph(RenderGraph *graph);
+extern RenderGraphResource ImportRenderGraphTarget(RenderGraph *graph, const char *name, RenderTarget *target);
+// The content of a transient target is undefined until a pass writes it
+extern RenderGraphResource CreateRenderGraphTarget(RenderGraph *graph, const char *name, int width, int height,
+                                                   TextureFilter filter);
+// Passes writing outputs, and the passes they depend on, are never culled
+extern void MarkRenderGraphOutput(RenderGraph *graph, RenderGraphResource resource);
+// Return the index of the pass, -1 if the graph is full
+extern int AddRenderGraphPass(RenderGraph *graph, const char *name, int flags, RenderGraphPassFn *execute, void *data);
+extern void ReadRenderGraphResource(RenderGraph *graph, int pass, RenderGraphResource resource);
+extern void WriteRenderGraphResource(RenderGraph *graph, int pass, RenderGraphResource resource);
+
+// Cull, order and assign targets to transient resources. Return 0 if dependencies form a cycle, passes then run in
+// declaration order.
+extern int CompileRenderGraph(RenderContext *rc, RenderGraph *graph);
+// Run the compiled passes, each in a render pass of its name unless it begins its own
+extern void ExecuteRenderGraph(RenderContext *rc, RenderGraph *graph);
+// Target of resource while the graph is executed
+extern RenderTarget *GetRenderGraphTarget(RenderGraph *graph, RenderGraphResource resource);
+
+// Passes in execution order with their resources, lifetimes, targets and timings of the last frame
+extern void DumpRenderGraph(RenderContext *rc, RenderGraph *graph, FILE *file);
+
+#endif // RTD_RENDER_GRAPH_H
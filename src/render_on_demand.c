@@ -0,0 +1,93 @@
+#include "render_on_demand.h"
+
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "cgmath.h"
+
+extern void InitRenderOnDemand(RenderOnDemand *rod, float maxIdleSeconds) {
+    rod->isEnabled = 1;
+    rod->isDirty = 1;
+    rod->maxIdleSeconds = maxIdleSeconds;
+    rod->wakeTick = 0;
+    rod->lastRenderTick = GetCurrentTick();
+    rod->sceneHash = 0;
+    rod->wakeEventType = SDL_RegisterEvents(1);
+
+    rod->renderedFrameCount = 0;
+    rod->skippedFrameCount = 0;
+    rod->idleSeconds = 0.0f;
+}
+
+extern void RequestRedraw(RenderOnDemand *rod) {
+    rod->isDirty = 1;
+}
+
+extern void RequestRedrawIn(RenderOnDemand *rod, float seconds) {
+    Tick tick = GetCurrentTick() + SecondToTick(seconds);
+    if (rod->wakeTick == 0 || tick < rod->wakeTick) {
+        rod->wakeTick = tick;
+    }
+}
+
+extern void WakeRenderOnDemand(RenderOnDemand *rod) {
+    if (rod->wakeEventType == (uint32_t) -1) {
+        return;
+    }
+
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = rod->wakeEventType;
+    SDL_PushEvent(&event);
+}
+
+extern void SetRenderOnDemandScene(RenderOnDemand *rod, uint64_t hash) {
+    if (hash != rod->sceneHash) {
+        rod->sceneHash = hash;
+        rod->isDirty = 1;
+    }
+}
+
+extern int ShouldRenderFrame(RenderOnDemand *rod, int *timeoutMs) {
+    if (!rod->isEnabled || rod->isDirty) {
+        return 1;
+    }
+
+    Tick now = GetCurrentTick();
+    Tick deadline = 0;
+    if (rod->maxIdleSeconds > 0.0f) {
+        deadline = rod->lastRenderTick + SecondToTick(rod->maxIdleSeconds);
+    }
+    if (rod->wakeTick != 0 && (deadline == 0 || rod->wakeTick < deadline)) {
+        deadline = rod->wakeTick;
+    }
+
+    if (deadline == 0) {
+        *timeoutMs = -1;
+        return 0;
+    }
+
+    if (now >= deadline) {
+        return 1;
+    }
+
+    *timeoutMs = (int) CeilF(TickToSecond(deadline - now) * 1000.0f);
+    return 0;
+}
+
+extern void CountRenderedFrame(RenderOnDemand *rod) {
+    Tick now = GetCurrentTick();
+
+    rod->isDirty = 0;
+    if (rod->wakeTick != 0 && rod->wakeTick <= now) {
+        rod->wakeTick = 0;
+    }
+    rod->lastRenderTick = now;
+    rod->renderedFrameCount++;
+}
+
+extern void CountSkippedFrame(RenderOnDemand *rod, float idleSeconds) {
+    rod->skippedFrameCount++;
+    rod->idleSeconds += idleSeconds;
+}
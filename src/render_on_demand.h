@@ -0,0 +1,56 @@
+#ifndef RTD_RENDER_ON_DEMAND_H
+#define RTD_RENDER_ON_DEMAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "time.h"
+
+// Decide whether the main loop renders a frame or waits for events, so a static scene doesn't keep the CPU and GPU busy.
+// A frame is rendered when the scene hash changes, after RequestRedraw or WakeRenderOnDemand, when a redraw requested
+// by RequestRedrawIn is due, or after maxIdleSeconds without a frame.
+typedef struct RenderOnDemand {
+    int isEnabled;
+    int isDirty;
+    // Keep statistics on screen fresh, 0 to wait for changes forever
+    float maxIdleSeconds;
+    // Earliest redraw requested by RequestRedrawIn, 0 if none
+    Tick wakeTick;
+    Tick lastRenderTick;
+    uint64_t sceneHash;
+    // SDL event pushed by WakeRenderOnDemand
+    uint32_t wakeEventType;
+
+    // Since InitRenderOnDemand
+    int renderedFrameCount;
+    // Loop iterations that waited instead of rendering
+    int skippedFrameCount;
+    float idleSeconds;
+} RenderOnDemand;
+
+extern void InitRenderOnDemand(RenderOnDemand *rod, float maxIdleSeconds);
+// Render the next frame. Main thread only.
+extern void RequestRedraw(RenderOnDemand *rod);
+// Render a frame once seconds have passed, e.g. for a timer or a blinking caret. Main thread only.
+extern void RequestRedrawIn(RenderOnDemand *rod, float seconds);
+// Interrupt the wait of the main loop from any thread. The event it posts marks the next frame dirty like any other.
+extern void WakeRenderOnDemand(RenderOnDemand *rod);
+// hash is a digest of the state the next frame draws, the frame is dirty if it differs from the last one
+extern void SetRenderOnDemandScene(RenderOnDemand *rod, uint64_t hash);
+// Return 1 if a frame has to be rendered now. Otherwise return 0 and set timeoutMs to how long the loop can wait for
+// events before calling again.
+extern int ShouldRenderFrame(RenderOnDemand *rod, int *timeoutMs);
+extern void CountRenderedFrame(RenderOnDemand *rod);
+extern void CountSkippedFrame(RenderOnDemand *rod, float idleSeconds);
+
+// FNV-1a, start with hash 0xCBF29CE484222325
+static inline uint64_t HashSceneBytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+#endif // RTD_RENDER_ON_DEMAND_H
@@ -1,11 +1,16 @@
 #include "renderer.h"
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <SDL2/SDL.h>
 #include <glad/glad.h>
 
+#include "software_renderer.h"
+#include "time.h"
+
 #define STB_TRUETYPE_IMPLEMENTATION
 #define STBTT_STATIC
 #include <stb_truetype.h>
@@ -18,98 +23,828 @@ const char DRAW_TEXTURE_FRAGMENT_SHADER[] = {
 #include "shader/draw_texture.frag.gen"
 };
 
+// Vertex of static meshes, 16 bytes
 typedef struct DrawTextureVertexAttrib {
-    F transform0[3];
-    F transform1[3];
-    F transform2[3];
     F pos[2];
-    F texCoord[2];
-    F color[4];
+    GLushort texCoord[2];   // Normalized
+    GLubyte color[4];       // Normalized
 } DrawTextureVertexAttrib;
 
+// Used by static meshes, whose transform is applied by the model uniform
 typedef struct DrawTextureProgram {
-    GLuint vao;
-    GLuint vbo;
-    GLuint ebo;
     GLuint program;
-    GLint MVPLocation;
+    GLint modelLocation;
+    GLint debugModeLocation;
+    GLint debugColorLocation;
 } DrawTextureProgram;
 
-
-
-const char DRAW_RECT_VERTEX_SHADER[] = {
-#include "shader/draw_rect.vert.gen"
+const char DRAW_SPRITE_VERTEX_SHADER[] = {
+#include "shader/draw_sprite.vert.gen"
 };
 
-const char DRAW_RECT_FRAGMENT_SHADER[] = {
-#include "shader/draw_rect.frag.gen"
+// One source per variant, see GetShaderVariant
+const char DRAW_SPRITE_FRAGMENT_SHADER[] = {
+#include "shader/draw_sprite.frag.gen"
 };
 
-typedef struct DrawRectVertexAttrib {
-    F transform0[3];
-    F transform1[3];
-    F transform2[3];
+// Must match SPRITE_KIND_* in sprite_kind.glsl, and fit in SPRITE_KIND_BITS
+typedef enum SpriteKind {
+    SPRITE_KIND_TEXTURE,
+    SPRITE_KIND_RECT,
+    SPRITE_KIND_GLYPH,
+    // Content of a render target, left out of debug modes
+    SPRITE_KIND_COMPOSITE,
+    // Overdraw counts turned into colors
+    SPRITE_KIND_HEATMAP,
+    // Flat color, used by paths
+    SPRITE_KIND_SOLID,
+    // Texture stored in a layer of a texture array
+    SPRITE_KIND_TEXTURE_LAYER,
+} SpriteKind;
+
+// Low bits of the kind byte of sprite vertices. The bits above hold the clip rect, see ClipRectStack.
+#define SPRITE_KIND_BITS 3
+
+// Rect features needed by the sprites of a command. Each one is a bit of the variants of draw_sprite.frag, which
+// compile out the features a command doesn't need. Must match the order of #pragma variants in draw_sprite.frag.
+typedef enum SpriteFeature {
+    SPRITE_FEATURE_ROUNDING = 1,
+    SPRITE_FEATURE_BORDER = 2,
+} SpriteFeature;
+
+#define SPRITE_VARIANT_COUNT 4
+
+// Layers of overdraw until the heatmap saturates. Must match OVERDRAW_MAX_LAYERS in draw_sprite.frag
+#define OVERDRAW_MAX_LAYERS 16.0f
+
+// 32 bytes. Positions stay in full floats since they are in world space, the rest is packed to the precision it needs.
+typedef struct DrawSpriteVertexAttrib {
     F pos[2];
-    F texCoord[2];
-    F color[4];
-    F roundRadius[2];
-    F thickness[2];
-    F borderColor[4];
-} DrawRectVertexAttrib;
+    GLushort texCoord[2];       // Normalized
+    GLubyte color[4];           // Normalized
+    GLushort roundRadius[2];    // Half float
+    GLushort thickness[2];      // Half float
+    GLubyte borderColor[4];     // Normalized
+    GLubyte kind;               // SpriteKind, and the clip rect above SPRITE_KIND_BITS
+    GLubyte layer;              // Of the texture array, SPRITE_KIND_TEXTURE_LAYER only
+    GLushort depth;             // Normalized
+} DrawSpriteVertexAttrib;
+
+typedef struct DrawSpriteVariant {
+    GLuint program;
+    GLint debugModeLocation;
+    GLint debugColorLocation;
+} DrawSpriteVariant;
 
-typedef struct DrawRectProgram {
+typedef struct DrawSpriteProgram {
     GLuint vao;
     GLuint vbo;
     GLuint ebo;
+    // Indexed by SpriteFeature bits
+    DrawSpriteVariant variants[SPRITE_VARIANT_COUNT];
+} DrawSpriteProgram;
+
+// Program of a Material, drawing the vertices of draw_sprite.vert. Debug views use the built-in program instead, so
+// it has no debug uniforms.
+typedef struct MaterialInternal {
+    GLuint program;
+    GLint paramsLocation;
+} MaterialInternal;
+
+// Indices are 16 bits, so one flush can't reference more vertices than this
+#define SPRITE_BATCH_MAX_VERTICES 65536
+#define SPRITE_BATCH_MAX_INDICES (SPRITE_BATCH_MAX_VERTICES / 4 * 6)
+#define SPRITE_BATCH_MAX_CHUNKS (SPRITE_BATCH_MAX_INDICES / 6)
+#define SPRITE_BATCH_MAX_COMMANDS 1024
+// Sprites drawn into the same target before the depth buffer has to be cleared
+#define SPRITE_MAX_DEPTH 65535
+
+// Indices drawn with one draw call
+typedef struct SpriteBatchCommand {
+    // 0 if none of the sprites samples a texture
+    GLuint texture;
+    // 0 if none of the sprites samples a texture array
+    GLuint textureArray;
+    // Slot of the view constants buffer
+    int view;
+    // NULL for the built-in program
+    const MaterialInternal *material;
+    // Copy of the parameters of material when the command was added
+    V4 params[MAX_MATERIAL_PARAMS];
+    // SpriteFeature bits of the sprites, picking the variant of the built-in program
+    int features;
+    int isOpaque;
+    // Translucent sprites of the command write depth, see DrawPath
+    int isDepthWritten;
+    // Set by FlushSpriteBatch
+    int firstIndex;
+    int indexCount;
+} SpriteBatchCommand;
+
+// Indices pushed by one draw, in push order
+typedef struct SpriteBatchChunk {
+    int command;
+    int firstIndex;
+    int indexCount;
+} SpriteBatchChunk;
+
+// Sprites are queued here and drawn by FlushSpriteBatch with one upload and one draw call per command.
+//
+// Every sprite gets a depth from its draw order, so later sprites are in front. Opaque sprites are drawn first,
+// front to back with depth writes and without blending, so hidden pixels are rejected before shading. Translucent
+// sprites are drawn after them, back to front with depth test only. Since ordering against opaque sprites is
+// resolved by depth, opaque commands can merge with any earlier command of the same state and translucent commands
+// only have to keep their order among themselves.
+typedef struct SpriteBatch {
+    int vertexCount;
+    int indexCount;
+    int chunkCount;
+    int commandCount;
+    // Index of the last translucent command, -1 if none
+    int lastTranslucentCommand;
+    // Depth of the last queued sprite in the current target, counted down from SPRITE_MAX_DEPTH
+    int depth;
+    DrawSpriteVertexAttrib vertices[SPRITE_BATCH_MAX_VERTICES];
+    GLushort indices[SPRITE_BATCH_MAX_INDICES];
+    // indices sorted by command, uploaded by FlushSpriteBatch
+    GLushort drawIndices[SPRITE_BATCH_MAX_INDICES];
+    SpriteBatchChunk chunks[SPRITE_BATCH_MAX_CHUNKS];
+    SpriteBatchCommand commands[SPRITE_BATCH_MAX_COMMANDS];
+    // Commands in the order they are drawn, filled by DrawSpriteBatchCommands
+    int drawOrder[SPRITE_BATCH_MAX_COMMANDS];
+
+    // Textures destroyed while queued commands may still sample them, deleted after the next flush
+    int pendingDeleteTextureCount;
+    int pendingDeleteTextureCapacity;
+    GLuint *pendingDeleteTextures;
+} SpriteBatch;
+
+// Room reserved in the sprite batch by ReserveSpriteBatch
+typedef struct SpriteBatchReservation {
+    SpriteBatchCommand *command;
+    DrawSpriteVertexAttrib *vertices;
+    // Relative to baseVertex
+    GLushort *indices;
+    GLushort baseVertex;
+    GLushort depth;
+    // Clip rect of the vertices, see GetClipRectSlot
+    GLubyte clip;
+} SpriteBatchReservation;
+
+// Paths whose tessellation is kept across frames
+#define PATH_MESH_CACHE_SIZE 256
+// Slots searched for a key, starting at the slot of its hash
+#define PATH_MESH_CACHE_PROBES 8
+// Maximum distance in pixels between a curve and its tessellation
+#define PATH_TOLERANCE 0.25f
+
+typedef struct PathMeshCacheEntry {
+    // 0 if the slot is empty
+    uint64_t key;
+    int lastUsedFrame;
+    PathMesh mesh;
+} PathMeshCacheEntry;
+
+const char DRAW_PARTICLE_VERTEX_SHADER[] = {
+#include "shader/draw_particle.vert.gen"
+};
+
+const char DRAW_PARTICLE_FRAGMENT_SHADER[] = {
+#include "shader/draw_particle.frag.gen"
+};
+
+// Number of per instance attributes of draw particle program, one array of ParticleInstances each
+#define DRAW_PARTICLE_INSTANCE_ATTRIB_COUNT 7
+
+typedef struct DrawParticleProgram {
+    GLuint vao;
+    GLuint cornerVbo;
+    GLuint instanceVbo;
+    GLsizeiptr instanceVboSize;
+    GLuint program;
+    GLint texCoordScaleLocation;
+    GLint debugModeLocation;
+    GLint debugColorLocation;
+} DrawParticleProgram;
+
+const char DRAW_LIGHT_VERTEX_SHADER[] = {
+#include "shader/draw_light.vert.gen"
+};
+
+const char DRAW_LIGHT_FRAGMENT_SHADER[] = {
+#include "shader/draw_light.frag.gen"
+};
+
+// Point lights are instanced quads with one PointLight per instance
+typedef struct DrawLightProgram {
+    GLuint vao;
+    GLuint cornerVbo;
+    GLuint instanceVbo;
+    GLsizeiptr instanceVboSize;
+    GLuint program;
+} DrawLightProgram;
+
+const char DRAW_SHADOW_VERTEX_SHADER[] = {
+#include "shader/draw_shadow.vert.gen"
+};
+
+const char DRAW_SHADOW_FRAGMENT_SHADER[] = {
+#include "shader/draw_shadow.frag.gen"
+};
+
+typedef struct DrawShadowProgram {
+    GLuint program;
+    GLint lightPosLocation;
+} DrawShadowProgram;
+
+const char DRAW_POST_VERTEX_SHADER[] = {
+#include "shader/draw_post.vert.gen"
+};
+
+const char DRAW_POST_DOWNSAMPLE_FRAGMENT_SHADER[] = {
+#include "shader/draw_post_downsample.frag.gen"
+};
+
+const char DRAW_POST_UPSAMPLE_FRAGMENT_SHADER[] = {
+#include "shader/draw_post_upsample.frag.gen"
+};
+
+const char DRAW_POST_GRADE_FRAGMENT_SHADER[] = {
+#include "shader/draw_post_grade.frag.gen"
+};
+
+const char DRAW_POST_VIGNETTE_FRAGMENT_SHADER[] = {
+#include "shader/draw_post_vignette.frag.gen"
+};
+
+// Full screen pass reading the view of a render target, see draw_post.vert
+typedef struct DrawPostProgram {
+    GLuint program;
+    GLint texCoordScaleLocation;
+    GLint texelSizeLocation;
+    GLint maxTexCoordLocation;
+    GLint paramsLocation;
+    // Second source of DrawBloomUpsample
+    GLint bloomTexCoordScaleLocation;
+    GLint bloomTexelSizeLocation;
+    GLint bloomMaxTexCoordLocation;
+} DrawPostProgram;
+
+const char DRAW_REPEATED_FRAGMENT_SHADER[] = {
+#include "shader/draw_repeated.frag.gen"
+};
+
+// Texture repeated over the whole view, drawn with the triangle of draw_post.vert
+typedef struct DrawRepeatedProgram {
     GLuint program;
-    GLint MVPLocation;
-} DrawRectProgram;
+    GLint tilingLocation;
+    GLint imageScaleLocation;
+    GLint colorLocation;
+    GLint debugModeLocation;
+    GLint debugColorLocation;
+} DrawRepeatedProgram;
+
+// Number of frames a GPU timer query may stay in flight before its result is needed
+#define GPU_TIMER_FRAME_LATENCY 4
+#define GPU_TIMER_MAX_QUERIES 1024
+
+typedef enum GPUTimestampKind {
+    GPU_TIMESTAMP_FRAME_BEGIN,
+    GPU_TIMESTAMP_FRAME_END,
+    GPU_TIMESTAMP_PASS_BEGIN,
+    GPU_TIMESTAMP_PASS_END,
+    // Taken after a draw call, the time since previous timestamp is accounted to the draw call
+    GPU_TIMESTAMP_DRAW,
+} GPUTimestampKind;
+
+typedef struct GPUTimestamp {
+    GPUTimestampKind kind;
+    int pass;
+    RenderProgramKind program;
+    const char *layer;
+} GPUTimestamp;
+
+typedef struct GPUTimerFrame {
+    int isPending;
+    int frameIndex;
+    int queryCount;
+    GLuint queries[GPU_TIMER_MAX_QUERIES];
+    GPUTimestamp timestamps[GPU_TIMER_MAX_QUERIES];
+    // GL_SAMPLES_PASSED over the whole frame
+    GLuint samplesQuery;
+    int passCount;
+    const char *passNames[MAX_RENDER_PASSES];
+} GPUTimerFrame;
+
+typedef struct GPUTimer {
+    int frameIndex;
+    int currentFrame;
+    // -1 if not inside a pass
+    int currentPass;
+    // 0 if the begin timestamp of the current pass was dropped, its end must be dropped too
+    int isPassTimed;
+    const char *currentLayer;
+    GPUTimerFrame frames[GPU_TIMER_FRAME_LATENCY];
+    RenderTimings timings;
+} GPUTimer;
+
+// The part of RenderContext replaced while drawing into a render target
+typedef struct RenderView {
+    float width;
+    float height;
+    float pointToPixel;
+    float pixelToPoint;
+    T2 projection;
+    T2 camera;
+} RenderView;
+
+// Must match the ViewConstants block of the shaders, laid out by std140 where each column of a mat3 takes a vec4
+typedef struct GLViewConstants {
+    GLfloat viewProjection[12];
+    GLfloat viewSize[2];
+    GLfloat pointToPixel;
+    GLfloat time;
+} GLViewConstants;
+
+// Binding point of the ViewConstants block in every program using it
+#define VIEW_CONSTANTS_BINDING 0
+// Distinct views drawn in a frame before the buffer has to be orphaned in the middle of it
+#define MAX_VIEW_CONSTANTS 64
+
+// What the constants of a view are computed from
+typedef struct ViewConstantsKey {
+    T2 projection;
+    T2 camera;
+    float width;
+    float height;
+    float pointToPixel;
+} ViewConstantsKey;
+
+// Constants of the views drawn in the frame, one slot each. Draws bind the slot of their view instead of uploading
+// a matrix of their own, so they only cost a glBindBufferRange when the view changes.
+typedef struct ViewConstantsBuffer {
+    GLuint ubo;
+    // Size of a slot, rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    GLint slotSize;
+    int slotCount;
+    ViewConstantsKey keys[MAX_VIEW_CONSTANTS];
+    // Slot found by the last lookup, -1 if none
+    int lastSlot;
+    // Slot bound to VIEW_CONSTANTS_BINDING, -1 if none
+    int boundSlot;
+    // Seconds since startTick, latched by ClearDrawing
+    float time;
+    Tick startTick;
+} ViewConstantsBuffer;
+
+// Binding point of the ClipRects block of draw_sprite.vert
+#define CLIP_RECTS_BINDING 1
+// Clip rects sprites can refer to until the buffer has to be orphaned. Must match MAX_CLIP_RECTS in draw_sprite.vert
+#define MAX_SPRITE_CLIP_RECTS ((1 << (8 - SPRITE_KIND_BITS)) - 1)
+#define MAX_CLIP_RECT_DEPTH 16
+
+// Must match the ClipRects block of draw_sprite.vert, the min and max of each rect in world space
+typedef struct GLClipRect {
+    GLfloat min[2];
+    GLfloat max[2];
+} GLClipRect;
+
+typedef struct ClipRect {
+    T2 transform;
+    BBox2 rect;
+    // Not axis aligned in world space, so it is drawn into the stencil buffer
+    int isRotated;
+    // Intersection of the axis aligned clips of the stack up to this one, in world space. Valid if hasBBox.
+    int hasBBox;
+    BBox2 bbox;
+    // Slot of bbox plus one, 0 if it was not written since the buffer was reset
+    int slot;
+} ClipRect;
+
+// Clips pushed by PushClipRect. Like view constants, the axis aligned clips drawn in the frame get a slot of a
+// uniform buffer, and sprites refer to the slot of their clip in their vertices, so they are clipped by
+// gl_ClipDistance in any command and pushing or popping a clip breaks no batch.
+typedef struct ClipRectStack {
+    int count;
+    ClipRect entries[MAX_CLIP_RECT_DEPTH];
+    // Rotated clips in the stack, the stencil value of the pixels inside all of them
+    int stencilDepth;
+    GLuint ubo;
+    int slotCount;
+    BBox2 slots[MAX_SPRITE_CLIP_RECTS];
+} ClipRectStack;
+
+// Textures whose padded size is at most this in both dimensions are packed into texture arrays
+#define TEXTURE_ARRAY_MAX_SIZE 256
+// Memory budget of one texture array, which decides its number of layers
+#define TEXTURE_ARRAY_PAGE_BYTES (4 * 1024 * 1024)
+// Layers fit in the layer byte of sprite vertices and in layerMask
+#define TEXTURE_ARRAY_MAX_LAYERS 64
+#define TEXTURE_ARRAY_MIN_LAYERS 4
+
+// Texture array holding textures of one size class. Sprites of any texture of the page can share a draw call.
+typedef struct TextureArrayPage {
+    GLuint id;
+    int width;
+    int height;
+    int layerCount;
+    // Bit i is set if layer i is used
+    uint64_t layerMask;
+    // Layers of destroyed textures that queued sprites may still sample, released after the next flush
+    uint64_t pendingFreeMask;
+    struct TextureArrayPage *next;
+} TextureArrayPage;
+
+// GL_ARB_get_program_binary and GL_KHR_parallel_shader_compile are not part of GL 3.3 core, so they are
+// loaded by hand if the driver supports them.
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+#define PROGRAM_BINARY_MAGIC 0x50445452 // "RTDP"
+
+typedef struct ProgramBinaryHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint32_t length;
+} ProgramBinaryHeader;
+
+// Compiled programs are persisted in dir, keyed by the hash of driver strings and shader sources
+typedef struct ProgramBinaryCache {
+    // Copy of the directory passed to CreateRenderContext, kept for materials built later. NULL if disabled.
+    char *dir;
+    uint64_t driverHash;
+    PFNGLGETPROGRAMBINARYPROC getProgramBinary;
+    PFNGLPROGRAMBINARYPROC programBinary;
+    PFNGLPROGRAMPARAMETERIPROC programParameteri;
+} ProgramBinaryCache;
 
 typedef struct RenderContextInternal {
     DrawTextureProgram drawTextureProgram;
-    DrawRectProgram drawRectProgram;
+    DrawSpriteProgram drawSpriteProgram;
+    DrawParticleProgram drawParticleProgram;
+    DrawLightProgram drawLightProgram;
+    DrawShadowProgram drawShadowProgram;
+    // Post programs draw without vertex buffers, but core profile still needs a VAO bound
+    GLuint postVao;
+    DrawPostProgram postDownsampleProgram;
+    DrawPostProgram postUpsampleProgram;
+    DrawPostProgram postGradeProgram;
+    DrawPostProgram postVignetteProgram;
+    DrawRepeatedProgram drawRepeatedProgram;
+    GPUTimer gpuTimer;
+    SpriteBatch spriteBatch;
+    ViewConstantsBuffer viewConstants;
+    ClipRectStack clipRects;
+    // Kept for programs built after the render context, see CreateMaterial
+    ProgramBinaryCache programBinaryCache;
+    // Material of the sprites pushed by DrawTextureWithMaterial, NULL otherwise
+    const Material *currentMaterial;
+
+    RenderTarget *currentTarget;
+    RenderView windowView;
+
+    // rc->debugMode latched by ClearDrawing for the whole frame
+    RenderDebugMode debugMode;
+    // Copy of the window to colorize overdraw from, created on demand
+    RenderTarget *overdrawTarget;
+    BatchBreakLog batchBreakLog;
+    BatchBreakLog lastBatchBreakLog;
+
+    PathMeshCacheEntry pathMeshCache[PATH_MESH_CACHE_SIZE];
+
+    TextureArrayPage *textureArrayPages;
+
+    // Lights of DrawLights reordered so the ones without shadows are contiguous
+    int lightScratchCapacity;
+    PointLight *lightScratch;
+
+    // Only set for RENDER_BACKEND_SOFTWARE, which uses none of the GL objects above
+    SoftwareRenderer *softwareRenderer;
+    // Path vertices transformed into pixels for the software renderer
+    int softwarePathVertexCapacity;
+    V2 *softwarePathVertices;
 } RenderContextInternal;
 
 typedef struct GLTexture {
+    // Texture of its own. For textures in a texture array, only created by GetGLTexture2D when needed.
     GLuint id;
+    // Texture array holding the texture in layer, NULL if none
+    TextureArrayPage *page;
+    int layer;
+    // Only coverage is stored, drawn as SPRITE_KIND_GLYPH
+    int isAlphaOnly;
+    // Color buffer of a render target, drawn as SPRITE_KIND_COMPOSITE
+    int isRenderTarget;
 } GLTexture;
 
+// Static mesh of a software render context, its quads are drawn like sprites
+typedef struct SoftwareStaticMesh {
+    int quadCount;
+    // Applied before the transform of the draw
+    T2 *transforms;
+    BBox2 *dstBBoxes;
+    // Normalized
+    BBox2 *texBBoxes;
+} SoftwareStaticMesh;
+
+typedef struct RenderTargetInternal {
+    GLuint fbo;
+    GLuint depthRbo;
+} RenderTargetInternal;
+
+typedef struct StaticMeshInternal {
+    GLuint vao;
+    GLuint vbo;
+    GLuint ebo;
+    // GL_UNSIGNED_SHORT unless the mesh has too many vertices
+    GLenum indexType;
+} StaticMeshInternal;
+
+// Each edge of the occluder is a quad extruded away from the light by draw_shadow.vert, 6 vertices of x, y, w
+typedef struct LightOccluderInternal {
+    GLuint vao;
+    GLuint vbo;
+    GLsizei shadowVertexCount;
+} LightOccluderInternal;
+
+typedef struct FrameReadbackSlot {
+    GLuint pbo;
+    GLsizeiptr pboSize;
+    // Signaled once the copy into pbo is done, 0 while the slot is free
+    GLsync fence;
+    int width;
+    int height;
+} FrameReadbackSlot;
+
+// Ring of slots, the pending ones start at first
+typedef struct FrameReadbackInternal {
+    int first;
+    FrameReadbackSlot *slots;
+} FrameReadbackInternal;
+
+typedef struct ColorLUTInternal {
+    GLuint id;
+} ColorLUTInternal;
+
+// Size of the alpha textures glyphs are packed into
+#define GLYPH_ATLAS_SIZE 512
+// Empty texels between glyphs
+#define GLYPH_ATLAS_PADDING 1
+
+// Texture holding the glyphs of a font, packed left to right on shelves stacked from the bottom. Glyphs are never
+// removed, a page is added when the last one is full.
+typedef struct GlyphAtlasPage {
+    Texture *texture;
+    int shelfX;
+    int shelfY;
+    int shelfHeight;
+    struct GlyphAtlasPage *next;
+} GlyphAtlasPage;
+
+// Bitmap of a code point at a scale, rasterized by the first DrawLineText using it
+typedef struct Glyph {
+    int codePoint;
+    // Of stbtt_ScaleForPixelHeight, 0 if the slot is empty
+    float scale;
+    // NULL if the glyph has no bitmap, e.g. a space
+    Texture *texture;
+    // In pixels of texture
+    BBox2 srcBBox;
+    int xOff;
+    int yOff;
+} Glyph;
+
 typedef struct FontInternal {
     void *buf;
     stbtt_fontinfo info;
+    // Open addressing on code point and scale, glyphCapacity is a power of two
+    int glyphCount;
+    int glyphCapacity;
+    Glyph *glyphs;
+    // Latest first, glyphs are only added to the first one
+    GlyphAtlasPage *pages;
 } FontInternal;
 
-static GLuint CompileGLShader(GLenum type, const char *source) {
+// A program whose compilation was kicked off by BeginBuildGLProgram and is finished by EndBuildGLProgram
+typedef struct GLProgramBuild {
+    const char *name;
+    uint64_t key;
+    GLuint vs;
+    GLuint fs;
+    GLuint program;
+    int isFromCache;
+    Tick startTick;
+} GLProgramBuild;
+
+// FNV-1a
+static uint64_t HashString(uint64_t hash, const char *str) {
+    for (const unsigned char *c = (const unsigned char *) str; *c; ++c) {
+        hash ^= *c;
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// FNV-1a
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static void SetupProgramBinaryCache(ProgramBinaryCache *cache, const char *dir) {
+    memset(cache, 0, sizeof(ProgramBinaryCache));
+
+    if (dir && SDL_GL_ExtensionSupported("GL_ARB_get_program_binary")) {
+        cache->getProgramBinary = (PFNGLGETPROGRAMBINARYPROC) SDL_GL_GetProcAddress("glGetProgramBinary");
+        cache->programBinary = (PFNGLPROGRAMBINARYPROC) SDL_GL_GetProcAddress("glProgramBinary");
+        cache->programParameteri = (PFNGLPROGRAMPARAMETERIPROC) SDL_GL_GetProcAddress("glProgramParameteri");
+        if (cache->getProgramBinary && cache->programBinary && cache->programParameteri) {
+            cache->dir = SDL_strdup(dir);
+        }
+    }
+
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash = HashString(hash, (const char *) glGetString(GL_VENDOR));
+    hash = HashString(hash, (const char *) glGetString(GL_RENDERER));
+    hash = HashString(hash, (const char *) glGetString(GL_VERSION));
+    cache->driverHash = hash;
+
+    // Let the driver compile shaders on its own threads, it is a no-op if the driver doesn't support it
+    if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads =
+                (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR");
+        if (maxShaderCompilerThreads) {
+            maxShaderCompilerThreads(0xFFFFFFFF);
+        }
+    }
+}
+
+static void GetProgramBinaryPath(ProgramBinaryCache *cache, uint64_t key, char *buf, size_t size) {
+    snprintf(buf, size, "%sprogram_%016llx.bin", cache->dir, (unsigned long long) key);
+}
+
+// Return 0 if the binary is missing or rejected by the driver. Files that are truncated, don't match their header or
+// are rejected by the driver are deleted, so they are written again after compiling.
+static GLuint LoadProgramBinary(ProgramBinaryCache *cache, uint64_t key) {
+    char path[1024];
+    GetProgramBinaryPath(cache, key, path, sizeof(path));
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+
+    long fileSize = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        fileSize = ftell(file);
+    }
+    rewind(file);
+
+    GLuint result = 0;
+    int isBad = 1;
+    ProgramBinaryHeader header;
+    // The length comes from the file, only trust it if it is exactly what follows the header
+    if (fileSize > (long) sizeof(header) && fread(&header, sizeof(header), 1, file) == 1 &&
+        header.magic == PROGRAM_BINARY_MAGIC && header.length <= INT32_MAX &&
+        (long) header.length == fileSize - (long) sizeof(header)) {
+        void *binary = malloc(header.length);
+        if (binary == NULL) {
+            // Out of memory, not the fault of the file
+            isBad = 0;
+        } else if (fread(binary, 1, header.length, file) == header.length) {
+            result = glCreateProgram();
+            cache->programBinary(result, header.format, binary, (GLsizei) header.length);
+
+            // Driver updates invalidate binaries, in that case the program has to be compiled again
+            GLint success;
+            glGetProgramiv(result, GL_LINK_STATUS, &success);
+            if (success != GL_TRUE) {
+                glDeleteProgram(result);
+                result = 0;
+            } else {
+                isBad = 0;
+            }
+        }
+        free(binary);
+    }
+
+    fclose(file);
+
+    if (isBad) {
+        printf("Discarded program binary: %s\n", path);
+        remove(path);
+    }
+
+    return result;
+}
+
+static void SaveProgramBinary(ProgramBinaryCache *cache, uint64_t key, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    ProgramBinaryHeader header;
+    header.magic = PROGRAM_BINARY_MAGIC;
+    header.length = (uint32_t) length;
+
+    void *binary = malloc((size_t) length);
+    GLenum format = 0;
+    cache->getProgramBinary(program, length, NULL, &format, binary);
+    header.format = format;
+
+    char path[1024];
+    GetProgramBinaryPath(cache, key, path, sizeof(path));
+
+    FILE *file = fopen(path, "wb");
+    if (file) {
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(binary, 1, (size_t) length, file);
+        fclose(file);
+    } else {
+        printf("Failed to write program binary: %s\n", path);
+    }
+
+    free(binary);
+}
+
+// Shaders with a variant matrix are embedded by char2hex as their variants one after the other, each ending with 0
+static const char *GetShaderVariant(const char *sources, int variant) {
+    for (int i = 0; i < variant; ++i) {
+        sources += strlen(sources) + 1;
+    }
+    return sources;
+}
+
+static GLuint CreateGLShader(GLenum type, const char *source) {
     GLuint result = glCreateShader(type);
 
     glShaderSource(result, 1, &source, 0);
 
     glCompileShader(result);
 
+    return result;
+}
+
+static int CheckGLShader(GLuint shader) {
     GLint success;
-    glGetShaderiv(result, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if (success != GL_TRUE) {
         char buf[512];
-        glGetShaderInfoLog(result, sizeof(buf), 0, buf);
+        glGetShaderInfoLog(shader, sizeof(buf), 0, buf);
         printf("Failed to compile shader: %s\n", buf);
-        result = 0;
+        return 0;
     }
 
-    return result;
+    return 1;
 }
 
-static GLuint CompileGLProgram(const char *vss, const char *fss) {
-    GLuint result = 0;
+// Issue compile and link without waiting on the results, so the driver can build several programs concurrently
+static void BeginBuildGLProgram(GLProgramBuild *build, ProgramBinaryCache *cache, const char *name,
+                                const char *vss, const char *fss) {
+    build->name = name;
+    build->startTick = GetCurrentTick();
+    build->key = HashString(HashString(cache->driverHash, vss), fss);
+    build->vs = 0;
+    build->fs = 0;
+    build->isFromCache = 0;
+
+    if (cache->dir) {
+        build->program = LoadProgramBinary(cache, build->key);
+        if (build->program) {
+            build->isFromCache = 1;
+            return;
+        }
+    }
 
-    GLuint vs = CompileGLShader(GL_VERTEX_SHADER, vss);
-    if (vs) {
-        GLuint fs = CompileGLShader(GL_FRAGMENT_SHADER, fss);
-        if (fs) {
-            result = glCreateProgram();
-            glAttachShader(result, vs);
-            glAttachShader(result, fs);
-            glLinkProgram(result);
+    build->vs = CreateGLShader(GL_VERTEX_SHADER, vss);
+    build->fs = CreateGLShader(GL_FRAGMENT_SHADER, fss);
 
+    build->program = glCreateProgram();
+    if (cache->dir) {
+        cache->programParameteri(build->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(build->program, build->vs);
+    glAttachShader(build->program, build->fs);
+    glLinkProgram(build->program);
+}
+
+// Wait for the build to finish. Exit if the program failed to compile.
+static GLuint EndBuildGLProgram(GLProgramBuild *build, ProgramBinaryCache *cache) {
+    GLuint result = build->program;
+
+    if (!build->isFromCache) {
+        if (CheckGLShader(build->vs) && CheckGLShader(build->fs)) {
             GLint success;
             glGetProgramiv(result, GL_LINK_STATUS, &success);
             if (success != GL_TRUE) {
@@ -118,229 +853,1845 @@ static GLuint CompileGLProgram(const char *vss, const char *fss) {
                 printf("Failed to link program: %s\n", buf);
                 result = 0;
             }
+        } else {
+            result = 0;
         }
+
+        glDeleteShader(build->vs);
+        glDeleteShader(build->fs);
+
+        if (result && cache->dir) {
+            SaveProgramBinary(cache, build->key, result);
+        }
+    }
+
+    if (!result) {
+        exit(EXIT_FAILURE);
     }
 
+    printf("Program %s: %s in %.2f ms\n", build->name, build->isFromCache ? "loaded from cache" : "compiled",
+           TickToSecond(GetCurrentTick() - build->startTick) * 1000.0f);
+
     return result;
 }
 
-static void SetupDrawTextureProgram(DrawTextureProgram *drawTextureProgram) {
-    // Setup VAO
-    glGenVertexArrays(1, &drawTextureProgram->vao);
-    glGenBuffers(1, &drawTextureProgram->vbo);
-    glGenBuffers(1, &drawTextureProgram->ebo);
+// Make the ViewConstants block of program read from VIEW_CONSTANTS_BINDING
+static void SetupViewConstantsBlock(GLuint program) {
+    GLuint index = glGetUniformBlockIndex(program, "ViewConstants");
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, index, VIEW_CONSTANTS_BINDING);
+    }
+}
 
-    glBindVertexArray(drawTextureProgram->vao);
-    glBindBuffer(GL_ARRAY_BUFFER, drawTextureProgram->vbo);
-    glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW);
+// Make the ClipRects block of program read from CLIP_RECTS_BINDING
+static void SetupClipRectsBlock(GLuint program) {
+    GLuint index = glGetUniformBlockIndex(program, "ClipRects");
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, index, CLIP_RECTS_BINDING);
+    }
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawTextureProgram->ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW);
+// Forget the views written so far, orphaning their storage so it is not waited on
+static void ResetViewConstants(ViewConstantsBuffer *viewConstants) {
+    glBindBuffer(GL_UNIFORM_BUFFER, viewConstants->ubo);
+    glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr) viewConstants->slotSize * MAX_VIEW_CONSTANTS, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DrawTextureVertexAttrib), (void *) offsetof(DrawTextureVertexAttrib, transform0));
-    glEnableVertexAttribArray(0);
+    viewConstants->slotCount = 0;
+    viewConstants->lastSlot = -1;
+    viewConstants->boundSlot = -1;
+}
 
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(DrawTextureVertexAttrib), (void *) offsetof(DrawTextureVertexAttrib, transform1));
-    glEnableVertexAttribArray(1);
+// Forget the clip rects written so far, like ResetViewConstants
+static void ResetClipRects(ClipRectStack *clipRects) {
+    glBindBuffer(GL_UNIFORM_BUFFER, clipRects->ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(GLClipRect) * MAX_SPRITE_CLIP_RECTS, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(DrawTextureVertexAttrib), (void *) offsetof(DrawTextureVertexAttrib, transform2));
-    glEnableVertexAttribArray(2);
+    clipRects->slotCount = 0;
+    for (int i = 0; i < clipRects->count; ++i) {
+        clipRects->entries[i].slot = 0;
+    }
+}
 
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(DrawTextureVertexAttrib), (void *) offsetof(DrawTextureVertexAttrib, pos));
-    glEnableVertexAttribArray(3);
+static void SetupClipRectStack(ClipRectStack *clipRects) {
+    clipRects->count = 0;
+    clipRects->stencilDepth = 0;
 
-    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(DrawTextureVertexAttrib), (void *) offsetof(DrawTextureVertexAttrib, texCoord));
-    glEnableVertexAttribArray(4);
+    glGenBuffers(1, &clipRects->ubo);
+    ResetClipRects(clipRects);
+    // Every sprite program reads the same rects, so the buffer stays bound
+    glBindBufferBase(GL_UNIFORM_BUFFER, CLIP_RECTS_BINDING, clipRects->ubo);
+}
 
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(DrawTextureVertexAttrib), (void *) offsetof(DrawTextureVertexAttrib, color));
-    glEnableVertexAttribArray(5);
+static void SetupViewConstantsBuffer(ViewConstantsBuffer *viewConstants) {
+    GLint alignment = 1;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    viewConstants->slotSize = ((GLint) sizeof(GLViewConstants) + alignment - 1) / alignment * alignment;
+    viewConstants->time = 0.0f;
+    viewConstants->startTick = GetCurrentTick();
 
-    glBindVertexArray(0);
+    glGenBuffers(1, &viewConstants->ubo);
+    ResetViewConstants(viewConstants);
+}
 
-    // Compile Program
-    drawTextureProgram->program = CompileGLProgram(DRAW_TEXTURE_VERTEX_SHADER, DRAW_TEXTURE_FRAGMENT_SHADER);
-    if (!drawTextureProgram->program) {
-        exit(EXIT_FAILURE);
-    }
+// Setup vertex attributes of DrawTextureVertexAttrib for the currently bound VAO and VBO
+static void SetupDrawTextureVertexAttribs(void) {
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(DrawTextureVertexAttrib), (void *) offsetof(DrawTextureVertexAttrib, pos));
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(DrawTextureVertexAttrib), (void *) offsetof(DrawTextureVertexAttrib, texCoord));
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DrawTextureVertexAttrib), (void *) offsetof(DrawTextureVertexAttrib, color));
+    glEnableVertexAttribArray(2);
+}
+
+static void SetupDrawTextureProgram(DrawTextureProgram *drawTextureProgram, GLuint program) {
+    drawTextureProgram->program = program;
     glUseProgram(drawTextureProgram->program);
     glUniform1i(glGetUniformLocation(drawTextureProgram->program, "texture0"), 0);
-    drawTextureProgram->MVPLocation = glGetUniformLocation(drawTextureProgram->program, "MVP");
+    SetupViewConstantsBlock(drawTextureProgram->program);
+    drawTextureProgram->modelLocation = glGetUniformLocation(drawTextureProgram->program, "model");
+    drawTextureProgram->debugModeLocation = glGetUniformLocation(drawTextureProgram->program, "debugMode");
+    drawTextureProgram->debugColorLocation = glGetUniformLocation(drawTextureProgram->program, "debugColor");
+}
+
+static void SetupDrawSpriteVariant(DrawSpriteVariant *variant, GLuint program) {
+    variant->program = program;
+    glUseProgram(variant->program);
+    glUniform1i(glGetUniformLocation(variant->program, "texture0"), 0);
+    glUniform1i(glGetUniformLocation(variant->program, "textureArray"), 1);
+    SetupViewConstantsBlock(variant->program);
+    SetupClipRectsBlock(variant->program);
+    variant->debugModeLocation = glGetUniformLocation(variant->program, "debugMode");
+    variant->debugColorLocation = glGetUniformLocation(variant->program, "debugColor");
 }
 
-static void SetupDrawRectProgram(DrawRectProgram *drawRectProgram) {
+static void SetupDrawSpriteProgram(DrawSpriteProgram *drawSpriteProgram) {
     // Setup VAO
-    glGenVertexArrays(1, &drawRectProgram->vao);
-    glGenBuffers(1, &drawRectProgram->vbo);
-    glGenBuffers(1, &drawRectProgram->ebo);
+    glGenVertexArrays(1, &drawSpriteProgram->vao);
+    glGenBuffers(1, &drawSpriteProgram->vbo);
+    glGenBuffers(1, &drawSpriteProgram->ebo);
 
-    glBindVertexArray(drawRectProgram->vao);
-    glBindBuffer(GL_ARRAY_BUFFER, drawRectProgram->vbo);
+    glBindVertexArray(drawSpriteProgram->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, drawSpriteProgram->vbo);
     glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawRectProgram->ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawSpriteProgram->ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DrawRectVertexAttrib), (void *) offsetof(DrawRectVertexAttrib, transform0));
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(DrawSpriteVertexAttrib), (void *) offsetof(DrawSpriteVertexAttrib, pos));
     glEnableVertexAttribArray(0);
 
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(DrawRectVertexAttrib), (void *) offsetof(DrawRectVertexAttrib, transform1));
+    glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(DrawSpriteVertexAttrib), (void *) offsetof(DrawSpriteVertexAttrib, texCoord));
     glEnableVertexAttribArray(1);
 
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(DrawRectVertexAttrib), (void *) offsetof(DrawRectVertexAttrib, transform2));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DrawSpriteVertexAttrib), (void *) offsetof(DrawSpriteVertexAttrib, color));
     glEnableVertexAttribArray(2);
 
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(DrawRectVertexAttrib), (void *) offsetof(DrawRectVertexAttrib, pos));
+    glVertexAttribPointer(3, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(DrawSpriteVertexAttrib), (void *) offsetof(DrawSpriteVertexAttrib, roundRadius));
     glEnableVertexAttribArray(3);
 
-    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(DrawRectVertexAttrib), (void *) offsetof(DrawRectVertexAttrib, texCoord));
+    glVertexAttribPointer(4, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(DrawSpriteVertexAttrib), (void *) offsetof(DrawSpriteVertexAttrib, thickness));
     glEnableVertexAttribArray(4);
 
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(DrawRectVertexAttrib), (void *) offsetof(DrawRectVertexAttrib, color));
+    glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DrawSpriteVertexAttrib), (void *) offsetof(DrawSpriteVertexAttrib, borderColor));
     glEnableVertexAttribArray(5);
 
-    glVertexAttribPointer(6, 2, GL_FLOAT, GL_FALSE, sizeof(DrawRectVertexAttrib), (void *) offsetof(DrawRectVertexAttrib, roundRadius));
+    glVertexAttribIPointer(6, 1, GL_UNSIGNED_BYTE, sizeof(DrawSpriteVertexAttrib), (void *) offsetof(DrawSpriteVertexAttrib, kind));
     glEnableVertexAttribArray(6);
 
-    glVertexAttribPointer(7, 2, GL_FLOAT, GL_FALSE, sizeof(DrawRectVertexAttrib), (void *) offsetof(DrawRectVertexAttrib, thickness));
+    glVertexAttribPointer(7, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(DrawSpriteVertexAttrib), (void *) offsetof(DrawSpriteVertexAttrib, depth));
     glEnableVertexAttribArray(7);
 
-    glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(DrawRectVertexAttrib), (void *) offsetof(DrawRectVertexAttrib, borderColor));
+    glVertexAttribIPointer(8, 1, GL_UNSIGNED_BYTE, sizeof(DrawSpriteVertexAttrib), (void *) offsetof(DrawSpriteVertexAttrib, layer));
     glEnableVertexAttribArray(8);
 
     glBindVertexArray(0);
-
-    // Compile Program
-    drawRectProgram->program = CompileGLProgram(DRAW_RECT_VERTEX_SHADER, DRAW_RECT_FRAGMENT_SHADER);
-    if (!drawRectProgram->program) {
-        exit(EXIT_FAILURE);
-    }
-    glUseProgram(drawRectProgram->program);
-    drawRectProgram->MVPLocation = glGetUniformLocation(drawRectProgram->program, "MVP");
 }
 
-// TODO(coeuvre): Allow to define filter mode
-static void UploadImageToGPU(Texture *tex, const unsigned char *data, int width, int height, int stride, ImageChannel channel) {
-    GLTexture *glTex = tex->internal;
-
-    glGenTextures(1, &glTex->id);
-    glBindTexture(GL_TEXTURE_2D, glTex->id);
+static void SetupSpriteBatch(SpriteBatch *spriteBatch) {
+    spriteBatch->vertexCount = 0;
+    spriteBatch->indexCount = 0;
+    spriteBatch->chunkCount = 0;
+    spriteBatch->commandCount = 0;
+    spriteBatch->lastTranslucentCommand = -1;
+    spriteBatch->depth = SPRITE_MAX_DEPTH;
+    spriteBatch->pendingDeleteTextureCount = 0;
+    spriteBatch->pendingDeleteTextureCapacity = 0;
+    spriteBatch->pendingDeleteTextures = NULL;
+}
 
-    tex->actualWidth = (int) NextPow2F((float) width);
-    tex->actualHeight = height;
+static void SetupDrawParticleProgram(DrawParticleProgram *drawParticleProgram, GLuint program) {
+    // Setup VAO
+    glGenVertexArrays(1, &drawParticleProgram->vao);
+    glGenBuffers(1, &drawParticleProgram->cornerVbo);
+    glGenBuffers(1, &drawParticleProgram->instanceVbo);
+    drawParticleProgram->instanceVboSize = 0;
+
+    glBindVertexArray(drawParticleProgram->vao);
+
+    // Triangle strip of an unit quad centered at origin
+    F corners[] = {
+        -0.5f, -0.5f,
+         0.5f, -0.5f,
+        -0.5f,  0.5f,
+         0.5f,  0.5f,
+    };
+    glBindBuffer(GL_ARRAY_BUFFER, drawParticleProgram->cornerVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
 
-    int texStride = 0;
-    GLint numberOfPixels = 0;
-    GLint internalFormat = 0;
-    GLenum format = 0;
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(F) * 2, (void *) 0);
+    glEnableVertexAttribArray(0);
 
-    switch (channel) {
-        case IMAGE_CHANNEL_RGBA: {
-            texStride = tex->actualWidth * 4;
-            numberOfPixels = tex->actualWidth;
+    // Instance attribute pointers depend on the instance count, they are set at draw time
+    for (GLuint i = 1; i <= DRAW_PARTICLE_INSTANCE_ATTRIB_COUNT; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
 
-            internalFormat = GL_SRGB8_ALPHA8;
-            format = GL_RGBA;
-        } break;
-        case IMAGE_CHANNEL_A: {
-            texStride = (int) (CeilF(tex->actualWidth / 4.0f) * 4.0f);
-            numberOfPixels = texStride;
+    glBindVertexArray(0);
 
-            internalFormat = GL_R8;
-            format = GL_RED;
+    drawParticleProgram->program = program;
+    glUseProgram(drawParticleProgram->program);
+    glUniform1i(glGetUniformLocation(drawParticleProgram->program, "texture0"), 0);
+    SetupViewConstantsBlock(drawParticleProgram->program);
+    drawParticleProgram->texCoordScaleLocation = glGetUniformLocation(drawParticleProgram->program, "texCoordScale");
+    drawParticleProgram->debugModeLocation = glGetUniformLocation(drawParticleProgram->program, "debugMode");
+    drawParticleProgram->debugColorLocation = glGetUniformLocation(drawParticleProgram->program, "debugColor");
+}
 
-            GLint swizzleMask[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
-            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
-        } break;
-    }
+static void SetupDrawLightProgram(DrawLightProgram *drawLightProgram, GLuint program) {
+    glGenVertexArrays(1, &drawLightProgram->vao);
+    glGenBuffers(1, &drawLightProgram->cornerVbo);
+    glGenBuffers(1, &drawLightProgram->instanceVbo);
+    drawLightProgram->instanceVboSize = 0;
 
-    assert(stride <= texStride);
-    assert(tex->actualWidth % 2 == 0);
-    assert(texStride % 4 == 0);
+    glBindVertexArray(drawLightProgram->vao);
 
-    size_t texBufLen = (size_t) texStride * tex->actualHeight;
-    unsigned char *texBuf = malloc(texBufLen);
-    memset(texBuf, 0, texBufLen);
+    // Triangle strip of a quad spanning one radius around the light
+    F corners[] = {
+        -1.0f, -1.0f,
+         1.0f, -1.0f,
+        -1.0f,  1.0f,
+         1.0f,  1.0f,
+    };
+    glBindBuffer(GL_ARRAY_BUFFER, drawLightProgram->cornerVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
 
-    unsigned char *dstRow = texBuf;
-    const unsigned char *srcRow = data + stride * (height - 1);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(F) * 2, (void *) 0);
+    glEnableVertexAttribArray(0);
 
-    // Flip image vertically
-    for (int y = 0; y < height; ++y) {
-        memcpy(dstRow, srcRow, (size_t) stride);
-        dstRow += texStride;
-        srcRow -= stride;
+    // Instance attribute pointers depend on the first light drawn, they are set at draw time
+    for (GLuint i = 1; i <= 3; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
     }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindVertexArray(0);
 
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, numberOfPixels);
-    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, tex->actualWidth, tex->actualHeight, 0, format, GL_UNSIGNED_BYTE, texBuf);
+    drawLightProgram->program = program;
+    SetupViewConstantsBlock(drawLightProgram->program);
+}
 
-    free(texBuf);
+static void SetupDrawShadowProgram(DrawShadowProgram *drawShadowProgram, GLuint program) {
+    drawShadowProgram->program = program;
+    SetupViewConstantsBlock(drawShadowProgram->program);
+    drawShadowProgram->lightPosLocation = glGetUniformLocation(drawShadowProgram->program, "lightPos");
 }
 
+static void SetupDrawPostProgram(DrawPostProgram *drawPostProgram, GLuint program) {
+    drawPostProgram->program = program;
+    glUseProgram(drawPostProgram->program);
+    glUniform1i(glGetUniformLocation(drawPostProgram->program, "source"), 0);
+    glUniform1i(glGetUniformLocation(drawPostProgram->program, "bloom"), 1);
+    glUniform1i(glGetUniformLocation(drawPostProgram->program, "lut"), 1);
+    drawPostProgram->texCoordScaleLocation = glGetUniformLocation(drawPostProgram->program, "texCoordScale");
+    drawPostProgram->texelSizeLocation = glGetUniformLocation(drawPostProgram->program, "texelSize");
+    drawPostProgram->maxTexCoordLocation = glGetUniformLocation(drawPostProgram->program, "maxTexCoord");
+    drawPostProgram->paramsLocation = glGetUniformLocation(drawPostProgram->program, "params");
+    drawPostProgram->bloomTexCoordScaleLocation = glGetUniformLocation(drawPostProgram->program, "bloomTexCoordScale");
+    drawPostProgram->bloomTexelSizeLocation = glGetUniformLocation(drawPostProgram->program, "bloomTexelSize");
+    drawPostProgram->bloomMaxTexCoordLocation = glGetUniformLocation(drawPostProgram->program, "bloomMaxTexCoord");
+}
 
-extern RenderContext *CreateRenderContext(int width, int height, float pointToPixel) {
-    RenderContext *rc = malloc(sizeof(RenderContext));
-    RenderContextInternal *renderContextInternal = malloc(sizeof(RenderContextInternal));
-    rc->internal = renderContextInternal;
+static void SetupDrawRepeatedProgram(DrawRepeatedProgram *drawRepeatedProgram, GLuint program) {
+    drawRepeatedProgram->program = program;
+    glUseProgram(drawRepeatedProgram->program);
+    glUniform1i(glGetUniformLocation(drawRepeatedProgram->program, "texture0"), 0);
+    // vTexCoord of draw_post.vert is unused, tiles are computed from vViewCoord
+    glUniform2f(glGetUniformLocation(drawRepeatedProgram->program, "texCoordScale"), 1.0f, 1.0f);
+    drawRepeatedProgram->tilingLocation = glGetUniformLocation(drawRepeatedProgram->program, "tiling");
+    drawRepeatedProgram->imageScaleLocation = glGetUniformLocation(drawRepeatedProgram->program, "imageScale");
+    drawRepeatedProgram->colorLocation = glGetUniformLocation(drawRepeatedProgram->program, "color");
+    drawRepeatedProgram->debugModeLocation = glGetUniformLocation(drawRepeatedProgram->program, "debugMode");
+    drawRepeatedProgram->debugColorLocation = glGetUniformLocation(drawRepeatedProgram->program, "debugColor");
+}
 
-    rc->width = (float) width;
-    rc->height = (float) height;
-    rc->pointToPixel = pointToPixel;
-    rc->pixelToPoint = 1.0f / pointToPixel;
-    rc->drawCallCount = 0;
-    rc->projection = DotT2(MakeT2FromTranslation(MakeV2(-1.0f, -1.0f)),
-                           MakeT2FromScale(MakeV2(1.0f / width * 2.0f,
-                                                  1.0f / height * 2.0f)));
-    rc->camera = IdentityT2();
+static void SetupGPUTimer(GPUTimer *gpuTimer) {
+    memset(gpuTimer, 0, sizeof(GPUTimer));
+    gpuTimer->currentPass = -1;
+    gpuTimer->timings.frameIndex = -1;
 
-    glViewport(0, 0, (GLsizei) (width * pointToPixel), (GLsizei) (height * pointToPixel));
+    for (int i = 0; i < GPU_TIMER_FRAME_LATENCY; ++i) {
+        glGenQueries(GPU_TIMER_MAX_QUERIES, gpuTimer->frames[i].queries);
+        glGenQueries(1, &gpuTimer->frames[i].samplesQuery);
+    }
+}
 
-    glEnable(GL_BLEND);
-    // Pre-multiplied alpha format
-    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-    // Render at linear color space
-    glEnable(GL_FRAMEBUFFER_SRGB);
+// Return 0 if the timestamp was dropped because the frame ran out of queries
+static int RecordGPUTimestamp(GPUTimer *gpuTimer, GPUTimestampKind kind, RenderProgramKind program) {
+    GPUTimerFrame *frame = &gpuTimer->frames[gpuTimer->currentFrame];
 
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    // Keep room for the pass and frame end timestamps
+    int reserved = kind == GPU_TIMESTAMP_DRAW || kind == GPU_TIMESTAMP_PASS_BEGIN ? 2 : 0;
+    if (frame->queryCount + reserved >= GPU_TIMER_MAX_QUERIES) {
+        return 0;
+    }
 
-    SetupDrawTextureProgram(&renderContextInternal->drawTextureProgram);
-    SetupDrawRectProgram(&renderContextInternal->drawRectProgram);
+    GPUTimestamp *timestamp = &frame->timestamps[frame->queryCount];
+    timestamp->kind = kind;
+    timestamp->pass = gpuTimer->currentPass;
+    timestamp->program = program;
+    timestamp->layer = gpuTimer->currentLayer;
 
-    return rc;
+    glQueryCounter(frame->queries[frame->queryCount], GL_TIMESTAMP);
+    frame->queryCount++;
+    return 1;
 }
 
-extern void ClearDrawing(RenderContext *rc) {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+static RenderLayerTiming *FindRenderLayerTiming(RenderPassTiming *pass, const char *name) {
+    for (int i = 0; i < pass->layerCount; ++i) {
+        if (strcmp(pass->layers[i].name, name) == 0) {
+            return &pass->layers[i];
+        }
+    }
 
-    rc->drawCallCount = 0;
+    if (pass->layerCount >= MAX_RENDER_LAYERS) {
+        return NULL;
+    }
+
+    RenderLayerTiming *layer = &pass->layers[pass->layerCount++];
+    layer->name = name;
+    layer->gpuMs = 0.0f;
+    return layer;
 }
 
-extern Texture *CreateTextureFromMemory(RenderContext *renderContext, const unsigned char *data, int width, int height, int stride, ImageChannel channel) {
-    (void) renderContext;
+// Read back the results of frame into timings. Return 0 without blocking if they are not ready yet.
+static int ResolveGPUTimerFrame(GPUTimerFrame *frame, RenderTimings *timings) {
+    GLuint available = 0;
+    glGetQueryObjectuiv(frame->queries[frame->queryCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return 0;
+    }
 
-    Texture *tex = malloc(sizeof(Texture));
-    GLTexture *glTex = malloc(sizeof(struct GLTexture));
-    tex->width = width;
-    tex->height = height;
+    timings->frameIndex = frame->frameIndex;
+    timings->gpuMs = 0.0f;
+    glGetQueryObjectui64v(frame->samplesQuery, GL_QUERY_RESULT, &timings->fragmentCount);
+    timings->passCount = frame->passCount;
+    for (int i = 0; i < frame->passCount; ++i) {
+        RenderPassTiming *pass = &timings->passes[i];
+        memset(pass, 0, sizeof(RenderPassTiming));
+        pass->name = frame->passNames[i];
+        // Set by the pass end, which is only recorded along with the pass begin
+        pass->gpuMs = -1.0f;
+    }
+
+    GLuint64 frameBegin = 0;
+    GLuint64 passBegin = 0;
+    GLuint64 prev = 0;
+    for (int i = 0; i < frame->queryCount; ++i) {
+        GLuint64 now;
+        glGetQueryObjectui64v(frame->queries[i], GL_QUERY_RESULT, &now);
+
+        GPUTimestamp *timestamp = &frame->timestamps[i];
+        switch (timestamp->kind) {
+            case GPU_TIMESTAMP_FRAME_BEGIN: {
+                frameBegin = now;
+            } break;
+            case GPU_TIMESTAMP_FRAME_END: {
+                timings->gpuMs = (now - frameBegin) / 1e6f;
+            } break;
+            case GPU_TIMESTAMP_PASS_BEGIN: {
+                passBegin = now;
+            } break;
+            case GPU_TIMESTAMP_PASS_END: {
+                timings->passes[timestamp->pass].gpuMs = (now - passBegin) / 1e6f;
+            } break;
+            case GPU_TIMESTAMP_DRAW: {
+                RenderPassTiming *pass = &timings->passes[timestamp->pass];
+                float ms = (now - prev) / 1e6f;
+                pass->programGPUMs[timestamp->program] += ms;
+                pass->drawCallCount++;
+
+                RenderLayerTiming *layer = timestamp->layer ? FindRenderLayerTiming(pass, timestamp->layer) : NULL;
+                if (layer) {
+                    layer->gpuMs += ms;
+                }
+            } break;
+        }
+
+        prev = now;
+    }
+
+    return 1;
+}
+
+// Called after every draw call
+static void CountDrawCall(RenderContext *rc, RenderProgramKind program) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    GPUTimer *gpuTimer = &renderContextInternal->gpuTimer;
+
+    rc->drawCallCount++;
+
+    if (gpuTimer->currentPass >= 0) {
+        RecordGPUTimestamp(gpuTimer, GPU_TIMESTAMP_DRAW, program);
+    }
+}
+
+// Called before every draw call, with the program in use
+static void SetDebugUniforms(RenderContext *rc, GLint debugModeLocation, GLint debugColorLocation) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    glUniform1i(debugModeLocation, renderContextInternal->debugMode);
+
+    switch (renderContextInternal->debugMode) {
+        case RENDER_DEBUG_MODE_OVERDRAW: {
+            F layer = 1.0f / OVERDRAW_MAX_LAYERS;
+            glUniform4f(debugColorLocation, layer, layer, layer, layer);
+        } break;
+        case RENDER_DEBUG_MODE_BATCH_ID: {
+            // Spread hues of consecutive draw calls by the golden ratio so neighbours stand apart
+            F hue = rc->drawCallCount * 0.618034f;
+            hue = (hue - FloorF(hue)) * 6.0f;
+            F r = ClampF(fabsf(hue - 3.0f) - 1.0f, 0.0f, 1.0f);
+            F g = ClampF(2.0f - fabsf(hue - 2.0f), 0.0f, 1.0f);
+            F b = ClampF(2.0f - fabsf(hue - 4.0f), 0.0f, 1.0f);
+            glUniform4f(debugColorLocation, r, g, b, 1.0f);
+        } break;
+        default: break;
+    }
+}
+
+static void RecordBatchBreak(RenderContext *rc, BatchBreakReason reason) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    BatchBreakLog *log = &renderContextInternal->batchBreakLog;
+
+    log->counts[reason]++;
+    if (log->entryCount < MAX_BATCH_BREAK_LOG_ENTRIES) {
+        BatchBreak *entry = &log->entries[log->entryCount];
+        entry->reason = reason;
+        entry->spriteIndex = rc->spriteCount;
+    }
+    log->entryCount++;
+}
+
+static T2 MakeProjection(float width, float height) {
+    return DotT2(MakeT2FromTranslation(MakeV2(-1.0f, -1.0f)),
+                 MakeT2FromScale(MakeV2(1.0f / width * 2.0f, 1.0f / height * 2.0f)));
+}
+
+static void BindViewConstants(RenderContext *rc, int slot) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    ViewConstantsBuffer *viewConstants = &renderContextInternal->viewConstants;
+
+    if (viewConstants->boundSlot != slot) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, VIEW_CONSTANTS_BINDING, viewConstants->ubo,
+                          (GLintptr) viewConstants->slotSize * slot, sizeof(GLViewConstants));
+        viewConstants->boundSlot = slot;
+    }
+}
+
+// Put the commands of the same material next to each other, keeping their order within each material
+static void GroupSpriteBatchCommandsByMaterial(SpriteBatch *spriteBatch, int count) {
+    int *order = spriteBatch->drawOrder;
+
+    for (int groupEnd = 0; groupEnd < count;) {
+        const MaterialInternal *material = spriteBatch->commands[order[groupEnd]].material;
+        groupEnd++;
+        for (int i = groupEnd; i < count; ++i) {
+            int command = order[i];
+            if (spriteBatch->commands[command].material == material) {
+                memmove(&order[groupEnd + 1], &order[groupEnd], sizeof(int) * (i - groupEnd));
+                order[groupEnd++] = command;
+            }
+        }
+    }
+}
+
+static void DrawSpriteBatchCommands(RenderContext *rc, int isOpaque) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    DrawSpriteProgram *drawSpriteProgram = &renderContextInternal->drawSpriteProgram;
+    SpriteBatch *spriteBatch = &renderContextInternal->spriteBatch;
+
+    // Opaque commands are drawn from the last one, which is the closest
+    int count = 0;
+    for (int i = 0; i < spriteBatch->commandCount; ++i) {
+        int command = isOpaque ? spriteBatch->commandCount - 1 - i : i;
+        if (spriteBatch->commands[command].isOpaque == isOpaque) {
+            spriteBatch->drawOrder[count++] = command;
+        }
+    }
+
+    // Depth keeps opaque commands correct in any order, so the ones of a material share the program switch
+    if (isOpaque) {
+        GroupSpriteBatchCommandsByMaterial(spriteBatch, count);
+    }
+
+    GLuint program = 0;
+    const V4 *params = NULL;
+    for (int i = 0; i < count; ++i) {
+        SpriteBatchCommand *command = &spriteBatch->commands[spriteBatch->drawOrder[i]];
+        const MaterialInternal *material = command->material;
+        const DrawSpriteVariant *variant = &drawSpriteProgram->variants[command->features];
+
+        GLuint commandProgram = material ? material->program : variant->program;
+        if (commandProgram != program) {
+            program = commandProgram;
+            glUseProgram(program);
+            params = NULL;
+        }
+        if (material && (params == NULL || memcmp(params, command->params, sizeof(command->params)) != 0)) {
+            params = command->params;
+            glUniform4fv(material->paramsLocation, MAX_MATERIAL_PARAMS, (const GLfloat *) params);
+        }
+
+        if (command->texture) {
+            glBindTexture(GL_TEXTURE_2D, command->texture);
+        }
+        if (command->textureArray) {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, command->textureArray);
+            glActiveTexture(GL_TEXTURE0);
+        }
+        BindViewConstants(rc, command->view);
+        if (!material) {
+            SetDebugUniforms(rc, variant->debugModeLocation, variant->debugColorLocation);
+        }
+
+        if (!isOpaque && command->isDepthWritten) {
+            glDepthMask(GL_TRUE);
+        }
+        glDrawElements(GL_TRIANGLES, command->indexCount, GL_UNSIGNED_SHORT,
+                       (void *) (sizeof(GLushort) * command->firstIndex));
+        if (!isOpaque && command->isDepthWritten) {
+            glDepthMask(GL_FALSE);
+        }
+
+        CountDrawCall(rc, material ? RENDER_PROGRAM_Material : RENDER_PROGRAM_DrawSprite);
+    }
+}
+
+static void FlushSpriteBatch(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    DrawSpriteProgram *drawSpriteProgram = &renderContextInternal->drawSpriteProgram;
+    SpriteBatch *spriteBatch = &renderContextInternal->spriteBatch;
+
+    if (spriteBatch->commandCount > 0) {
+        // Lay out indices command by command, opaque commands first in reverse order
+        int cursor = 0;
+        int hasOpaque = 0;
+        for (int i = spriteBatch->commandCount - 1; i >= 0; --i) {
+            SpriteBatchCommand *command = &spriteBatch->commands[i];
+            if (command->isOpaque) {
+                command->firstIndex = cursor;
+                cursor += command->indexCount;
+                command->indexCount = 0;
+                hasOpaque = 1;
+            }
+        }
+        for (int i = 0; i < spriteBatch->commandCount; ++i) {
+            SpriteBatchCommand *command = &spriteBatch->commands[i];
+            if (!command->isOpaque) {
+                command->firstIndex = cursor;
+                cursor += command->indexCount;
+                command->indexCount = 0;
+            }
+        }
+
+        // Opaque chunks are copied in reverse so each command is front to back as well
+        for (int i = spriteBatch->chunkCount - 1; i >= 0; --i) {
+            SpriteBatchChunk *chunk = &spriteBatch->chunks[i];
+            SpriteBatchCommand *command = &spriteBatch->commands[chunk->command];
+            if (command->isOpaque) {
+                memcpy(&spriteBatch->drawIndices[command->firstIndex + command->indexCount],
+                       &spriteBatch->indices[chunk->firstIndex], sizeof(GLushort) * chunk->indexCount);
+                command->indexCount += chunk->indexCount;
+            }
+        }
+        for (int i = 0; i < spriteBatch->chunkCount; ++i) {
+            SpriteBatchChunk *chunk = &spriteBatch->chunks[i];
+            SpriteBatchCommand *command = &spriteBatch->commands[chunk->command];
+            if (!command->isOpaque) {
+                memcpy(&spriteBatch->drawIndices[command->firstIndex + command->indexCount],
+                       &spriteBatch->indices[chunk->firstIndex], sizeof(GLushort) * chunk->indexCount);
+                command->indexCount += chunk->indexCount;
+            }
+        }
+
+        glBindVertexArray(drawSpriteProgram->vao);
+
+        Tick uploadStart = GetCurrentTick();
+        GLsizeiptr vertexBytes = (GLsizeiptr) sizeof(DrawSpriteVertexAttrib) * spriteBatch->vertexCount;
+        GLsizeiptr indexBytes = (GLsizeiptr) sizeof(GLushort) * spriteBatch->indexCount;
+
+        // Orphan the previous storage to avoid waiting on draws still using it
+        glBindBuffer(GL_ARRAY_BUFFER, drawSpriteProgram->vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, spriteBatch->vertices, GL_STREAM_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawSpriteProgram->ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, spriteBatch->drawIndices, GL_STREAM_DRAW);
+
+        rc->spriteUploadBytes += (int) (vertexBytes + indexBytes);
+        rc->spriteUploadMs += TickToSecond(GetCurrentTick() - uploadStart) * 1000.0f;
+
+        glActiveTexture(GL_TEXTURE0);
+        glEnable(GL_DEPTH_TEST);
+
+        // Sprites without a clip rect pass every plane, so the planes are only off to skip the work when unused
+        int isClipped = renderContextInternal->clipRects.slotCount > 0;
+        if (isClipped) {
+            for (int i = 0; i < 4; ++i) {
+                glEnable(GL_CLIP_DISTANCE0 + i);
+            }
+        }
+
+        // Overdraw is counted by blending, so it stays on
+        int isBlendDisabled = hasOpaque && renderContextInternal->debugMode != RENDER_DEBUG_MODE_OVERDRAW;
+        if (isBlendDisabled) {
+            glDisable(GL_BLEND);
+        }
+        if (hasOpaque) {
+            DrawSpriteBatchCommands(rc, 1);
+        }
+        if (isBlendDisabled) {
+            glEnable(GL_BLEND);
+        }
+
+        glDepthMask(GL_FALSE);
+        DrawSpriteBatchCommands(rc, 0);
+        glDepthMask(GL_TRUE);
+
+        if (isClipped) {
+            for (int i = 0; i < 4; ++i) {
+                glDisable(GL_CLIP_DISTANCE0 + i);
+            }
+        }
+        glDisable(GL_DEPTH_TEST);
+        glBindVertexArray(0);
+    }
+
+    spriteBatch->vertexCount = 0;
+    spriteBatch->indexCount = 0;
+    spriteBatch->chunkCount = 0;
+    spriteBatch->commandCount = 0;
+    spriteBatch->lastTranslucentCommand = -1;
+
+    if (spriteBatch->pendingDeleteTextureCount > 0) {
+        glDeleteTextures(spriteBatch->pendingDeleteTextureCount, spriteBatch->pendingDeleteTextures);
+        spriteBatch->pendingDeleteTextureCount = 0;
+    }
+
+    for (TextureArrayPage *page = renderContextInternal->textureArrayPages; page; page = page->next) {
+        page->layerMask &= ~page->pendingFreeMask;
+        page->pendingFreeMask = 0;
+    }
+}
+
+// Flush the queued sprites before something else is drawn, so the next sprite starts a new draw call
+static void BreakSpriteBatch(RenderContext *rc, BatchBreakReason reason) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    if (renderContextInternal->spriteBatch.commandCount > 0) {
+        RecordBatchBreak(rc, reason);
+    }
+
+    FlushSpriteBatch(rc);
+}
+
+// Draw what is queued and restart depth from the back. Everything drawn so far is already in the color buffer,
+// so it stays behind what comes next.
+static void ResetSpriteDepth(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    BreakSpriteBatch(rc, BATCH_BREAK_DEPTH);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    renderContextInternal->spriteBatch.depth = SPRITE_MAX_DEPTH;
+}
+
+// Slot of the view constants buffer holding the current view, written by the first draw of the view in the frame
+static int GetViewConstantsSlot(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    ViewConstantsBuffer *viewConstants = &renderContextInternal->viewConstants;
+
+    ViewConstantsKey key;
+    memset(&key, 0, sizeof(key));
+    key.projection = rc->projection;
+    key.camera = rc->camera;
+    key.width = rc->width;
+    key.height = rc->height;
+    key.pointToPixel = rc->pointToPixel;
+
+    if (viewConstants->lastSlot >= 0 &&
+        memcmp(&viewConstants->keys[viewConstants->lastSlot], &key, sizeof(key)) == 0) {
+        return viewConstants->lastSlot;
+    }
+
+    // Views are switched back and forth, e.g. to draw a render target with an identity camera
+    for (int i = viewConstants->slotCount - 1; i >= 0; --i) {
+        if (memcmp(&viewConstants->keys[i], &key, sizeof(key)) == 0) {
+            viewConstants->lastSlot = i;
+            return i;
+        }
+    }
+
+    if (viewConstants->slotCount >= MAX_VIEW_CONSTANTS) {
+        // Queued sprites refer to the slots about to be dropped
+        BreakSpriteBatch(rc, BATCH_BREAK_VIEW);
+        ResetViewConstants(viewConstants);
+    }
+
+    GLM3 viewProjection = MakeGLM3FromT2(DotT2(rc->projection, rc->camera));
+    GLViewConstants constants;
+    memset(&constants, 0, sizeof(constants));
+    for (int column = 0; column < 3; ++column) {
+        for (int row = 0; row < 3; ++row) {
+            constants.viewProjection[column * 4 + row] = viewProjection.m[column * 3 + row];
+        }
+    }
+    constants.viewSize[0] = rc->width;
+    constants.viewSize[1] = rc->height;
+    constants.pointToPixel = rc->pointToPixel;
+    constants.time = viewConstants->time;
+
+    int slot = viewConstants->slotCount++;
+    glBindBuffer(GL_UNIFORM_BUFFER, viewConstants->ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr) viewConstants->slotSize * slot, sizeof(constants), &constants);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    viewConstants->keys[slot] = key;
+    viewConstants->lastSlot = slot;
+
+    return slot;
+}
+
+// Clip rect of sprites pushed now, to be stored above SPRITE_KIND_BITS. 0 if no axis aligned clip is pushed,
+// otherwise the slot holding the clip plus one, written by the first sprite drawn with it since the last reset.
+static GLubyte GetClipRectSlot(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    ClipRectStack *clipRects = &renderContextInternal->clipRects;
+
+    if (clipRects->count == 0) {
+        return 0;
+    }
+
+    ClipRect *entry = &clipRects->entries[clipRects->count - 1];
+    if (!entry->hasBBox) {
+        return 0;
+    }
+    if (entry->slot > 0) {
+        return (GLubyte) entry->slot;
+    }
+
+    // Clips are pushed again and again with the same rect, e.g. once per item of a list
+    for (int i = clipRects->slotCount - 1; i >= 0; --i) {
+        if (memcmp(&clipRects->slots[i], &entry->bbox, sizeof(BBox2)) == 0) {
+            entry->slot = i + 1;
+            return (GLubyte) entry->slot;
+        }
+    }
+
+    if (clipRects->slotCount >= MAX_SPRITE_CLIP_RECTS) {
+        // Queued sprites refer to the slots about to be dropped
+        if (renderContextInternal->spriteBatch.commandCount > 0) {
+            rc->clipFlushCount++;
+        }
+        BreakSpriteBatch(rc, BATCH_BREAK_CLIP);
+        ResetClipRects(clipRects);
+    }
+
+    GLClipRect rect;
+    rect.min[0] = entry->bbox.min.x;
+    rect.min[1] = entry->bbox.min.y;
+    rect.max[0] = entry->bbox.max.x;
+    rect.max[1] = entry->bbox.max.y;
+
+    int slot = clipRects->slotCount++;
+    glBindBuffer(GL_UNIFORM_BUFFER, clipRects->ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr) sizeof(GLClipRect) * slot, sizeof(rect), &rect);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    clipRects->slots[slot] = entry->bbox;
+    entry->slot = slot + 1;
+
+    return (GLubyte) entry->slot;
+}
+
+static int IsSpriteBatchCommandMaterialCompatible(SpriteBatchCommand *command, const Material *material) {
+    if (material == NULL) {
+        return command->material == NULL;
+    }
+    return command->material == material->internal &&
+           memcmp(command->params, material->params, sizeof(command->params)) == 0;
+}
+
+static int IsSpriteBatchCommandCompatible(SpriteBatchCommand *command, GLuint texture, GLuint textureArray, int view,
+                                          const Material *material) {
+    // Sprites that don't sample a texture can join any command, the others need the same texture
+    return (texture == 0 || command->texture == 0 || command->texture == texture) &&
+           (textureArray == 0 || command->textureArray == 0 || command->textureArray == textureArray) &&
+           command->view == view && IsSpriteBatchCommandMaterialCompatible(command, material);
+}
+
+// Tell why a sprite can't join any queued command
+static BatchBreakReason FindBatchBreakReason(SpriteBatch *spriteBatch, GLuint texture, GLuint textureArray,
+                                             int isOpaque, int view, const Material *material) {
+    SpriteBatchCommand *last = &spriteBatch->commands[spriteBatch->commandCount - 1];
+
+    if (!isOpaque) {
+        for (int i = 0; i < spriteBatch->commandCount; ++i) {
+            SpriteBatchCommand *command = &spriteBatch->commands[i];
+            if (!command->isOpaque && IsSpriteBatchCommandCompatible(command, texture, textureArray, view, material)) {
+                return BATCH_BREAK_ORDER;
+            }
+        }
+    }
+
+    if (last->view != view) {
+        return BATCH_BREAK_VIEW;
+    }
+    return IsSpriteBatchCommandMaterialCompatible(last, material) ? BATCH_BREAK_TEXTURE : BATCH_BREAK_MATERIAL;
+}
+
+// Reserve vertexCount vertices and indexCount indices for one draw in front of everything queued before.
+// glTex is the texture sampled by the draw, NULL if none. Opaque draws must cover every pixel of their triangles
+// with full alpha.
+static SpriteBatchReservation ReserveSpriteBatch(RenderContext *rc, const GLTexture *glTex, int isOpaque,
+                                                 int vertexCount, int indexCount) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    SpriteBatch *spriteBatch = &renderContextInternal->spriteBatch;
+    GLuint texture = 0;
+    GLuint textureArray = 0;
+    if (glTex && glTex->page) {
+        textureArray = glTex->page->id;
+    } else if (glTex) {
+        texture = glTex->id;
+    }
+
+    assert(vertexCount <= SPRITE_BATCH_MAX_VERTICES && indexCount <= SPRITE_BATCH_MAX_INDICES);
+
+    if (spriteBatch->vertexCount + vertexCount > SPRITE_BATCH_MAX_VERTICES ||
+        spriteBatch->indexCount + indexCount > SPRITE_BATCH_MAX_INDICES ||
+        spriteBatch->chunkCount >= SPRITE_BATCH_MAX_CHUNKS) {
+        BreakSpriteBatch(rc, BATCH_BREAK_FULL);
+    }
+
+    if (spriteBatch->depth <= 0) {
+        ResetSpriteDepth(rc);
+    }
+
+    const Material *material = renderContextInternal->currentMaterial;
+    isOpaque = isOpaque && rc->isOpaquePassEnabled && (material == NULL || material->isOpaque);
+    int view = GetViewConstantsSlot(rc);
+    // Flushes don't drop the slots, so the ones below leave it valid
+    GLubyte clip = GetClipRectSlot(rc);
+
+    int commandIndex = -1;
+    if (isOpaque) {
+        for (int i = spriteBatch->commandCount - 1; i >= 0; --i) {
+            SpriteBatchCommand *command = &spriteBatch->commands[i];
+            if (command->isOpaque && IsSpriteBatchCommandCompatible(command, texture, textureArray, view, material)) {
+                commandIndex = i;
+                break;
+            }
+        }
+    } else if (spriteBatch->lastTranslucentCommand >= 0 &&
+               IsSpriteBatchCommandCompatible(&spriteBatch->commands[spriteBatch->lastTranslucentCommand],
+                                              texture, textureArray, view, material)) {
+        commandIndex = spriteBatch->lastTranslucentCommand;
+    }
+
+    if (commandIndex < 0) {
+        if (spriteBatch->commandCount >= SPRITE_BATCH_MAX_COMMANDS) {
+            BreakSpriteBatch(rc, BATCH_BREAK_FULL);
+        } else if (spriteBatch->commandCount > 0) {
+            RecordBatchBreak(rc, FindBatchBreakReason(spriteBatch, texture, textureArray, isOpaque, view, material));
+        }
+
+        commandIndex = spriteBatch->commandCount++;
+        SpriteBatchCommand *command = &spriteBatch->commands[commandIndex];
+        command->texture = 0;
+        command->textureArray = 0;
+        command->view = view;
+        command->material = NULL;
+        if (material) {
+            command->material = material->internal;
+            memcpy(command->params, material->params, sizeof(command->params));
+        }
+        command->features = 0;
+        command->isOpaque = isOpaque;
+        command->isDepthWritten = 0;
+        command->firstIndex = 0;
+        command->indexCount = 0;
+
+        if (!isOpaque) {
+            spriteBatch->lastTranslucentCommand = commandIndex;
+        }
+    }
+
+    SpriteBatchCommand *command = &spriteBatch->commands[commandIndex];
+    if (texture) {
+        command->texture = texture;
+    }
+    if (textureArray) {
+        command->textureArray = textureArray;
+    }
+    command->indexCount += indexCount;
+
+    SpriteBatchChunk *chunk = &spriteBatch->chunks[spriteBatch->chunkCount++];
+    chunk->command = commandIndex;
+    chunk->firstIndex = spriteBatch->indexCount;
+    chunk->indexCount = indexCount;
+
+    SpriteBatchReservation reservation;
+    reservation.command = command;
+    reservation.vertices = &spriteBatch->vertices[spriteBatch->vertexCount];
+    reservation.indices = &spriteBatch->indices[spriteBatch->indexCount];
+    reservation.baseVertex = (GLushort) spriteBatch->vertexCount;
+    reservation.depth = (GLushort) --spriteBatch->depth;
+    reservation.clip = clip;
+
+    spriteBatch->vertexCount += vertexCount;
+    spriteBatch->indexCount += indexCount;
+
+    return reservation;
+}
+
+static inline GLubyte PackUnorm8(F x) {
+    return (GLubyte) (ClampF(x, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static inline GLushort PackUnorm16(F x) {
+    return (GLushort) (ClampF(x, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+// IEEE 754 binary16, rounded to nearest even. Out of range values become infinity.
+static GLushort PackHalfFloat(F x) {
+    union { F f; uint32_t u; } bits;
+    bits.f = x;
+
+    uint32_t sign = (bits.u >> 16) & 0x8000;
+    int32_t exponent = (int32_t) ((bits.u >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits.u & 0x7FFFFF;
+
+    if (exponent >= 31) {
+        return (GLushort) (sign | 0x7C00);
+    }
+
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return (GLushort) sign;
+        }
+        // Subnormal
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t) (14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) {
+            half++;
+        }
+        return (GLushort) (sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t) exponent << 10) | (mantissa >> 13);
+    // Carry into the exponent is the correct rounding
+    uint32_t rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return (GLushort) half;
+}
+
+static void SetSpriteVertex(DrawSpriteVertexAttrib *vertex, V2 pos, V2 texCoord, V4 color,
+                            V2 roundRadius, V2 thickness, V4 borderColor, SpriteKind kind, GLubyte layer, GLushort depth,
+                            GLubyte clip) {
+    vertex->pos[0] = pos.x;
+    vertex->pos[1] = pos.y;
+    vertex->texCoord[0] = PackUnorm16(texCoord.x);
+    vertex->texCoord[1] = PackUnorm16(texCoord.y);
+    vertex->color[0] = PackUnorm8(color.r);
+    vertex->color[1] = PackUnorm8(color.g);
+    vertex->color[2] = PackUnorm8(color.b);
+    vertex->color[3] = PackUnorm8(color.a);
+    vertex->roundRadius[0] = PackHalfFloat(roundRadius.x);
+    vertex->roundRadius[1] = PackHalfFloat(roundRadius.y);
+    vertex->thickness[0] = PackHalfFloat(thickness.x);
+    vertex->thickness[1] = PackHalfFloat(thickness.y);
+    vertex->borderColor[0] = PackUnorm8(borderColor.r);
+    vertex->borderColor[1] = PackUnorm8(borderColor.g);
+    vertex->borderColor[2] = PackUnorm8(borderColor.b);
+    vertex->borderColor[3] = PackUnorm8(borderColor.a);
+    vertex->kind = (GLubyte) (kind | clip << SPRITE_KIND_BITS);
+    vertex->layer = layer;
+    vertex->depth = depth;
+}
+
+// Queue a quad whose corners are dstBBox transformed by transform, with texCoord spanning texBBox
+static void PushSpriteQuad(RenderContext *rc, T2 transform, BBox2 dstBBox, const GLTexture *glTex, int isOpaque,
+                           BBox2 texBBox, V4 color, V2 roundRadius, V2 thickness, V4 borderColor, SpriteKind kind) {
+    SpriteBatchReservation r = ReserveSpriteBatch(rc, glTex, isOpaque, 4, 6);
+    GLubyte layer = glTex ? (GLubyte) glTex->layer : 0;
+    rc->spriteCount++;
+
+    if (kind == SPRITE_KIND_RECT) {
+        if (roundRadius.x > 0 || roundRadius.y > 0) {
+            r.command->features |= SPRITE_FEATURE_ROUNDING;
+        }
+        if (thickness.x > 0 || thickness.y > 0) {
+            r.command->features |= SPRITE_FEATURE_BORDER;
+        }
+    }
+
+    SetSpriteVertex(&r.vertices[0], ApplyT2(transform, dstBBox.max), texBBox.max,
+                    color, roundRadius, thickness, borderColor, kind, layer, r.depth, r.clip);  // top right
+    SetSpriteVertex(&r.vertices[1], ApplyT2(transform, MakeV2(dstBBox.max.x, dstBBox.min.y)), MakeV2(texBBox.max.x, texBBox.min.y),
+                    color, roundRadius, thickness, borderColor, kind, layer, r.depth, r.clip);  // bottom right
+    SetSpriteVertex(&r.vertices[2], ApplyT2(transform, dstBBox.min), texBBox.min,
+                    color, roundRadius, thickness, borderColor, kind, layer, r.depth, r.clip);  // bottom left
+    SetSpriteVertex(&r.vertices[3], ApplyT2(transform, MakeV2(dstBBox.min.x, dstBBox.max.y)), MakeV2(texBBox.min.x, texBBox.max.y),
+                    color, roundRadius, thickness, borderColor, kind, layer, r.depth, r.clip);  // top left
+
+    // first triangle
+    r.indices[0] = r.baseVertex + 0;
+    r.indices[1] = r.baseVertex + 1;
+    r.indices[2] = r.baseVertex + 3;
+    // second triangle
+    r.indices[3] = r.baseVertex + 1;
+    r.indices[4] = r.baseVertex + 2;
+    r.indices[5] = r.baseVertex + 3;
+}
+
+// Queue a convex polygon as a triangle fan. positions are transformed by transform.
+static void PushSpritePolygon(RenderContext *rc, T2 transform, const V2 *positions, const V2 *texCoords, int count,
+                              const GLTexture *glTex, int isOpaque, V4 color, SpriteKind kind) {
+    SpriteBatchReservation r = ReserveSpriteBatch(rc, glTex, isOpaque, count, (count - 2) * 3);
+    GLubyte layer = glTex ? (GLubyte) glTex->layer : 0;
+    rc->spriteCount++;
+
+    for (int i = 0; i < count; ++i) {
+        SetSpriteVertex(&r.vertices[i], ApplyT2(transform, positions[i]), texCoords[i],
+                        color, ZeroV2(), ZeroV2(), ZeroV4(), kind, layer, r.depth, r.clip);
+    }
+
+    for (int i = 0; i < count - 2; ++i) {
+        r.indices[i * 3 + 0] = r.baseVertex;
+        r.indices[i * 3 + 1] = (GLushort) (r.baseVertex + i + 1);
+        r.indices[i * 3 + 2] = (GLushort) (r.baseVertex + i + 2);
+    }
+}
+
+// Sprite vertex before it was packed, 68 bytes. Only filled by BenchmarkSpriteUpload to compare against.
+typedef struct FloatSpriteVertexAttrib {
+    F pos[2];
+    F texCoord[2];
+    F color[4];
+    F roundRadius[2];
+    F thickness[2];
+    F borderColor[4];
+    F kind;
+} FloatSpriteVertexAttrib;
+
+static void SetFloatSpriteVertex(FloatSpriteVertexAttrib *vertex, V2 pos, V2 texCoord, V4 color,
+                                 V2 roundRadius, V2 thickness, V4 borderColor, SpriteKind kind) {
+    vertex->pos[0] = pos.x;
+    vertex->pos[1] = pos.y;
+    vertex->texCoord[0] = texCoord.x;
+    vertex->texCoord[1] = texCoord.y;
+    vertex->color[0] = color.r;
+    vertex->color[1] = color.g;
+    vertex->color[2] = color.b;
+    vertex->color[3] = color.a;
+    vertex->roundRadius[0] = roundRadius.x;
+    vertex->roundRadius[1] = roundRadius.y;
+    vertex->thickness[0] = thickness.x;
+    vertex->thickness[1] = thickness.y;
+    vertex->borderColor[0] = borderColor.r;
+    vertex->borderColor[1] = borderColor.g;
+    vertex->borderColor[2] = borderColor.b;
+    vertex->borderColor[3] = borderColor.a;
+    vertex->kind = (F) kind;
+}
+
+// Fill the vertices and indices of sprite i like PushSpriteQuad, in the float layout if isFloat
+static void FillBenchmarkSprite(void *vertices, GLushort *indices, int i, int isFloat) {
+    T2 transform = MakeT2FromTranslation(MakeV2((F) (i % 256), (F) (i / 256 % 256)));
+    BBox2 dstBBox = MakeBBox2(ZeroV2(), MakeV2(16.0f, 16.0f));
+    V2 corners[4] = {
+            dstBBox.max, MakeV2(dstBBox.max.x, dstBBox.min.y), dstBBox.min, MakeV2(dstBBox.min.x, dstBBox.max.y),
+    };
+    V2 texCoords[4] = {OneV2(), MakeV2(1.0f, 0.0f), ZeroV2(), MakeV2(0.0f, 1.0f)};
+    V4 color = MakeV4(1.0f, 0.5f, 0.25f, 1.0f);
+    GLushort baseVertex = (GLushort) (i * 4 % SPRITE_BATCH_MAX_VERTICES);
+
+    for (int j = 0; j < 4; ++j) {
+        V2 pos = ApplyT2(transform, corners[j]);
+        if (isFloat) {
+            SetFloatSpriteVertex((FloatSpriteVertexAttrib *) vertices + i * 4 + j, pos, texCoords[j], color,
+                                 ZeroV2(), ZeroV2(), ZeroV4(), SPRITE_KIND_TEXTURE);
+        } else {
+            SetSpriteVertex((DrawSpriteVertexAttrib *) vertices + i * 4 + j, pos, texCoords[j], color,
+                            ZeroV2(), ZeroV2(), ZeroV4(), SPRITE_KIND_TEXTURE, 0, (GLushort) i, 0);
+        }
+    }
+
+    static const GLushort QUAD_INDICES[6] = {0, 1, 3, 1, 2, 3};
+    for (int j = 0; j < 6; ++j) {
+        indices[i * 6 + j] = (GLushort) (baseVertex + QUAD_INDICES[j]);
+    }
+}
+
+extern void BenchmarkSpriteUpload(RenderContext *rc, int spriteCount, int repeatCount,
+                                  SpriteUploadBenchmark results[SPRITE_UPLOAD_BENCHMARK_LAYOUT_COUNT]) {
+    memset(results, 0, sizeof(SpriteUploadBenchmark) * SPRITE_UPLOAD_BENCHMARK_LAYOUT_COUNT);
+    if (rc->backend == RENDER_BACKEND_SOFTWARE || spriteCount <= 0 || repeatCount <= 0) {
+        return;
+    }
+
+    // The element array binding is part of the vertex array state, so it needs a vertex array of its own
+    GLuint vao;
+    GLuint buffers[2];
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(2, buffers);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+
+    void *vertices = malloc(sizeof(FloatSpriteVertexAttrib) * 4 * (size_t) spriteCount);
+    GLushort *indices = malloc(sizeof(GLushort) * 6 * (size_t) spriteCount);
+
+    for (int layout = 0; layout < SPRITE_UPLOAD_BENCHMARK_LAYOUT_COUNT; ++layout) {
+        int isFloat = layout == 0;
+        size_t vertexSize = isFloat ? sizeof(FloatSpriteVertexAttrib) : sizeof(DrawSpriteVertexAttrib);
+        GLsizeiptr vertexBytes = (GLsizeiptr) (vertexSize * 4 * spriteCount);
+        GLsizeiptr indexBytes = (GLsizeiptr) (sizeof(GLushort) * 6 * spriteCount);
+
+        float fillSeconds = 0.0f;
+        float uploadSeconds = 0.0f;
+        for (int repeat = 0; repeat < repeatCount; ++repeat) {
+            Tick fillStart = GetCurrentTick();
+            for (int i = 0; i < spriteCount; ++i) {
+                FillBenchmarkSprite(vertices, indices, i, isFloat);
+            }
+            fillSeconds += TickToSecond(GetCurrentTick() - fillStart);
+
+            // Orphaned like FlushSpriteBatch does, and waited on so the transfer is part of the time
+            glFinish();
+            Tick uploadStart = GetCurrentTick();
+            glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STREAM_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indices, GL_STREAM_DRAW);
+            glFinish();
+            uploadSeconds += TickToSecond(GetCurrentTick() - uploadStart);
+        }
+
+        SpriteUploadBenchmark *result = &results[layout];
+        result->layout = isFloat ? "float" : "packed";
+        result->bytesPerSprite = (int) ((vertexBytes + indexBytes) / spriteCount);
+        result->fillNsPerSprite = fillSeconds * 1e9f / ((float) spriteCount * repeatCount);
+        result->uploadMBPerSecond = uploadSeconds > 0.0f
+                                    ? (float) (vertexBytes + indexBytes) * repeatCount / uploadSeconds / 1e6f
+                                    : 0.0f;
+    }
+
+    free(vertices);
+    free(indices);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(2, buffers);
+    glDeleteVertexArrays(1, &vao);
+}
+
+static uint64_t GetTextureArrayFullMask(TextureArrayPage *page) {
+    return page->layerCount == 64 ? ~0ull : (1ull << page->layerCount) - 1;
+}
+
+// Return a page of width x height layers with layer set to a free one, adding a page if all of them are full
+static TextureArrayPage *AllocTextureArrayLayer(RenderContextInternal *renderContextInternal, int width, int height,
+                                                int *layer) {
+    TextureArrayPage *page = renderContextInternal->textureArrayPages;
+    while (page && (page->width != width || page->height != height ||
+                    page->layerMask == GetTextureArrayFullMask(page))) {
+        page = page->next;
+    }
+
+    if (page == NULL) {
+        page = malloc(sizeof(TextureArrayPage));
+        page->width = width;
+        page->height = height;
+        page->layerCount = (int) ClampF((F) (TEXTURE_ARRAY_PAGE_BYTES / (width * height * 4)),
+                                        TEXTURE_ARRAY_MIN_LAYERS, TEXTURE_ARRAY_MAX_LAYERS);
+        page->layerMask = 0;
+        page->pendingFreeMask = 0;
+        page->next = renderContextInternal->textureArrayPages;
+        renderContextInternal->textureArrayPages = page;
+
+        glGenTextures(1, &page->id);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, page->id);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_SRGB8_ALPHA8, width, height, page->layerCount, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    int i = 0;
+    while (page->layerMask & (1ull << i)) {
+        ++i;
+    }
+    page->layerMask |= 1ull << i;
+    *layer = i;
+
+    return page;
+}
+
+// RGBA textures small enough are put into a layer of the texture array of their size class, so sprites of different
+// textures can be drawn together. Their height is padded to a power of two like their width.
+// TODO(coeuvre): Allow to define filter mode
+static void UploadImageToGPU(RenderContext *rc, Texture *tex, const unsigned char *data, int width, int height, int stride, ImageChannel channel) {
+    GLTexture *glTex = tex->internal;
+
+    glTex->id = 0;
+    glTex->page = NULL;
+    glTex->layer = 0;
+    glTex->isAlphaOnly = channel == IMAGE_CHANNEL_A;
+    glTex->isRenderTarget = 0;
+
+    tex->actualWidth = (int) NextPow2F((float) width);
+    tex->actualHeight = height;
+
+    int isLayered = channel == IMAGE_CHANNEL_RGBA && tex->actualWidth <= TEXTURE_ARRAY_MAX_SIZE &&
+                    NextPow2F((float) height) <= TEXTURE_ARRAY_MAX_SIZE;
+    if (isLayered) {
+        tex->actualHeight = (int) NextPow2F((float) height);
+    }
+
+    int texStride = 0;
+    GLint numberOfPixels = 0;
+    GLint internalFormat = 0;
+    GLenum format = 0;
+
+    switch (channel) {
+        case IMAGE_CHANNEL_RGBA: {
+            texStride = tex->actualWidth * 4;
+            numberOfPixels = tex->actualWidth;
+
+            internalFormat = GL_SRGB8_ALPHA8;
+            format = GL_RGBA;
+        } break;
+        case IMAGE_CHANNEL_A: {
+            texStride = (int) (CeilF(tex->actualWidth / 4.0f) * 4.0f);
+            numberOfPixels = texStride;
+
+            internalFormat = GL_R8;
+            format = GL_RED;
+        } break;
+    }
+
+    assert(stride <= texStride);
+    assert(tex->actualWidth % 2 == 0);
+    assert(texStride % 4 == 0);
+
+    size_t texBufLen = (size_t) texStride * tex->actualHeight;
+    unsigned char *texBuf = malloc(texBufLen);
+    memset(texBuf, 0, texBufLen);
+
+    unsigned char *dstRow = texBuf;
+    const unsigned char *srcRow = data + stride * (height - 1);
+
+    // Flip image vertically
+    for (int y = 0; y < height; ++y) {
+        memcpy(dstRow, srcRow, (size_t) stride);
+        dstRow += texStride;
+        srcRow -= stride;
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, numberOfPixels);
+
+    if (isLayered) {
+        glTex->page = AllocTextureArrayLayer(rc->internal, tex->actualWidth, tex->actualHeight, &glTex->layer);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, glTex->page->id);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, glTex->layer, tex->actualWidth, tex->actualHeight, 1,
+                        format, GL_UNSIGNED_BYTE, texBuf);
+    } else {
+        glGenTextures(1, &glTex->id);
+        glBindTexture(GL_TEXTURE_2D, glTex->id);
+
+        if (channel == IMAGE_CHANNEL_A) {
+            GLint swizzleMask[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, tex->actualWidth, tex->actualHeight, 0, format, GL_UNSIGNED_BYTE, texBuf);
+    }
+
+    free(texBuf);
+}
+
+// Return a GL_TEXTURE_2D of the texture for programs other than the sprite batch. Textures in a texture array get a
+// copy of their layer the first time.
+static GLuint GetGLTexture2D(GLTexture *glTex) {
+    if (glTex->id == 0 && glTex->page) {
+        TextureArrayPage *page = glTex->page;
+
+        glGenTextures(1, &glTex->id);
+        glBindTexture(GL_TEXTURE_2D, glTex->id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, page->width, page->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        // Copy on GPU through a framebuffer reading the layer
+        GLint readFramebuffer = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+        GLuint fbo;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, page->id, 0, glTex->layer);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, page->width, page->height);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint) readFramebuffer);
+        glDeleteFramebuffers(1, &fbo);
+    }
+
+    return glTex->id;
+}
+
+
+extern RenderContext *CreateRenderContext(int width, int height, float pointToPixel, const char *programCacheDir) {
+    RenderContext *rc = malloc(sizeof(RenderContext));
+    RenderContextInternal *renderContextInternal = malloc(sizeof(RenderContextInternal));
+    rc->internal = renderContextInternal;
+
+    rc->backend = RENDER_BACKEND_GL;
+    rc->width = (float) width;
+    rc->height = (float) height;
+    rc->pointToPixel = pointToPixel;
+    rc->pixelToPoint = 1.0f / pointToPixel;
+    rc->drawCallCount = 0;
+    rc->isOpaquePassEnabled = 1;
+    rc->spriteCount = 0;
+    rc->spriteUploadBytes = 0;
+    rc->spriteUploadMs = 0.0f;
+    rc->spriteTrimmedPixels = 0.0f;
+    rc->clipFlushCount = 0;
+    rc->pathTessellationCount = 0;
+    rc->lightCount = 0;
+    rc->shadowedLightCount = 0;
+    rc->projection = MakeProjection(rc->width, rc->height);
+    rc->camera = IdentityT2();
+
+    glViewport(0, 0, (GLsizei) (width * pointToPixel), (GLsizei) (height * pointToPixel));
+
+    glEnable(GL_BLEND);
+    // Pre-multiplied alpha format
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    // Render at linear color space
+    glEnable(GL_FRAMEBUFFER_SRGB);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+
+    ProgramBinaryCache *programBinaryCache = &renderContextInternal->programBinaryCache;
+    SetupProgramBinaryCache(programBinaryCache, programCacheDir);
+
+    Tick buildStartTick = GetCurrentTick();
+    // Materials are built by CreateMaterial
+    GLProgramBuild builds[RENDER_PROGRAM_Material];
+    BeginBuildGLProgram(&builds[RENDER_PROGRAM_DrawTexture], programBinaryCache, "DrawTexture",
+                        DRAW_TEXTURE_VERTEX_SHADER, DRAW_TEXTURE_FRAGMENT_SHADER);
+    // Indexed by SpriteFeature bits
+    static const char *SPRITE_VARIANT_NAMES[SPRITE_VARIANT_COUNT] = {
+        "DrawSprite", "DrawSprite+Rounding", "DrawSprite+Border", "DrawSprite+Rounding+Border",
+    };
+    GLProgramBuild spriteBuilds[SPRITE_VARIANT_COUNT];
+    for (int i = 0; i < SPRITE_VARIANT_COUNT; ++i) {
+        BeginBuildGLProgram(&spriteBuilds[i], programBinaryCache, SPRITE_VARIANT_NAMES[i],
+                            DRAW_SPRITE_VERTEX_SHADER, GetShaderVariant(DRAW_SPRITE_FRAGMENT_SHADER, i));
+    }
+    BeginBuildGLProgram(&builds[RENDER_PROGRAM_DrawParticle], programBinaryCache, "DrawParticle",
+                        DRAW_PARTICLE_VERTEX_SHADER, DRAW_PARTICLE_FRAGMENT_SHADER);
+    BeginBuildGLProgram(&builds[RENDER_PROGRAM_DrawLight], programBinaryCache, "DrawLight",
+                        DRAW_LIGHT_VERTEX_SHADER, DRAW_LIGHT_FRAGMENT_SHADER);
+    BeginBuildGLProgram(&builds[RENDER_PROGRAM_DrawShadow], programBinaryCache, "DrawShadow",
+                        DRAW_SHADOW_VERTEX_SHADER, DRAW_SHADOW_FRAGMENT_SHADER);
+    BeginBuildGLProgram(&builds[RENDER_PROGRAM_PostDownsample], programBinaryCache, "PostDownsample",
+                        DRAW_POST_VERTEX_SHADER, DRAW_POST_DOWNSAMPLE_FRAGMENT_SHADER);
+    BeginBuildGLProgram(&builds[RENDER_PROGRAM_PostUpsample], programBinaryCache, "PostUpsample",
+                        DRAW_POST_VERTEX_SHADER, DRAW_POST_UPSAMPLE_FRAGMENT_SHADER);
+    BeginBuildGLProgram(&builds[RENDER_PROGRAM_PostGrade], programBinaryCache, "PostGrade",
+                        DRAW_POST_VERTEX_SHADER, DRAW_POST_GRADE_FRAGMENT_SHADER);
+    BeginBuildGLProgram(&builds[RENDER_PROGRAM_PostVignette], programBinaryCache, "PostVignette",
+                        DRAW_POST_VERTEX_SHADER, DRAW_POST_VIGNETTE_FRAGMENT_SHADER);
+    BeginBuildGLProgram(&builds[RENDER_PROGRAM_DrawRepeated], programBinaryCache, "DrawRepeated",
+                        DRAW_POST_VERTEX_SHADER, DRAW_REPEATED_FRAGMENT_SHADER);
+
+    SetupDrawTextureProgram(&renderContextInternal->drawTextureProgram,
+                            EndBuildGLProgram(&builds[RENDER_PROGRAM_DrawTexture], programBinaryCache));
+    SetupDrawSpriteProgram(&renderContextInternal->drawSpriteProgram);
+    for (int i = 0; i < SPRITE_VARIANT_COUNT; ++i) {
+        SetupDrawSpriteVariant(&renderContextInternal->drawSpriteProgram.variants[i],
+                               EndBuildGLProgram(&spriteBuilds[i], programBinaryCache));
+    }
+    SetupDrawParticleProgram(&renderContextInternal->drawParticleProgram,
+                             EndBuildGLProgram(&builds[RENDER_PROGRAM_DrawParticle], programBinaryCache));
+    SetupDrawLightProgram(&renderContextInternal->drawLightProgram,
+                          EndBuildGLProgram(&builds[RENDER_PROGRAM_DrawLight], programBinaryCache));
+    SetupDrawShadowProgram(&renderContextInternal->drawShadowProgram,
+                           EndBuildGLProgram(&builds[RENDER_PROGRAM_DrawShadow], programBinaryCache));
+    glGenVertexArrays(1, &renderContextInternal->postVao);
+    SetupDrawPostProgram(&renderContextInternal->postDownsampleProgram,
+                         EndBuildGLProgram(&builds[RENDER_PROGRAM_PostDownsample], programBinaryCache));
+    SetupDrawPostProgram(&renderContextInternal->postUpsampleProgram,
+                         EndBuildGLProgram(&builds[RENDER_PROGRAM_PostUpsample], programBinaryCache));
+    SetupDrawPostProgram(&renderContextInternal->postGradeProgram,
+                         EndBuildGLProgram(&builds[RENDER_PROGRAM_PostGrade], programBinaryCache));
+    SetupDrawPostProgram(&renderContextInternal->postVignetteProgram,
+                         EndBuildGLProgram(&builds[RENDER_PROGRAM_PostVignette], programBinaryCache));
+    SetupDrawRepeatedProgram(&renderContextInternal->drawRepeatedProgram,
+                             EndBuildGLProgram(&builds[RENDER_PROGRAM_DrawRepeated], programBinaryCache));
+    printf("Programs built in %.2f ms\n", TickToSecond(GetCurrentTick() - buildStartTick) * 1000.0f);
+    SetupGPUTimer(&renderContextInternal->gpuTimer);
+    SetupSpriteBatch(&renderContextInternal->spriteBatch);
+    SetupViewConstantsBuffer(&renderContextInternal->viewConstants);
+    SetupClipRectStack(&renderContextInternal->clipRects);
+    renderContextInternal->currentMaterial = NULL;
+
+    rc->debugMode = RENDER_DEBUG_MODE_NONE;
+    renderContextInternal->debugMode = RENDER_DEBUG_MODE_NONE;
+    renderContextInternal->overdrawTarget = NULL;
+    memset(&renderContextInternal->batchBreakLog, 0, sizeof(BatchBreakLog));
+    memset(&renderContextInternal->lastBatchBreakLog, 0, sizeof(BatchBreakLog));
+    memset(renderContextInternal->pathMeshCache, 0, sizeof(renderContextInternal->pathMeshCache));
+    renderContextInternal->textureArrayPages = NULL;
+    renderContextInternal->lightScratchCapacity = 0;
+    renderContextInternal->lightScratch = NULL;
+    renderContextInternal->softwareRenderer = NULL;
+    renderContextInternal->softwarePathVertexCapacity = 0;
+    renderContextInternal->softwarePathVertices = NULL;
+
+    renderContextInternal->currentTarget = NULL;
+
+    return rc;
+}
+
+extern RenderContext *CreateSoftwareRenderContext(int width, int height, int threadCount) {
+    RenderContext *rc = malloc(sizeof(RenderContext));
+    // Zeroed, so the GL state is empty and the batch break log stays empty
+    RenderContextInternal *renderContextInternal = calloc(1, sizeof(RenderContextInternal));
+    rc->internal = renderContextInternal;
+
+    rc->backend = RENDER_BACKEND_SOFTWARE;
+    rc->width = (float) width;
+    rc->height = (float) height;
+    rc->pointToPixel = 1.0f;
+    rc->pixelToPoint = 1.0f;
+    rc->drawCallCount = 0;
+    rc->isOpaquePassEnabled = 0;
+    rc->spriteCount = 0;
+    rc->spriteUploadBytes = 0;
+    rc->spriteUploadMs = 0.0f;
+    rc->spriteTrimmedPixels = 0.0f;
+    rc->clipFlushCount = 0;
+    rc->pathTessellationCount = 0;
+    rc->lightCount = 0;
+    rc->shadowedLightCount = 0;
+    rc->debugMode = RENDER_DEBUG_MODE_NONE;
+    rc->projection = MakeProjection(rc->width, rc->height);
+    rc->camera = IdentityT2();
+
+    renderContextInternal->softwareRenderer = CreateSoftwareRenderer(width, height, threadCount);
+
+    return rc;
+}
+
+extern const unsigned char *GetSoftwareFramebuffer(RenderContext *rc) {
+    if (rc->backend != RENDER_BACKEND_SOFTWARE) {
+        return NULL;
+    }
+
+    RenderContextInternal *renderContextInternal = rc->internal;
+    return GetSoftwareRendererPixels(renderContextInternal->softwareRenderer);
+}
+
+// Map the local space of transform into pixels of a software render context, from the bottom left
+static T2 GetSoftwarePixelTransform(RenderContext *rc, T2 transform) {
+    return DotT2(MakeT2FromScale(MakeV2(rc->pointToPixel, rc->pointToPixel)), DotT2(rc->camera, transform));
+}
+
+static void PushSoftwareTextureQuad(RenderContext *rc, T2 transform, BBox2 dstBBox, const SoftwareTexture *texture,
+                                    BBox2 texBBox, V4 color) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    T2 toPixel = GetSoftwarePixelTransform(rc, transform);
+    V2 size = GetBBox2Size(dstBBox);
+
+    SoftwareQuad quad = {0};
+    quad.kind = SOFTWARE_QUAD_TEXTURE;
+    quad.origin = ApplyT2(toPixel, dstBBox.min);
+    quad.xAxis = MulV2(size.x, toPixel.xAxis);
+    quad.yAxis = MulV2(size.y, toPixel.yAxis);
+    quad.texture = texture;
+    quad.texBBox = texBBox;
+    quad.color = color;
+    PushSoftwareQuad(renderContextInternal->softwareRenderer, &quad);
+    rc->spriteCount++;
+}
+
+extern void ClearDrawing(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        BeginSoftwareFrame(renderContextInternal->softwareRenderer);
+        rc->drawCallCount = 0;
+        rc->spriteCount = 0;
+        rc->pathTessellationCount = 0;
+        rc->lightCount = 0;
+        rc->shadowedLightCount = 0;
+        rc->clipFlushCount = 0;
+        return;
+    }
+
+    GPUTimer *gpuTimer = &renderContextInternal->gpuTimer;
+    GPUTimerFrame *frame = &gpuTimer->frames[gpuTimer->currentFrame];
+
+    // The oldest frame of the ring is reused, collect its results first
+    if (frame->isPending) {
+        if (!ResolveGPUTimerFrame(frame, &gpuTimer->timings)) {
+            gpuTimer->timings.droppedFrameCount++;
+        }
+        frame->isPending = 0;
+    }
+
+    frame->frameIndex = gpuTimer->frameIndex;
+    frame->queryCount = 0;
+    frame->passCount = 0;
+    RecordGPUTimestamp(gpuTimer, GPU_TIMESTAMP_FRAME_BEGIN, RENDER_PROGRAM_COUNT);
+    glBeginQuery(GL_SAMPLES_PASSED, frame->samplesQuery);
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    renderContextInternal->spriteBatch.depth = SPRITE_MAX_DEPTH;
+
+    ViewConstantsBuffer *viewConstants = &renderContextInternal->viewConstants;
+    viewConstants->time = TickToSecond(GetCurrentTick() - viewConstants->startTick);
+    ResetViewConstants(viewConstants);
+
+    // Every clip pushed in the last frame must have been popped
+    assert(renderContextInternal->clipRects.count == 0);
+    ResetClipRects(&renderContextInternal->clipRects);
+
+    renderContextInternal->debugMode = rc->debugMode;
+    if (renderContextInternal->debugMode == RENDER_DEBUG_MODE_OVERDRAW) {
+        glBlendFunc(GL_ONE, GL_ONE);
+    } else {
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    renderContextInternal->lastBatchBreakLog = renderContextInternal->batchBreakLog;
+    memset(&renderContextInternal->batchBreakLog, 0, sizeof(BatchBreakLog));
+
+    rc->drawCallCount = 0;
+    rc->spriteCount = 0;
+    rc->spriteUploadBytes = 0;
+    rc->spriteUploadMs = 0.0f;
+    rc->spriteTrimmedPixels = 0.0f;
+    rc->pathTessellationCount = 0;
+    rc->lightCount = 0;
+    rc->shadowedLightCount = 0;
+    rc->clipFlushCount = 0;
+}
+
+// Replace the overdraw counted in the window by a heatmap of it
+static void DrawOverdrawHeatmap(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    int width = (int) (rc->width * rc->pointToPixel);
+    int height = (int) (rc->height * rc->pointToPixel);
+    RenderTarget *target = renderContextInternal->overdrawTarget;
+    if (target && (target->width != width || target->height != height)) {
+        DestroyRenderTarget(rc, &renderContextInternal->overdrawTarget);
+        target = NULL;
+    }
+    if (target == NULL) {
+        target = CreateRenderTarget(rc, width, height, TEXTURE_FILTER_NEAREST);
+        renderContextInternal->overdrawTarget = target;
+    }
+
+    RenderTargetInternal *targetInternal = target->internal;
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetInternal->fbo);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    GLTexture *glTex = target->texture->internal;
+    T2 camera = rc->camera;
+    rc->camera = IdentityT2();
+    PushSpriteQuad(rc, IdentityT2(), MakeBBox2(ZeroV2(), MakeV2(rc->width, rc->height)), glTex, 0,
+                   MakeBBox2(ZeroV2(), OneV2()), OneV4(), ZeroV2(), ZeroV2(), ZeroV4(), SPRITE_KIND_HEATMAP);
+    FlushSpriteBatch(rc);
+    rc->camera = camera;
+}
+
+extern void ResolveRenderDebugView(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return;
+    }
+
+    assert(renderContextInternal->currentTarget == NULL);
+
+    if (renderContextInternal->debugMode == RENDER_DEBUG_MODE_NONE) {
+        return;
+    }
+
+    FlushSpriteBatch(rc);
+
+    if (renderContextInternal->debugMode == RENDER_DEBUG_MODE_OVERDRAW) {
+        DrawOverdrawHeatmap(rc);
+    }
+
+    renderContextInternal->debugMode = RENDER_DEBUG_MODE_NONE;
+}
+
+extern void EndDrawing(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    GPUTimer *gpuTimer = &renderContextInternal->gpuTimer;
+
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        EndSoftwareFrame(renderContextInternal->softwareRenderer);
+        // Frame counter of the path mesh cache
+        gpuTimer->frameIndex++;
+        return;
+    }
+
+    assert(gpuTimer->currentPass < 0);
+
+    ResolveRenderDebugView(rc);
+    FlushSpriteBatch(rc);
+
+    glEndQuery(GL_SAMPLES_PASSED);
+    RecordGPUTimestamp(gpuTimer, GPU_TIMESTAMP_FRAME_END, RENDER_PROGRAM_COUNT);
+
+    gpuTimer->frames[gpuTimer->currentFrame].isPending = 1;
+    gpuTimer->currentFrame = (gpuTimer->currentFrame + 1) % GPU_TIMER_FRAME_LATENCY;
+    gpuTimer->frameIndex++;
+}
+
+extern void BeginRenderPass(RenderContext *rc, const char *name) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    GPUTimer *gpuTimer = &renderContextInternal->gpuTimer;
+    GPUTimerFrame *frame = &gpuTimer->frames[gpuTimer->currentFrame];
+
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return;
+    }
+
+    assert(gpuTimer->currentPass < 0);
+    assert(frame->passCount < MAX_RENDER_PASSES);
+
+    BreakSpriteBatch(rc, BATCH_BREAK_PASS);
+
+    gpuTimer->currentPass = frame->passCount++;
+    gpuTimer->currentLayer = NULL;
+    frame->passNames[gpuTimer->currentPass] = name;
+
+    gpuTimer->isPassTimed = RecordGPUTimestamp(gpuTimer, GPU_TIMESTAMP_PASS_BEGIN, RENDER_PROGRAM_COUNT);
+}
+
+extern void EndRenderPass(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    GPUTimer *gpuTimer = &renderContextInternal->gpuTimer;
+
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return;
+    }
+
+    assert(gpuTimer->currentPass >= 0);
+
+    BreakSpriteBatch(rc, BATCH_BREAK_PASS);
+
+    // Without its begin, the end would be timed from the begin of a previous pass
+    if (gpuTimer->isPassTimed) {
+        RecordGPUTimestamp(gpuTimer, GPU_TIMESTAMP_PASS_END, RENDER_PROGRAM_COUNT);
+    }
+
+    gpuTimer->currentPass = -1;
+    gpuTimer->currentLayer = NULL;
+}
+
+extern void SetRenderLayer(RenderContext *rc, const char *name) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    GPUTimer *gpuTimer = &renderContextInternal->gpuTimer;
+
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return;
+    }
+
+    assert(gpuTimer->currentPass >= 0);
+
+    if (gpuTimer->currentLayer == name ||
+        (gpuTimer->currentLayer && name && strcmp(gpuTimer->currentLayer, name) == 0)) {
+        return;
+    }
+
+    // Queued sprites belong to the previous layer
+    BreakSpriteBatch(rc, BATCH_BREAK_LAYER);
+    gpuTimer->currentLayer = name;
+}
+
+extern const RenderTimings *GetRenderTimings(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return GetSoftwareRendererTimings(renderContextInternal->softwareRenderer);
+    }
+    return &renderContextInternal->gpuTimer.timings;
+}
+
+extern const BatchBreakLog *GetBatchBreakLog(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    return &renderContextInternal->lastBatchBreakLog;
+}
+
+extern const char *GetBatchBreakReasonName(BatchBreakReason reason) {
+    switch (reason) {
+        case BATCH_BREAK_TEXTURE: return "texture";
+        case BATCH_BREAK_VIEW: return "view";
+        case BATCH_BREAK_ORDER: return "order";
+        case BATCH_BREAK_PROGRAM: return "program";
+        case BATCH_BREAK_MATERIAL: return "material";
+        case BATCH_BREAK_TARGET: return "target";
+        case BATCH_BREAK_PASS: return "pass";
+        case BATCH_BREAK_DEPTH: return "depth";
+        case BATCH_BREAK_FULL: return "full";
+        case BATCH_BREAK_CLIP: return "clip";
+        case BATCH_BREAK_LAYER: return "layer";
+        default: return "unknown";
+    }
+}
+
+extern const char *GetRenderProgramName(RenderProgramKind program) {
+    switch (program) {
+        case RENDER_PROGRAM_DrawTexture: return "DrawTexture";
+        case RENDER_PROGRAM_DrawSprite: return "DrawSprite";
+        case RENDER_PROGRAM_DrawParticle: return "DrawParticle";
+        case RENDER_PROGRAM_DrawLight: return "DrawLight";
+        case RENDER_PROGRAM_DrawShadow: return "DrawShadow";
+        case RENDER_PROGRAM_PostDownsample: return "PostDownsample";
+        case RENDER_PROGRAM_PostUpsample: return "PostUpsample";
+        case RENDER_PROGRAM_PostGrade: return "PostGrade";
+        case RENDER_PROGRAM_PostVignette: return "PostVignette";
+        case RENDER_PROGRAM_DrawRepeated: return "DrawRepeated";
+        case RENDER_PROGRAM_Material: return "Material";
+        default: return "Unknown";
+    }
+}
+
+static int IsImageOpaque(const unsigned char *data, int width, int height, int stride, ImageChannel channel) {
+    if (channel != IMAGE_CHANNEL_RGBA) {
+        return 0;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        const unsigned char *row = data + stride * y;
+        for (int x = 0; x < width; ++x) {
+            if (row[x * 4 + 3] != 255) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+extern Texture *CreateTextureFromMemory(RenderContext *renderContext, const unsigned char *data, int width, int height, int stride, ImageChannel channel) {
+    if (renderContext->backend == RENDER_BACKEND_SOFTWARE) {
+        Texture *tex = malloc(sizeof(Texture));
+        tex->width = width;
+        tex->height = height;
+        tex->actualWidth = width;
+        tex->actualHeight = height;
+        tex->isOpaque = IsImageOpaque(data, width, height, stride, channel);
+        tex->alphaHull.vertexCount = 0;
+        tex->internal = CreateSoftwareTexture(data, width, height, stride, channel);
+        return tex;
+    }
+
+    Texture *tex = malloc(sizeof(Texture));
+    GLTexture *glTex = malloc(sizeof(struct GLTexture));
+    tex->width = width;
+    tex->height = height;
+    tex->isOpaque = IsImageOpaque(data, width, height, stride, channel);
+    tex->alphaHull.vertexCount = 0;
     tex->internal = glTex;
 
-    UploadImageToGPU(tex, data, width, height, stride, channel);
+    UploadImageToGPU(renderContext, tex, data, width, height, stride, channel);
+
+    return tex;
+}
+
+extern Texture *CreateTextureFromImage(RenderContext *renderContext, Image *image) {
+    Texture *tex = CreateTextureFromMemory(renderContext, image->data, image->width, image->height, image->stride, image->channel);
+
+    // Opaque textures cover their whole quad anyway
+    if (!tex->isOpaque) {
+        CalcImageAlphaHull(image, &tex->alphaHull);
+    }
 
     return tex;
 }
 
 extern void DestroyTexture(RenderContext *renderContext, Texture **ptr) {
-    (void) renderContext;
+    RenderContextInternal *renderContextInternal = renderContext->internal;
+    SpriteBatch *spriteBatch = &renderContextInternal->spriteBatch;
 
     Texture *texture = *ptr;
+
+    if (renderContext->backend == RENDER_BACKEND_SOFTWARE) {
+        DestroySoftwareTexture(renderContextInternal->softwareRenderer, texture->internal);
+        free(texture);
+        *ptr = NULL;
+        return;
+    }
+
     GLTexture *glTexture = texture->internal;
 
-    glDeleteTextures(1, &glTexture->id);
+    // Queued sprites may still sample the texture, so it is deleted after they are drawn
+    if (glTexture->page) {
+        if (spriteBatch->commandCount > 0) {
+            glTexture->page->pendingFreeMask |= 1ull << glTexture->layer;
+        } else {
+            glTexture->page->layerMask &= ~(1ull << glTexture->layer);
+        }
+    }
+
+    // The copy of a layer made by GetGLTexture2D is never sampled by queued sprites
+    if (spriteBatch->commandCount > 0 && !glTexture->page) {
+        if (spriteBatch->pendingDeleteTextureCount == spriteBatch->pendingDeleteTextureCapacity) {
+            spriteBatch->pendingDeleteTextureCapacity = spriteBatch->pendingDeleteTextureCapacity * 2 + 16;
+            spriteBatch->pendingDeleteTextures = realloc(spriteBatch->pendingDeleteTextures,
+                                                         sizeof(GLuint) * spriteBatch->pendingDeleteTextureCapacity);
+        }
+        spriteBatch->pendingDeleteTextures[spriteBatch->pendingDeleteTextureCount++] = glTexture->id;
+    } else {
+        glDeleteTextures(1, &glTexture->id);
+    }
 
     free(glTexture);
     free(texture);
@@ -354,42 +2705,568 @@ extern void DrawTexture(RenderContext *rc, T2 transform, BBox2 dstBBox,
         return;
     }
 
-    RenderContextInternal *renderContextInternal = rc->internal;
+    V2 texSize = MakeV2((float) tex->actualWidth, (float) tex->actualHeight);
+    BBox2 texBBox = MakeBBox2(HadamardDivV2(srcBBox.min, texSize), HadamardDivV2(srcBBox.max, texSize));
+
+    // Transparent pixels cost the same as any other on CPU, so the alpha hull is not used
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        PushSoftwareTextureQuad(rc, transform, dstBBox, tex->internal, texBBox, color);
+        return;
+    }
+
     GLTexture *glTex = tex->internal;
+    SpriteKind kind = SPRITE_KIND_TEXTURE;
+    if (glTex->isRenderTarget) {
+        kind = SPRITE_KIND_COMPOSITE;
+    } else if (glTex->isAlphaOnly) {
+        kind = SPRITE_KIND_GLYPH;
+    } else if (glTex->page) {
+        kind = SPRITE_KIND_TEXTURE_LAYER;
+    }
+    int isOpaque = tex->isOpaque && color.a >= 1.0f;
+
+    const AlphaHull *hull = &tex->alphaHull;
+    if (hull->vertexCount > 0 && IsAlphaHullInBBox2(hull, srcBBox)) {
+        // Map the hull from texture pixels into dstBBox
+        V2 scale = HadamardDivV2(GetBBox2Size(dstBBox), GetBBox2Size(srcBBox));
+        V2 positions[MAX_ALPHA_HULL_VERTICES];
+        V2 texCoords[MAX_ALPHA_HULL_VERTICES];
+        for (int i = 0; i < hull->vertexCount; ++i) {
+            positions[i] = AddV2(dstBBox.min, HadamardMulV2(SubV2(hull->vertices[i], srcBBox.min), scale));
+            texCoords[i] = HadamardDivV2(hull->vertices[i], texSize);
+        }
+        PushSpritePolygon(rc, transform, positions, texCoords, hull->vertexCount, glTex, isOpaque, color, kind);
+
+        // In pixels of the current view
+        T2 toView = DotT2(rc->camera, transform);
+        F pointScale = fabsf(toView.a * toView.d - toView.b * toView.c) * scale.x * scale.y * rc->pointToPixel * rc->pointToPixel;
+        V2 srcSize = GetBBox2Size(srcBBox);
+        rc->spriteTrimmedPixels += (srcSize.x * srcSize.y - GetAlphaHullArea(hull)) * pointScale;
+        return;
+    }
+
+    PushSpriteQuad(rc, transform, dstBBox, glTex, isOpaque, texBBox, color, ZeroV2(), ZeroV2(), ZeroV4(), kind);
+}
+
+extern Material *CreateMaterial(RenderContext *rc, const char *name, const char *fragmentSource, int isOpaque) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        printf("Materials are not supported by the software renderer, %s is drawn with the built-in shader\n", name);
+        return NULL;
+    }
+
+    RenderContextInternal *renderContextInternal = rc->internal;
+    ProgramBinaryCache *programBinaryCache = &renderContextInternal->programBinaryCache;
+
+    Material *material = malloc(sizeof(Material));
+    MaterialInternal *materialInternal = malloc(sizeof(MaterialInternal));
+    material->name = name;
+    material->isOpaque = isOpaque;
+    memset(material->params, 0, sizeof(material->params));
+    material->internal = materialInternal;
+
+    GLProgramBuild build;
+    BeginBuildGLProgram(&build, programBinaryCache, name, DRAW_SPRITE_VERTEX_SHADER, fragmentSource);
+    materialInternal->program = EndBuildGLProgram(&build, programBinaryCache);
+
+    glUseProgram(materialInternal->program);
+    glUniform1i(glGetUniformLocation(materialInternal->program, "texture0"), 0);
+    glUniform1i(glGetUniformLocation(materialInternal->program, "textureArray"), 1);
+    SetupViewConstantsBlock(materialInternal->program);
+    SetupClipRectsBlock(materialInternal->program);
+    materialInternal->paramsLocation = glGetUniformLocation(materialInternal->program, "params");
+
+    return material;
+}
+
+extern void DestroyMaterial(RenderContext *rc, Material **ptr) {
+    Material *material = *ptr;
+    MaterialInternal *materialInternal = material->internal;
+
+    // Queued sprites may still be drawn with the program
+    FlushSpriteBatch(rc);
+    glDeleteProgram(materialInternal->program);
+
+    free(materialInternal);
+    free(material);
+
+    *ptr = NULL;
+}
+
+extern void DrawTextureWithMaterial(RenderContext *rc, T2 transform, BBox2 dstBBox, Texture *tex, BBox2 srcBBox,
+                                    V4 color, Material *material) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    // Debug views show what the built-in shader counts, so materials don't have to implement them
+    if (material == NULL || rc->backend == RENDER_BACKEND_SOFTWARE ||
+        renderContextInternal->debugMode != RENDER_DEBUG_MODE_NONE) {
+        DrawTexture(rc, transform, dstBBox, tex, srcBBox, color);
+        return;
+    }
+
+    renderContextInternal->currentMaterial = material;
+    DrawTexture(rc, transform, dstBBox, tex, srcBBox, color);
+    renderContextInternal->currentMaterial = NULL;
+}
+
+extern RenderTarget *CreateRenderTarget(RenderContext *rc, int width, int height, TextureFilter filter) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        printf("Render targets are not supported by the software renderer\n");
+        return NULL;
+    }
+
+    RenderTarget *target = malloc(sizeof(RenderTarget));
+    RenderTargetInternal *targetInternal = malloc(sizeof(RenderTargetInternal));
+    target->width = width;
+    target->height = height;
+    target->viewWidth = width;
+    target->viewHeight = height;
+    target->internal = targetInternal;
+
+    Texture *tex = malloc(sizeof(Texture));
+    GLTexture *glTex = malloc(sizeof(GLTexture));
+    tex->width = width;
+    tex->height = height;
+    tex->actualWidth = width;
+    tex->actualHeight = height;
+    tex->isOpaque = 0;
+    tex->alphaHull.vertexCount = 0;
+    tex->internal = glTex;
+    target->texture = tex;
+
+    glTex->page = NULL;
+    glTex->layer = 0;
+    glTex->isAlphaOnly = 0;
+    glTex->isRenderTarget = 1;
+    glGenTextures(1, &glTex->id);
+    glBindTexture(GL_TEXTURE_2D, glTex->id);
+    // sRGB so the linear color written with GL_FRAMEBUFFER_SRGB is decoded back when it is sampled
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    GLint glFilter = filter == TEXTURE_FILTER_LINEAR ? GL_LINEAR : GL_NEAREST;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, glFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, glFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Depth of sprites, see SpriteBatch, and stencil of shadows, see DrawLights
+    glGenRenderbuffers(1, &targetInternal->depthRbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, targetInternal->depthRbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &targetInternal->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetInternal->fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, glTex->id, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, targetInternal->depthRbo);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Failed to create render target %dx%d\n", width, height);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return target;
+}
+
+extern void DestroyRenderTarget(RenderContext *rc, RenderTarget **ptr) {
+    RenderTarget *target = *ptr;
+    RenderTargetInternal *targetInternal = target->internal;
+
+    glDeleteFramebuffers(1, &targetInternal->fbo);
+    glDeleteRenderbuffers(1, &targetInternal->depthRbo);
+    DestroyTexture(rc, &target->texture);
+
+    free(targetInternal);
+    free(target);
+
+    *ptr = NULL;
+}
+
+extern void BeginRenderTargetView(RenderContext *rc, RenderTarget *target, float width, float height, float pointToPixel) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    RenderTargetInternal *targetInternal = target->internal;
+
+    assert(renderContextInternal->currentTarget == NULL);
+    renderContextInternal->currentTarget = target;
+
+    BreakSpriteBatch(rc, BATCH_BREAK_TARGET);
+
+    RenderView *windowView = &renderContextInternal->windowView;
+    windowView->width = rc->width;
+    windowView->height = rc->height;
+    windowView->pointToPixel = rc->pointToPixel;
+    windowView->pixelToPoint = rc->pixelToPoint;
+    windowView->projection = rc->projection;
+    windowView->camera = rc->camera;
+
+    target->viewWidth = (int) MinF(CeilF(width * pointToPixel), (float) target->width);
+    target->viewHeight = (int) MinF(CeilF(height * pointToPixel), (float) target->height);
+
+    rc->width = width;
+    rc->height = height;
+    rc->pointToPixel = pointToPixel;
+    rc->pixelToPoint = 1.0f / pointToPixel;
+    rc->projection = MakeProjection(rc->width, rc->height);
+    rc->camera = IdentityT2();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, targetInternal->fbo);
+    glViewport(0, 0, target->viewWidth, target->viewHeight);
+    // Only the view is cleared, pixels outside of it are never sampled
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, target->viewWidth, target->viewHeight);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    glDisable(GL_SCISSOR_TEST);
+    renderContextInternal->spriteBatch.depth = SPRITE_MAX_DEPTH;
+}
+
+extern void EndRenderTarget(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    assert(renderContextInternal->currentTarget != NULL);
+    renderContextInternal->currentTarget = NULL;
+
+    BreakSpriteBatch(rc, BATCH_BREAK_TARGET);
+
+    RenderView *windowView = &renderContextInternal->windowView;
+    rc->width = windowView->width;
+    rc->height = windowView->height;
+    rc->pointToPixel = windowView->pointToPixel;
+    rc->pixelToPoint = windowView->pixelToPoint;
+    rc->projection = windowView->projection;
+    rc->camera = windowView->camera;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, (GLsizei) (rc->width * rc->pointToPixel), (GLsizei) (rc->height * rc->pointToPixel));
+
+    // Depth of the window was left at the sprites drawn before the target
+    ResetSpriteDepth(rc);
+}
+
+extern void DrawRenderTargetUpscaled(RenderContext *rc, RenderTarget *target) {
+    float windowWidth = FloorF(rc->width * rc->pointToPixel);
+    float windowHeight = FloorF(rc->height * rc->pointToPixel);
+
+    float scale = FloorF(MinF(windowWidth / target->viewWidth, windowHeight / target->viewHeight));
+    if (scale < 1.0f) {
+        scale = 1.0f;
+    }
+
+    // Snap to whole pixels so every texel covers exactly scale x scale pixels
+    V2 size = MakeV2(target->viewWidth * scale, target->viewHeight * scale);
+    V2 min = MakeV2(FloorF((windowWidth - size.x) / 2.0f), FloorF((windowHeight - size.y) / 2.0f));
+    BBox2 dstBBox = MakeBBox2MinSize(MulV2(rc->pixelToPoint, min), MulV2(rc->pixelToPoint, size));
+    BBox2 srcBBox = MakeBBox2(ZeroV2(), MakeV2((F) target->viewWidth, (F) target->viewHeight));
+
+    T2 camera = rc->camera;
+    rc->camera = IdentityT2();
+    DrawTexture(rc, IdentityT2(), dstBBox, target->texture, srcBBox, OneV4());
+    rc->camera = camera;
+}
+
+extern void DrawRenderTargetStretched(RenderContext *rc, RenderTarget *target) {
+    BBox2 dstBBox = MakeBBox2(ZeroV2(), MakeV2(rc->width, rc->height));
+    BBox2 srcBBox = MakeBBox2(ZeroV2(), MakeV2((F) target->viewWidth, (F) target->viewHeight));
+
+    T2 camera = rc->camera;
+    rc->camera = IdentityT2();
+    DrawTexture(rc, IdentityT2(), dstBBox, target->texture, srcBBox, OneV4());
+    rc->camera = camera;
+}
+
+extern StaticMesh *CreateStaticMesh(RenderContext *rc) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        StaticMesh *mesh = malloc(sizeof(StaticMesh));
+        mesh->vertexCount = 0;
+        mesh->indexCount = 0;
+        mesh->internal = calloc(1, sizeof(SoftwareStaticMesh));
+        return mesh;
+    }
+
+    StaticMesh *mesh = malloc(sizeof(StaticMesh));
+    StaticMeshInternal *meshInternal = malloc(sizeof(StaticMeshInternal));
+    mesh->vertexCount = 0;
+    mesh->indexCount = 0;
+    mesh->internal = meshInternal;
+    meshInternal->indexType = GL_UNSIGNED_SHORT;
+
+    glGenVertexArrays(1, &meshInternal->vao);
+    glGenBuffers(1, &meshInternal->vbo);
+    glGenBuffers(1, &meshInternal->ebo);
+
+    glBindVertexArray(meshInternal->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, meshInternal->vbo);
+    glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshInternal->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
+
+    SetupDrawTextureVertexAttribs();
+
+    glBindVertexArray(0);
+
+    return mesh;
+}
+
+extern void DestroyStaticMesh(RenderContext *rc, StaticMesh **ptr) {
+    StaticMesh *mesh = *ptr;
+
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        SoftwareStaticMesh *softwareMesh = mesh->internal;
+        free(softwareMesh->transforms);
+        free(softwareMesh->dstBBoxes);
+        free(softwareMesh->texBBoxes);
+        free(softwareMesh);
+        free(mesh);
+        *ptr = NULL;
+        return;
+    }
+
+    StaticMeshInternal *meshInternal = mesh->internal;
+
+    glDeleteVertexArrays(1, &meshInternal->vao);
+    glDeleteBuffers(1, &meshInternal->vbo);
+    glDeleteBuffers(1, &meshInternal->ebo);
+
+    free(meshInternal);
+    free(mesh);
+
+    *ptr = NULL;
+}
+
+extern void UploadStaticMeshQuads(RenderContext *rc, StaticMesh *mesh, Texture *tex,
+                                  const BBox2 *dstBBoxes, const BBox2 *srcBBoxes, int count) {
+    UploadStaticMeshTransformedQuads(rc, mesh, tex, NULL, dstBBoxes, srcBBoxes, count);
+}
+
+extern void UploadStaticMeshTransformedQuads(RenderContext *rc, StaticMesh *mesh, Texture *tex, const T2 *transforms,
+                                             const BBox2 *dstBBoxes, const BBox2 *srcBBoxes, int count) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        SoftwareStaticMesh *softwareMesh = mesh->internal;
+        V2 texSize = MakeV2((float) tex->actualWidth, (float) tex->actualHeight);
+        softwareMesh->quadCount = count;
+        softwareMesh->transforms = realloc(softwareMesh->transforms, sizeof(T2) * count);
+        softwareMesh->dstBBoxes = realloc(softwareMesh->dstBBoxes, sizeof(BBox2) * count);
+        softwareMesh->texBBoxes = realloc(softwareMesh->texBBoxes, sizeof(BBox2) * count);
+        for (int i = 0; i < count; ++i) {
+            softwareMesh->transforms[i] = transforms ? transforms[i] : IdentityT2();
+            softwareMesh->dstBBoxes[i] = dstBBoxes[i];
+            softwareMesh->texBBoxes[i] = MakeBBox2(HadamardDivV2(srcBBoxes[i].min, texSize),
+                                                   HadamardDivV2(srcBBoxes[i].max, texSize));
+        }
+        mesh->vertexCount = count * 4;
+        mesh->indexCount = count * 6;
+        return;
+    }
+
+    StaticMeshInternal *meshInternal = mesh->internal;
+
+    int vertexCount = count * 4;
+    int indexCount = count * 6;
+    int isShortIndex = vertexCount <= 65536;
+    size_t indexSize = isShortIndex ? sizeof(GLushort) : sizeof(GLuint);
+    DrawTextureVertexAttrib *vertices = malloc(sizeof(DrawTextureVertexAttrib) * vertexCount);
+    void *indices = malloc(indexSize * indexCount);
 
     V2 texSize = MakeV2((float) tex->actualWidth, (float) tex->actualHeight);
-    BBox2 texBBox = MakeBBox2(HadamardDivV2(srcBBox.min, texSize), HadamardDivV2(srcBBox.max, texSize));
-    GLM3 t = MakeGLM3FromT2(transform);
-    DrawTextureVertexAttrib vertices[] = {
-        t.m[0], t.m[1], t.m[2], t.m[3], t.m[4], t.m[5], t.m[6], t.m[7], t.m[8], dstBBox.max.x, dstBBox.max.y, texBBox.max.x, texBBox.max.y, color.r, color.g, color.b, color.a,   // top right
-        t.m[0], t.m[1], t.m[2], t.m[3], t.m[4], t.m[5], t.m[6], t.m[7], t.m[8], dstBBox.max.x, dstBBox.min.y, texBBox.max.x, texBBox.min.y, color.r, color.g, color.b, color.a,   // bottom right
-        t.m[0], t.m[1], t.m[2], t.m[3], t.m[4], t.m[5], t.m[6], t.m[7], t.m[8], dstBBox.min.x, dstBBox.min.y, texBBox.min.x, texBBox.min.y, color.r, color.g, color.b, color.a,   // bottom left
-        t.m[0], t.m[1], t.m[2], t.m[3], t.m[4], t.m[5], t.m[6], t.m[7], t.m[8], dstBBox.min.x, dstBBox.max.y, texBBox.min.x, texBBox.max.y, color.r, color.g, color.b, color.a,   // top left
-    };
 
-    unsigned int indices[] = {  // note that we start from 0!
-        0, 1, 3,   // first triangle
-        1, 2, 3,   // second triangle
-    };
+    for (int i = 0; i < count; ++i) {
+        BBox2 dstBBox = dstBBoxes[i];
+        BBox2 texBBox = MakeBBox2(HadamardDivV2(srcBBoxes[i].min, texSize), HadamardDivV2(srcBBoxes[i].max, texSize));
+
+        V2 pos[4] = {
+            dstBBox.max, MakeV2(dstBBox.max.x, dstBBox.min.y), dstBBox.min, MakeV2(dstBBox.min.x, dstBBox.max.y),
+        };
+        if (transforms) {
+            for (int j = 0; j < 4; ++j) {
+                pos[j] = ApplyT2(transforms[i], pos[j]);
+            }
+        }
+        V2 texCoord[4] = {
+            texBBox.max, MakeV2(texBBox.max.x, texBBox.min.y), texBBox.min, MakeV2(texBBox.min.x, texBBox.max.y),
+        };
+
+        for (int j = 0; j < 4; ++j) {
+            DrawTextureVertexAttrib *vertex = &vertices[i * 4 + j];
+            vertex->pos[0] = pos[j].x;
+            vertex->pos[1] = pos[j].y;
+            vertex->texCoord[0] = PackUnorm16(texCoord[j].x);
+            vertex->texCoord[1] = PackUnorm16(texCoord[j].y);
+            memset(vertex->color, 0xFF, sizeof(vertex->color));
+        }
+
+        GLuint base = (GLuint) i * 4;
+        GLuint quad[6] = {
+            base + 0, base + 1, base + 3,
+            base + 1, base + 2, base + 3,
+        };
+        for (int j = 0; j < 6; ++j) {
+            if (isShortIndex) {
+                ((GLushort *) indices)[i * 6 + j] = (GLushort) quad[j];
+            } else {
+                ((GLuint *) indices)[i * 6 + j] = quad[j];
+            }
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, meshInternal->vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(DrawTextureVertexAttrib) * vertexCount, vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshInternal->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize * indexCount, indices, GL_STATIC_DRAW);
+
+    meshInternal->indexType = isShortIndex ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    mesh->vertexCount = vertexCount;
+    mesh->indexCount = indexCount;
+
+    free(vertices);
+    free(indices);
+}
+
+extern void DrawStaticMesh(RenderContext *rc, T2 transform, StaticMesh *mesh, Texture *tex) {
+    if (!tex || mesh->indexCount == 0) {
+        return;
+    }
+
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        SoftwareStaticMesh *softwareMesh = mesh->internal;
+        for (int i = 0; i < softwareMesh->quadCount; ++i) {
+            PushSoftwareTextureQuad(rc, DotT2(transform, softwareMesh->transforms[i]), softwareMesh->dstBBoxes[i],
+                                    tex->internal, softwareMesh->texBBoxes[i], OneV4());
+        }
+        return;
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, renderContextInternal->drawTextureProgram.vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
+    RenderContextInternal *renderContextInternal = rc->internal;
+    StaticMeshInternal *meshInternal = mesh->internal;
+    GLTexture *glTex = tex->internal;
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderContextInternal->drawTextureProgram.ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STREAM_DRAW);
+    // Keep drawing order with the sprites queued before
+    BreakSpriteBatch(rc, BATCH_BREAK_PROGRAM);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, glTex->id);
+    glBindTexture(GL_TEXTURE_2D, GetGLTexture2D(glTex));
 
     glUseProgram(renderContextInternal->drawTextureProgram.program);
-    GLM3 MVP = MakeGLM3FromT2(DotT2(rc->projection, rc->camera));
-    glUniformMatrix3fv(renderContextInternal->drawTextureProgram.MVPLocation, 1, GL_FALSE, MVP.m);
+    BindViewConstants(rc, GetViewConstantsSlot(rc));
+    GLM3 model = MakeGLM3FromT2(transform);
+    glUniformMatrix3fv(renderContextInternal->drawTextureProgram.modelLocation, 1, GL_FALSE, model.m);
+    SetDebugUniforms(rc, renderContextInternal->drawTextureProgram.debugModeLocation,
+                     renderContextInternal->drawTextureProgram.debugColorLocation);
 
-    glBindVertexArray(renderContextInternal->drawTextureProgram.vao);
+    glBindVertexArray(meshInternal->vao);
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, mesh->indexCount, meshInternal->indexType, 0);
 
-    rc->drawCallCount++;
+    CountDrawCall(rc, RENDER_PROGRAM_DrawTexture);
+}
+
+extern void DrawTextureRepeated(RenderContext *rc, Texture *tex, V2 tileSize, V2 origin, V4 color) {
+    if (!tex || tileSize.x <= 0.0f || tileSize.y <= 0.0f) {
+        return;
+    }
+
+    BBox2 view = GetViewBBox2(rc, IdentityT2());
+    V2 tiles = HadamardDivV2(GetBBox2Size(view), tileSize);
+    // Tile coordinate of the bottom left of the view. Only the fraction matters, which keeps precision far from origin.
+    V2 start = HadamardDivV2(SubV2(view.min, origin), tileSize);
+    start = SubV2(start, MakeV2(FloorF(start.x), FloorF(start.y)));
+    V2 imageScale = MakeV2((F) tex->width / tex->actualWidth, (F) tex->height / tex->actualHeight);
+
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        // One quad per visible tile
+        BBox2 texBBox = MakeBBox2(ZeroV2(), imageScale);
+        for (F y = -start.y; y < tiles.y; y += 1.0f) {
+            for (F x = -start.x; x < tiles.x; x += 1.0f) {
+                V2 min = AddV2(view.min, HadamardMulV2(MakeV2(x, y), tileSize));
+                PushSoftwareTextureQuad(rc, IdentityT2(), MakeBBox2MinSize(min, tileSize), tex->internal, texBBox, color);
+            }
+        }
+        return;
+    }
+
+    RenderContextInternal *renderContextInternal = rc->internal;
+    DrawRepeatedProgram *drawRepeatedProgram = &renderContextInternal->drawRepeatedProgram;
+
+    // Keep drawing order with the sprites queued before
+    BreakSpriteBatch(rc, BATCH_BREAK_PROGRAM);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, GetGLTexture2D(tex->internal));
+
+    glUseProgram(drawRepeatedProgram->program);
+    glUniform4f(drawRepeatedProgram->tilingLocation, tiles.x, tiles.y, start.x, start.y);
+    glUniform2f(drawRepeatedProgram->imageScaleLocation, imageScale.x, imageScale.y);
+    glUniform4f(drawRepeatedProgram->colorLocation, color.r, color.g, color.b, color.a);
+    SetDebugUniforms(rc, drawRepeatedProgram->debugModeLocation, drawRepeatedProgram->debugColorLocation);
+
+    glBindVertexArray(renderContextInternal->postVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    CountDrawCall(rc, RENDER_PROGRAM_DrawRepeated);
+}
+
+extern void DrawParticles(RenderContext *rc, Texture *tex, const ParticleInstances *instances) {
+    if (!tex || instances->count <= 0) {
+        return;
+    }
+
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        BBox2 texBBox = MakeBBox2(ZeroV2(), MakeV2((F) tex->width / tex->actualWidth, (F) tex->height / tex->actualHeight));
+        for (int i = 0; i < instances->count; ++i) {
+            // Particle colors are pre-multiplied like in draw_particle.frag
+            F a = instances->colorA[i];
+            V4 color = MakeV4(instances->colorR[i] * a, instances->colorG[i] * a, instances->colorB[i] * a, a);
+            BBox2 dstBBox = MakeBBox2CenSize(MakeV2(instances->posX[i], instances->posY[i]),
+                                             MakeV2(instances->size[i], instances->size[i]));
+            PushSoftwareTextureQuad(rc, IdentityT2(), dstBBox, tex->internal, texBBox, color);
+        }
+        return;
+    }
+
+    RenderContextInternal *renderContextInternal = rc->internal;
+    DrawParticleProgram *drawParticleProgram = &renderContextInternal->drawParticleProgram;
+    GLTexture *glTex = tex->internal;
+
+    // Keep drawing order with the sprites queued before
+    BreakSpriteBatch(rc, BATCH_BREAK_PROGRAM);
+
+    const F *arrays[DRAW_PARTICLE_INSTANCE_ATTRIB_COUNT] = {
+        instances->posX, instances->posY, instances->size,
+        instances->colorR, instances->colorG, instances->colorB, instances->colorA,
+    };
+
+    // Upload each array as is into its own range of the instance buffer, so no repacking on CPU
+    GLsizeiptr arraySize = (GLsizeiptr) sizeof(F) * instances->count;
+    GLsizeiptr instanceVboSize = arraySize * DRAW_PARTICLE_INSTANCE_ATTRIB_COUNT;
+
+    glBindVertexArray(drawParticleProgram->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, drawParticleProgram->instanceVbo);
+    if (instanceVboSize > drawParticleProgram->instanceVboSize) {
+        drawParticleProgram->instanceVboSize = instanceVboSize;
+    }
+    // Orphan the previous storage to avoid waiting on draws still using it
+    glBufferData(GL_ARRAY_BUFFER, drawParticleProgram->instanceVboSize, NULL, GL_STREAM_DRAW);
+
+    for (int i = 0; i < DRAW_PARTICLE_INSTANCE_ATTRIB_COUNT; ++i) {
+        GLintptr offset = arraySize * i;
+        glBufferSubData(GL_ARRAY_BUFFER, offset, arraySize, arrays[i]);
+        glVertexAttribPointer((GLuint) i + 1, 1, GL_FLOAT, GL_FALSE, sizeof(F), (void *) offset);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, GetGLTexture2D(glTex));
+
+    glUseProgram(drawParticleProgram->program);
+    BindViewConstants(rc, GetViewConstantsSlot(rc));
+    glUniform2f(drawParticleProgram->texCoordScaleLocation,
+                (F) tex->width / tex->actualWidth, (F) tex->height / tex->actualHeight);
+    SetDebugUniforms(rc, drawParticleProgram->debugModeLocation, drawParticleProgram->debugColorLocation);
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instances->count);
+
+    glBindVertexArray(0);
+
+    CountDrawCall(rc, RENDER_PROGRAM_DrawParticle);
 }
 
 extern Font *LoadFont(RenderContext *renderContext, const char *filename) {
@@ -413,12 +3290,144 @@ extern Font *LoadFont(RenderContext *renderContext, const char *filename) {
 
     fontInternal->buf = malloc(size);
 
-    fread(fontInternal->buf, 1, size, file);
-    fclose(file);
+    fread(fontInternal->buf, 1, size, file);
+    fclose(file);
+
+    stbtt_InitFont(&fontInternal->info, fontInternal->buf, 0);
+
+    fontInternal->glyphCount = 0;
+    fontInternal->glyphCapacity = 0;
+    fontInternal->glyphs = NULL;
+    fontInternal->pages = NULL;
+
+    return font;
+}
+
+static Glyph *FindGlyphSlot(Glyph *glyphs, int capacity, int codePoint, float scale) {
+    uint64_t hash = HashBytes(0xCBF29CE484222325ull, &codePoint, sizeof(codePoint));
+    hash = HashBytes(hash, &scale, sizeof(scale));
+
+    for (int i = (int) (hash & (uint64_t) (capacity - 1));; i = (i + 1) & (capacity - 1)) {
+        Glyph *glyph = &glyphs[i];
+        if (glyph->scale == 0.0f || (glyph->codePoint == codePoint && glyph->scale == scale)) {
+            return glyph;
+        }
+    }
+}
+
+// Copy the top down bitmap into the texels of tex whose bottom left is x, y
+static void UploadGlyphBitmap(RenderContext *rc, Texture *tex, int x, int y, const unsigned char *bitmap, int width,
+                              int height) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        UpdateSoftwareTexture(tex->internal, x, y, bitmap, width, height, width, IMAGE_CHANNEL_A);
+        return;
+    }
+
+    // Textures are stored bottom row first
+    unsigned char *flipped = malloc((size_t) width * height);
+    for (int row = 0; row < height; ++row) {
+        memcpy(flipped + (size_t) row * width, bitmap + (size_t) (height - 1 - row) * width, (size_t) width);
+    }
+
+    GLTexture *glTex = tex->internal;
+    glBindTexture(GL_TEXTURE_2D, glTex->id);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RED, GL_UNSIGNED_BYTE, flipped);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    free(flipped);
+}
+
+// Reserve width x height texels in the first page of the font, adding a page if it is full
+static GlyphAtlasPage *AllocGlyphRect(RenderContext *rc, FontInternal *fontInternal, int width, int height,
+                                      int *x, int *y) {
+    GlyphAtlasPage *page = fontInternal->pages;
+    if (page && page->shelfX + width > GLYPH_ATLAS_SIZE) {
+        // Start a shelf above the current one
+        page->shelfY += page->shelfHeight + GLYPH_ATLAS_PADDING;
+        page->shelfX = 0;
+        page->shelfHeight = 0;
+    }
+
+    if (page == NULL || page->shelfY + height > GLYPH_ATLAS_SIZE) {
+        unsigned char *empty = calloc(GLYPH_ATLAS_SIZE * GLYPH_ATLAS_SIZE, 1);
+        page = malloc(sizeof(GlyphAtlasPage));
+        page->texture = CreateTextureFromMemory(rc, empty, GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE,
+                                                IMAGE_CHANNEL_A);
+        page->shelfX = 0;
+        page->shelfY = 0;
+        page->shelfHeight = 0;
+        page->next = fontInternal->pages;
+        fontInternal->pages = page;
+        free(empty);
+    }
+
+    *x = page->shelfX;
+    *y = page->shelfY;
+    page->shelfX += width + GLYPH_ATLAS_PADDING;
+    if (height > page->shelfHeight) {
+        page->shelfHeight = height;
+    }
+    return page;
+}
+
+// Return the glyph of codePoint at scale, rasterizing it into the atlas of the font the first time
+static const Glyph *GetGlyph(RenderContext *rc, FontInternal *fontInternal, int codePoint, float scale) {
+    if (fontInternal->glyphCapacity > 0) {
+        Glyph *glyph = FindGlyphSlot(fontInternal->glyphs, fontInternal->glyphCapacity, codePoint, scale);
+        if (glyph->scale != 0.0f) {
+            return glyph;
+        }
+    }
+
+    // Keep at most half of the slots used so probing stays short
+    if ((fontInternal->glyphCount + 1) * 2 > fontInternal->glyphCapacity) {
+        int capacity = fontInternal->glyphCapacity ? fontInternal->glyphCapacity * 2 : 256;
+        Glyph *glyphs = calloc((size_t) capacity, sizeof(Glyph));
+        for (int i = 0; i < fontInternal->glyphCapacity; ++i) {
+            Glyph *glyph = &fontInternal->glyphs[i];
+            if (glyph->scale != 0.0f) {
+                *FindGlyphSlot(glyphs, capacity, glyph->codePoint, glyph->scale) = *glyph;
+            }
+        }
+        free(fontInternal->glyphs);
+        fontInternal->glyphs = glyphs;
+        fontInternal->glyphCapacity = capacity;
+    }
+
+    Glyph *glyph = FindGlyphSlot(fontInternal->glyphs, fontInternal->glyphCapacity, codePoint, scale);
+    glyph->codePoint = codePoint;
+    glyph->scale = scale;
+    glyph->texture = NULL;
+    glyph->srcBBox = ZeroBBox2();
+    glyph->xOff = 0;
+    glyph->yOff = 0;
+    fontInternal->glyphCount++;
+
+    int width, height, xOff, yOff;
+    unsigned char *bitmap = stbtt_GetCodepointBitmap(&fontInternal->info, scale, scale, codePoint, &width, &height,
+                                                     &xOff, &yOff);
+    if (bitmap == NULL) {
+        return glyph;
+    }
+
+    if (width <= GLYPH_ATLAS_SIZE && height <= GLYPH_ATLAS_SIZE) {
+        int x, y;
+        GlyphAtlasPage *page = AllocGlyphRect(rc, fontInternal, width, height, &x, &y);
+        UploadGlyphBitmap(rc, page->texture, x, y, bitmap, width, height);
+
+        glyph->texture = page->texture;
+        glyph->srcBBox = MakeBBox2MinSize(MakeV2((float) x, (float) y), MakeV2((float) width, (float) height));
+        glyph->xOff = xOff;
+        glyph->yOff = yOff;
+    } else {
+        printf("Glyph %d of %d x %d pixels doesn't fit in the glyph atlas\n", codePoint, width, height);
+    }
 
-    stbtt_InitFont(&fontInternal->info, fontInternal->buf, 0);
+    stbtt_FreeBitmap(bitmap, 0);
 
-    return font;
+    return glyph;
 }
 
 extern float GetFontAscent(RenderContext *renderContext, Font *font, float size) {
@@ -471,18 +3480,15 @@ extern void DrawLineText(RenderContext *rc, Font *font, float size, float x, flo
     for (size_t i = 0; i < strlen(text); ++i) {
         int codePoint = text[i];
 
-        int width, height, xOff, yOff;
-        unsigned char *bitmap = stbtt_GetCodepointBitmap(info, scale, scale, codePoint, &width, &height, &xOff, &yOff);
-        if (bitmap != NULL) {
-            Texture *texture = CreateTextureFromMemory(rc, bitmap, width, height, width, IMAGE_CHANNEL_A);
+        // Glyphs of the font share the atlas texture, so a line is one sprite batch command
+        const Glyph *glyph = GetGlyph(rc, fontInternal, codePoint, scale);
+        if (glyph->texture) {
+            V2 size = GetBBox2Size(glyph->srcBBox);
             DrawTexture(rc, IdentityT2(),
-                        MakeBBox2MinSize(MakeV2(x + xOff * rc->pixelToPoint,
-                                                y - (height + yOff) * rc->pixelToPoint),
-                                         MakeV2(width * rc->pixelToPoint,
-                                                height * rc->pixelToPoint)),
-                        texture, MakeBBox2FromTexture(texture), color);
-            DestroyTexture(rc, &texture);
-            stbtt_FreeBitmap(bitmap, 0);
+                        MakeBBox2MinSize(MakeV2(x + glyph->xOff * rc->pixelToPoint,
+                                                y - (size.y + glyph->yOff) * rc->pixelToPoint),
+                                         MulV2(rc->pixelToPoint, size)),
+                        glyph->texture, glyph->srcBBox, color);
         }
 
         int axInt;
@@ -499,39 +3505,752 @@ extern void DrawLineText(RenderContext *rc, Font *font, float size, float x, flo
 }
 
 extern void DrawRect(RenderContext *rc, T2 transform, BBox2 bbox, F roundRadius, F thickness, V4 color, V4 borderColor) {
-    RenderContextInternal *renderContextInternal = rc->internal;
-
     V2 size = GetBBox2Size(bbox);
     roundRadius = MinF(roundRadius, MinF(size.x, size.y) / 2.0f);
     thickness = MinF(thickness, MinF(size.x, size.y) / 2.0f);
     V2 normalizedRoundRadius = DivV2(roundRadius, size);
     V2 normalizedThickness = DivV2(thickness, size);
-    GLM3 t = MakeGLM3FromT2(transform);
-    DrawRectVertexAttrib vertices[] = {
-        t.m[0], t.m[1], t.m[2], t.m[3], t.m[4], t.m[5], t.m[6], t.m[7], t.m[8], bbox.max.x, bbox.max.y, 1.0f, 1.0f, color.r, color.g, color.b, color.a, normalizedRoundRadius.x, normalizedRoundRadius.y, normalizedThickness.x, normalizedThickness.y, borderColor.r, borderColor.g, borderColor.b, borderColor.a,  // top right
-        t.m[0], t.m[1], t.m[2], t.m[3], t.m[4], t.m[5], t.m[6], t.m[7], t.m[8], bbox.max.x, bbox.min.y, 1.0f, 0.0f, color.r, color.g, color.b, color.a, normalizedRoundRadius.x, normalizedRoundRadius.y, normalizedThickness.x, normalizedThickness.y, borderColor.r, borderColor.g, borderColor.b, borderColor.a,  // bottom right
-        t.m[0], t.m[1], t.m[2], t.m[3], t.m[4], t.m[5], t.m[6], t.m[7], t.m[8], bbox.min.x, bbox.min.y, 0.0f, 0.0f, color.r, color.g, color.b, color.a, normalizedRoundRadius.x, normalizedRoundRadius.y, normalizedThickness.x, normalizedThickness.y, borderColor.r, borderColor.g, borderColor.b, borderColor.a,  // bottom left
-        t.m[0], t.m[1], t.m[2], t.m[3], t.m[4], t.m[5], t.m[6], t.m[7], t.m[8], bbox.min.x, bbox.max.y, 0.0f, 1.0f, color.r, color.g, color.b, color.a, normalizedRoundRadius.x, normalizedRoundRadius.y, normalizedThickness.x, normalizedThickness.y, borderColor.r, borderColor.g, borderColor.b, borderColor.a,  // top left
-    };
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        RenderContextInternal *renderContextInternal = rc->internal;
+        T2 toPixel = GetSoftwarePixelTransform(rc, transform);
+
+        SoftwareQuad quad = {0};
+        quad.kind = SOFTWARE_QUAD_RECT;
+        quad.origin = ApplyT2(toPixel, bbox.min);
+        quad.xAxis = MulV2(size.x, toPixel.xAxis);
+        quad.yAxis = MulV2(size.y, toPixel.yAxis);
+        quad.color = color;
+        quad.roundRadius = normalizedRoundRadius;
+        quad.thickness = normalizedThickness;
+        quad.borderColor = borderColor;
+        PushSoftwareQuad(renderContextInternal->softwareRenderer, &quad);
+        rc->spriteCount++;
+        return;
+    }
 
-    unsigned int indices[] = {  // note that we start from 0!
-        0, 1, 3,   // first triangle
-        1, 2, 3,   // second triangle
-    };
+    // Rounded corners are anti-aliased, so they are never opaque
+    int isOpaque = roundRadius <= 0.0f && color.a >= 1.0f && (thickness <= 0.0f || borderColor.a >= 1.0f);
+    PushSpriteQuad(rc, transform, bbox, NULL, isOpaque, MakeBBox2(ZeroV2(), OneV2()), color,
+                   normalizedRoundRadius, normalizedThickness, borderColor, SPRITE_KIND_RECT);
+}
+
+// Add (GL_INCR) or remove (GL_DECR) the rect of the top clip to the pixels inside all rotated clips of the stack.
+// The rect is drawn with the axis aligned clips of the entry, the same on push and on pop.
+static void DrawClipRectStencil(RenderContext *rc, GLenum op) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    ClipRectStack *clipRects = &renderContextInternal->clipRects;
+    ClipRect *entry = &clipRects->entries[clipRects->count - 1];
+
+    // Sprites queued before are drawn with the stencil test of the previous clips, the rect is drawn alone
+    if (renderContextInternal->spriteBatch.commandCount > 0) {
+        rc->clipFlushCount++;
+    }
+    BreakSpriteBatch(rc, BATCH_BREAK_CLIP);
+
+    glEnable(GL_STENCIL_TEST);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glStencilFunc(GL_EQUAL, clipRects->stencilDepth, 0xFF);
+    // Sprites in front of the rect don't hide it
+    glStencilOp(GL_KEEP, op, op);
+
+    PushSpriteQuad(rc, entry->transform, entry->rect, NULL, 0, MakeBBox2(ZeroV2(), OneV2()), OneV4(),
+                   ZeroV2(), ZeroV2(), ZeroV4(), SPRITE_KIND_SOLID);
+    FlushSpriteBatch(rc);
+    rc->clipFlushCount++;
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    clipRects->stencilDepth += op == GL_INCR ? 1 : -1;
+    if (clipRects->stencilDepth > 0) {
+        glStencilFunc(GL_EQUAL, clipRects->stencilDepth, 0xFF);
+    } else {
+        glDisable(GL_STENCIL_TEST);
+    }
+}
+
+extern void PushClipRect(RenderContext *rc, T2 transform, BBox2 rect) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return;
+    }
+
+    RenderContextInternal *renderContextInternal = rc->internal;
+    ClipRectStack *clipRects = &renderContextInternal->clipRects;
+    assert(clipRects->count < MAX_CLIP_RECT_DEPTH);
+
+    ClipRect *entry = &clipRects->entries[clipRects->count];
+    entry->transform = transform;
+    entry->rect = rect;
+    // Rotations by a multiple of 90 degrees stay axis aligned
+    entry->isRotated = !((transform.m10 == 0.0f && transform.m01 == 0.0f) ||
+                         (transform.m00 == 0.0f && transform.m11 == 0.0f));
+    entry->hasBBox = 0;
+    entry->bbox = ZeroBBox2();
+    entry->slot = 0;
+
+    if (clipRects->count > 0) {
+        ClipRect *parent = &clipRects->entries[clipRects->count - 1];
+        entry->hasBBox = parent->hasBBox;
+        entry->bbox = parent->bbox;
+        entry->slot = parent->slot;
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, renderContextInternal->drawRectProgram.vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
+    if (!entry->isRotated) {
+        BBox2 bbox = TransformBBox2(transform, rect);
+        if (entry->hasBBox) {
+            // Empty if they don't overlap, which clips everything
+            bbox.min = MakeV2(fmaxf(bbox.min.x, entry->bbox.min.x), fmaxf(bbox.min.y, entry->bbox.min.y));
+            bbox.max = MakeV2(fminf(bbox.max.x, entry->bbox.max.x), fminf(bbox.max.y, entry->bbox.max.y));
+        }
+        entry->hasBBox = 1;
+        entry->bbox = bbox;
+        entry->slot = 0;
+    }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderContextInternal->drawRectProgram.ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STREAM_DRAW);
+    clipRects->count++;
 
-    glUseProgram(renderContextInternal->drawRectProgram.program);
-    GLM3 MVP = MakeGLM3FromT2(DotT2(rc->projection, rc->camera));
-    glUniformMatrix3fv(renderContextInternal->drawRectProgram.MVPLocation, 1, GL_FALSE, MVP.m);
+    if (entry->isRotated) {
+        DrawClipRectStencil(rc, GL_INCR);
+    }
+}
 
-    glBindVertexArray(renderContextInternal->drawRectProgram.vao);
+extern void PopClipRect(RenderContext *rc) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return;
+    }
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    RenderContextInternal *renderContextInternal = rc->internal;
+    ClipRectStack *clipRects = &renderContextInternal->clipRects;
+    assert(clipRects->count > 0);
 
-    rc->drawCallCount++;
-}
\ No newline at end of file
+    if (clipRects->entries[clipRects->count - 1].isRotated) {
+        DrawClipRectStencil(rc, GL_DECR);
+    }
+
+    clipRects->count--;
+}
+
+// Return the mesh of path cached under key, tessellating it into the least recently used slot if missing.
+// style is NULL for fills.
+static const PathMesh *FindPathMesh(RenderContext *rc, uint64_t key, const Path *path, const StrokeStyle *style,
+                                    F tolerance) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+    int frameIndex = renderContextInternal->gpuTimer.frameIndex;
+
+    PathMeshCacheEntry *victim = NULL;
+    for (int i = 0; i < PATH_MESH_CACHE_PROBES; ++i) {
+        PathMeshCacheEntry *entry = &renderContextInternal->pathMeshCache[(key + i) % PATH_MESH_CACHE_SIZE];
+        if (entry->key == key) {
+            entry->lastUsedFrame = frameIndex;
+            return &entry->mesh;
+        }
+
+        // Prefer empty slots, then the least recently used
+        if (victim == NULL ||
+            (victim->key != 0 && (entry->key == 0 || entry->lastUsedFrame < victim->lastUsedFrame))) {
+            victim = entry;
+        }
+    }
+
+    // The vertex and index buffers of the evicted mesh are reused
+    victim->key = key;
+    victim->lastUsedFrame = frameIndex;
+    if (style) {
+        TessellatePathStroke(path, style, tolerance, &victim->mesh);
+    } else {
+        TessellatePathFill(path, tolerance, &victim->mesh);
+    }
+    rc->pathTessellationCount++;
+
+    return &victim->mesh;
+}
+
+static void DrawPath(RenderContext *rc, T2 transform, const Path *path, const StrokeStyle *style, V4 color) {
+    if (path->commandCount == 0 || color.a <= 0.0f) {
+        return;
+    }
+
+    // Tessellate at the next power of two of the pixels per path unit, so the mesh stays within tolerance while it is
+    // moved, rotated or scaled down, and is only redone when the scale crosses a power of two
+    V2 scale = GetT2Scale(DotT2(rc->camera, transform));
+    F pixelScale = fmaxf(scale.x, scale.y) * rc->pointToPixel;
+    if (pixelScale <= 0.0f) {
+        return;
+    }
+    int level = (int) ClampF(CeilF(log2f(pixelScale)), -32.0f, 32.0f);
+    F tolerance = PATH_TOLERANCE / exp2f((F) level);
+
+    uint64_t key = path->hash;
+    if (style) {
+        key = HashBytes(key, &style->width, sizeof(style->width));
+        key = HashBytes(key, &style->join, sizeof(style->join));
+        key = HashBytes(key, &style->cap, sizeof(style->cap));
+        key = HashBytes(key, &style->miterLimit, sizeof(style->miterLimit));
+    }
+    key = HashBytes(key, &level, sizeof(level));
+    if (key == 0) {
+        key = 1;
+    }
+
+    const PathMesh *mesh = FindPathMesh(rc, key, path, style, tolerance);
+    if (mesh->indexCount == 0) {
+        return;
+    }
+
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        RenderContextInternal *renderContextInternal = rc->internal;
+        if (mesh->vertexCount > renderContextInternal->softwarePathVertexCapacity) {
+            renderContextInternal->softwarePathVertexCapacity = mesh->vertexCount;
+            renderContextInternal->softwarePathVertices = realloc(renderContextInternal->softwarePathVertices,
+                                                                  sizeof(V2) * mesh->vertexCount);
+        }
+
+        T2 toPixel = GetSoftwarePixelTransform(rc, transform);
+        for (int i = 0; i < mesh->vertexCount; ++i) {
+            renderContextInternal->softwarePathVertices[i] = ApplyT2(toPixel, mesh->vertices[i]);
+        }
+        PushSoftwareTriangles(renderContextInternal->softwareRenderer, renderContextInternal->softwarePathVertices,
+                              mesh->indices, mesh->indexCount, color);
+        rc->spriteCount++;
+        return;
+    }
+    if (mesh->vertexCount > SPRITE_BATCH_MAX_VERTICES || mesh->indexCount > SPRITE_BATCH_MAX_INDICES) {
+        printf("Path of %d vertices is too large to draw\n", mesh->vertexCount);
+        return;
+    }
+
+    // Triangles of a stroke overlap at joins and caps. They all get the depth of the path, so when translucent, depth
+    // writes make the overlapping fragments fail the depth test instead of blending twice. Other sprites have depths
+    // of their own, so sharing the command with them doesn't hide any of them.
+    int isOpaque = color.a >= 1.0f;
+    SpriteBatchReservation r = ReserveSpriteBatch(rc, NULL, isOpaque, mesh->vertexCount, mesh->indexCount);
+    if (style) {
+        r.command->isDepthWritten = 1;
+    }
+    rc->spriteCount++;
+
+    DrawSpriteVertexAttrib vertex;
+    SetSpriteVertex(&vertex, ZeroV2(), ZeroV2(), color, ZeroV2(), ZeroV2(), ZeroV4(), SPRITE_KIND_SOLID, 0, r.depth, r.clip);
+    for (int i = 0; i < mesh->vertexCount; ++i) {
+        V2 pos = ApplyT2(transform, mesh->vertices[i]);
+        vertex.pos[0] = pos.x;
+        vertex.pos[1] = pos.y;
+        r.vertices[i] = vertex;
+    }
+
+    for (int i = 0; i < mesh->indexCount; ++i) {
+        r.indices[i] = (GLushort) (r.baseVertex + mesh->indices[i]);
+    }
+}
+
+extern void DrawPathFill(RenderContext *rc, T2 transform, const Path *path, V4 color) {
+    DrawPath(rc, transform, path, NULL, color);
+}
+
+extern void DrawPathStroke(RenderContext *rc, T2 transform, const Path *path, const StrokeStyle *style, V4 color) {
+    DrawPath(rc, transform, path, style, color);
+}
+
+extern LightOccluder *CreateLightOccluder(RenderContext *rc) {
+    LightOccluder *occluder = malloc(sizeof(LightOccluder));
+    occluder->vertexCount = 0;
+    occluder->bbox = MakeBBox2(ZeroV2(), ZeroV2());
+    occluder->internal = NULL;
+
+    // Lights are not drawn by the software backend, only the polygon bounds are kept
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return occluder;
+    }
+
+    LightOccluderInternal *occluderInternal = malloc(sizeof(LightOccluderInternal));
+    occluderInternal->shadowVertexCount = 0;
+    occluder->internal = occluderInternal;
+
+    glGenVertexArrays(1, &occluderInternal->vao);
+    glGenBuffers(1, &occluderInternal->vbo);
+
+    glBindVertexArray(occluderInternal->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, occluderInternal->vbo);
+    glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(F) * 3, (void *) 0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    return occluder;
+}
+
+extern void DestroyLightOccluder(RenderContext *rc, LightOccluder **ptr) {
+    LightOccluder *occluder = *ptr;
+    LightOccluderInternal *occluderInternal = occluder->internal;
+
+    if (occluderInternal) {
+        glDeleteVertexArrays(1, &occluderInternal->vao);
+        glDeleteBuffers(1, &occluderInternal->vbo);
+        free(occluderInternal);
+    }
+
+    free(occluder);
+
+    *ptr = NULL;
+}
+
+extern void UploadLightOccluder(RenderContext *rc, LightOccluder *occluder, const V2 *vertices, int count) {
+    occluder->vertexCount = count;
+    occluder->bbox = MakeBBox2(ZeroV2(), ZeroV2());
+    if (count > 0) {
+        occluder->bbox = MakeBBox2(vertices[0], vertices[0]);
+        for (int i = 1; i < count; ++i) {
+            occluder->bbox.min = MakeV2(fminf(occluder->bbox.min.x, vertices[i].x), fminf(occluder->bbox.min.y, vertices[i].y));
+            occluder->bbox.max = MakeV2(fmaxf(occluder->bbox.max.x, vertices[i].x), fmaxf(occluder->bbox.max.y, vertices[i].y));
+        }
+    }
+
+    LightOccluderInternal *occluderInternal = occluder->internal;
+    if (!occluderInternal) {
+        return;
+    }
+
+    // For each edge a, b: a quad between the edge (w = 1) and its extrusion to infinity (w = 0)
+    int shadowVertexCount = count >= 2 ? count * 6 : 0;
+    F *shadowVertices = malloc(sizeof(F) * 3 * (shadowVertexCount > 0 ? shadowVertexCount : 1));
+    F *v = shadowVertices;
+    for (int i = 0; i < count && shadowVertexCount > 0; ++i) {
+        V2 a = vertices[i];
+        V2 b = vertices[(i + 1) % count];
+        F quad[6][3] = {
+            {a.x, a.y, 1.0f}, {b.x, b.y, 1.0f}, {b.x, b.y, 0.0f},
+            {a.x, a.y, 1.0f}, {b.x, b.y, 0.0f}, {a.x, a.y, 0.0f},
+        };
+        memcpy(v, quad, sizeof(quad));
+        v += 18;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, occluderInternal->vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (sizeof(F) * 3 * shadowVertexCount), shadowVertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    occluderInternal->shadowVertexCount = shadowVertexCount;
+
+    free(shadowVertices);
+}
+
+static int IsLightNearOccluder(const PointLight *light, const LightOccluder *occluder) {
+    return occluder->vertexCount >= 2 &&
+           light->position.x + light->radius > occluder->bbox.min.x &&
+           light->position.x - light->radius < occluder->bbox.max.x &&
+           light->position.y + light->radius > occluder->bbox.min.y &&
+           light->position.y - light->radius < occluder->bbox.max.y;
+}
+
+// Point the instance attributes at lights[first] of the instance buffer
+static void SetDrawLightInstanceAttribs(int first) {
+    GLintptr offset = (GLintptr) sizeof(PointLight) * first;
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(PointLight),
+                          (void *) (offset + offsetof(PointLight, position)));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(PointLight),
+                          (void *) (offset + offsetof(PointLight, radius)));
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(PointLight),
+                          (void *) (offset + offsetof(PointLight, color)));
+}
+
+static void RestoreBlendFunc(RenderContext *rc) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    if (renderContextInternal->debugMode == RENDER_DEBUG_MODE_OVERDRAW) {
+        glBlendFunc(GL_ONE, GL_ONE);
+    } else {
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    }
+}
+
+extern void DrawLights(RenderContext *rc, V4 ambient, const PointLight *lights, int lightCount,
+                       LightOccluder *const *occluders, int occluderCount) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return;
+    }
+
+    RenderContextInternal *renderContextInternal = rc->internal;
+    DrawLightProgram *drawLightProgram = &renderContextInternal->drawLightProgram;
+    DrawShadowProgram *drawShadowProgram = &renderContextInternal->drawShadowProgram;
+
+    BreakSpriteBatch(rc, BATCH_BREAK_PROGRAM);
+
+    // Ambient is the light left where no light reaches, alpha is unused by the multiply in CompositeLighting
+    GLsizei viewWidth = (GLsizei) CeilF(rc->width * rc->pointToPixel);
+    GLsizei viewHeight = (GLsizei) CeilF(rc->height * rc->pointToPixel);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, viewWidth, viewHeight);
+    glClearColor(ambient.x, ambient.y, ambient.z, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glDisable(GL_SCISSOR_TEST);
+
+    if (lightCount <= 0) {
+        return;
+    }
+
+    // Lights without any occluder in their radius first, so they go in one draw call
+    if (lightCount > renderContextInternal->lightScratchCapacity) {
+        renderContextInternal->lightScratchCapacity = lightCount;
+        renderContextInternal->lightScratch = realloc(renderContextInternal->lightScratch,
+                                                      sizeof(PointLight) * lightCount);
+    }
+    PointLight *sorted = renderContextInternal->lightScratch;
+    int unshadowedCount = 0;
+    int shadowedIndex = lightCount;
+    for (int i = 0; i < lightCount; ++i) {
+        int isShadowed = 0;
+        for (int j = 0; j < occluderCount && !isShadowed; ++j) {
+            isShadowed = IsLightNearOccluder(&lights[i], occluders[j]);
+        }
+        if (isShadowed) {
+            sorted[--shadowedIndex] = lights[i];
+        } else {
+            sorted[unshadowedCount++] = lights[i];
+        }
+    }
+
+    GLsizeiptr instanceVboSize = (GLsizeiptr) sizeof(PointLight) * lightCount;
+    glBindVertexArray(drawLightProgram->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, drawLightProgram->instanceVbo);
+    if (instanceVboSize > drawLightProgram->instanceVboSize) {
+        drawLightProgram->instanceVboSize = instanceVboSize;
+    }
+    // Orphan the previous storage to avoid waiting on draws still using it
+    glBufferData(GL_ARRAY_BUFFER, drawLightProgram->instanceVboSize, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instanceVboSize, sorted);
+
+    BindViewConstants(rc, GetViewConstantsSlot(rc));
+
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    if (unshadowedCount > 0) {
+        glUseProgram(drawLightProgram->program);
+        SetDrawLightInstanceAttribs(0);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, unshadowedCount);
+        CountDrawCall(rc, RENDER_PROGRAM_DrawLight);
+    }
+
+    // Each shadowed light masks out the shadows of its occluders in the stencil buffer, then draws where it is 0
+    if (unshadowedCount < lightCount) {
+        glEnable(GL_STENCIL_TEST);
+    }
+    for (int i = unshadowedCount; i < lightCount; ++i) {
+        const PointLight *light = &sorted[i];
+
+        glClear(GL_STENCIL_BUFFER_BIT);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glStencilFunc(GL_ALWAYS, 1, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+        glUseProgram(drawShadowProgram->program);
+        glUniform2f(drawShadowProgram->lightPosLocation, light->position.x, light->position.y);
+        for (int j = 0; j < occluderCount; ++j) {
+            LightOccluderInternal *occluderInternal = occluders[j]->internal;
+            if (!IsLightNearOccluder(light, occluders[j]) || occluderInternal->shadowVertexCount <= 0) {
+                continue;
+            }
+            glBindVertexArray(occluderInternal->vao);
+            glDrawArrays(GL_TRIANGLES, 0, occluderInternal->shadowVertexCount);
+            CountDrawCall(rc, RENDER_PROGRAM_DrawShadow);
+        }
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glStencilFunc(GL_EQUAL, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+        glUseProgram(drawLightProgram->program);
+        glBindVertexArray(drawLightProgram->vao);
+        glBindBuffer(GL_ARRAY_BUFFER, drawLightProgram->instanceVbo);
+        SetDrawLightInstanceAttribs(i);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, 1);
+        CountDrawCall(rc, RENDER_PROGRAM_DrawLight);
+    }
+    glDisable(GL_STENCIL_TEST);
+
+    glBindVertexArray(0);
+    RestoreBlendFunc(rc);
+
+    rc->lightCount += lightCount;
+    rc->shadowedLightCount += lightCount - unshadowedCount;
+}
+
+extern void CompositeLighting(RenderContext *rc, RenderTarget *lightTarget) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    // Lighting would hide the overdraw counts
+    if (rc->backend == RENDER_BACKEND_SOFTWARE || !lightTarget ||
+        renderContextInternal->debugMode == RENDER_DEBUG_MODE_OVERDRAW) {
+        return;
+    }
+
+    BreakSpriteBatch(rc, BATCH_BREAK_PROGRAM);
+
+    // dst * light, the light target is opaque so the sprite shader outputs it as is
+    glBlendFunc(GL_DST_COLOR, GL_ZERO);
+    DrawRenderTargetStretched(rc, lightTarget);
+    FlushSpriteBatch(rc);
+    RestoreBlendFunc(rc);
+}
+
+extern ColorLUT *CreateColorLUT(RenderContext *rc, const unsigned char *data, int size) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        printf("Color LUTs are not supported by the software renderer\n");
+        return NULL;
+    }
+
+    ColorLUT *lut = malloc(sizeof(ColorLUT));
+    ColorLUTInternal *lutInternal = malloc(sizeof(ColorLUTInternal));
+    lut->size = size;
+    lut->internal = lutInternal;
+
+    // Slices along blue are side by side in data, so a row of data spans every slice
+    glGenTextures(1, &lutInternal->id);
+    glBindTexture(GL_TEXTURE_3D, lutInternal->id);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_SRGB8_ALPHA8, size, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, size * size);
+    for (int b = 0; b < size; ++b) {
+        glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, b, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, data + b * size * 4);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    return lut;
+}
+
+extern void DestroyColorLUT(RenderContext *rc, ColorLUT **ptr) {
+    ColorLUT *lut = *ptr;
+    ColorLUTInternal *lutInternal = lut->internal;
+
+    glDeleteTextures(1, &lutInternal->id);
+
+    free(lutInternal);
+    free(lut);
+
+    *ptr = NULL;
+}
+
+// Texture coordinates of the view of target, clamped half a texel inside so bilinear taps never read past it
+static void SetPostSourceUniforms(RenderTarget *target, GLint texCoordScaleLocation, GLint texelSizeLocation,
+                                  GLint maxTexCoordLocation) {
+    glUniform2f(texCoordScaleLocation, (F) target->viewWidth / target->width, (F) target->viewHeight / target->height);
+    glUniform2f(texelSizeLocation, 1.0f / target->width, 1.0f / target->height);
+    glUniform2f(maxTexCoordLocation, (target->viewWidth - 0.5f) / target->width,
+                (target->viewHeight - 0.5f) / target->height);
+}
+
+// Draw one triangle over the current view with blending off, extra sources are bound to unit 1 by the caller
+static void DrawPostPass(RenderContext *rc, const DrawPostProgram *drawPostProgram, RenderProgramKind kind,
+                         RenderTarget *source, V4 params) {
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, GetGLTexture2D(source->texture->internal));
+
+    glUseProgram(drawPostProgram->program);
+    SetPostSourceUniforms(source, drawPostProgram->texCoordScaleLocation, drawPostProgram->texelSizeLocation,
+                          drawPostProgram->maxTexCoordLocation);
+    glUniform4f(drawPostProgram->paramsLocation, params.x, params.y, params.z, params.w);
+
+    glDisable(GL_BLEND);
+    glBindVertexArray(renderContextInternal->postVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_BLEND);
+
+    CountDrawCall(rc, kind);
+}
+
+extern void DrawBloomDownsample(RenderContext *rc, RenderTarget *source, F threshold, F knee) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return;
+    }
+
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    BreakSpriteBatch(rc, BATCH_BREAK_PROGRAM);
+    DrawPostPass(rc, &renderContextInternal->postDownsampleProgram, RENDER_PROGRAM_PostDownsample, source,
+                 MakeV4(threshold, knee, 0.0f, 0.0f));
+}
+
+extern void DrawBloomUpsample(RenderContext *rc, RenderTarget *source, RenderTarget *bloom, F intensity) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return;
+    }
+
+    RenderContextInternal *renderContextInternal = rc->internal;
+    DrawPostProgram *drawPostProgram = &renderContextInternal->postUpsampleProgram;
+
+    BreakSpriteBatch(rc, BATCH_BREAK_PROGRAM);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, GetGLTexture2D(bloom->texture->internal));
+    glUseProgram(drawPostProgram->program);
+    SetPostSourceUniforms(bloom, drawPostProgram->bloomTexCoordScaleLocation, drawPostProgram->bloomTexelSizeLocation,
+                          drawPostProgram->bloomMaxTexCoordLocation);
+
+    DrawPostPass(rc, drawPostProgram, RENDER_PROGRAM_PostUpsample, source, MakeV4(intensity, 0.0f, 0.0f, 0.0f));
+}
+
+extern void DrawColorGrading(RenderContext *rc, RenderTarget *source, ColorLUT *lut, F strength) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE || !lut) {
+        return;
+    }
+
+    RenderContextInternal *renderContextInternal = rc->internal;
+    ColorLUTInternal *lutInternal = lut->internal;
+
+    BreakSpriteBatch(rc, BATCH_BREAK_PROGRAM);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, lutInternal->id);
+
+    DrawPostPass(rc, &renderContextInternal->postGradeProgram, RENDER_PROGRAM_PostGrade, source,
+                 MakeV4(strength, (F) lut->size, 0.0f, 0.0f));
+}
+
+extern void DrawVignette(RenderContext *rc, RenderTarget *source, F intensity, F radius, F softness) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        return;
+    }
+
+    RenderContextInternal *renderContextInternal = rc->internal;
+
+    BreakSpriteBatch(rc, BATCH_BREAK_PROGRAM);
+    DrawPostPass(rc, &renderContextInternal->postVignetteProgram, RENDER_PROGRAM_PostVignette, source,
+                 MakeV4(intensity, radius, softness, (F) source->viewWidth / source->viewHeight));
+}
+
+extern FrameReadback *CreateFrameReadback(RenderContext *rc, int capacity) {
+    if (rc->backend == RENDER_BACKEND_SOFTWARE) {
+        printf("Frame readback is not supported by the software renderer, use GetSoftwareFramebuffer\n");
+        return NULL;
+    }
+
+    assert(capacity > 0);
+
+    FrameReadback *readback = malloc(sizeof(FrameReadback));
+    FrameReadbackInternal *readbackInternal = malloc(sizeof(FrameReadbackInternal));
+    readback->pendingCount = 0;
+    readback->capacity = capacity;
+    readback->internal = readbackInternal;
+
+    readbackInternal->first = 0;
+    readbackInternal->slots = calloc((size_t) capacity, sizeof(FrameReadbackSlot));
+    for (int i = 0; i < capacity; ++i) {
+        glGenBuffers(1, &readbackInternal->slots[i].pbo);
+    }
+
+    return readback;
+}
+
+extern void DestroyFrameReadback(RenderContext *rc, FrameReadback **ptr) {
+    FrameReadback *readback = *ptr;
+    FrameReadbackInternal *readbackInternal = readback->internal;
+
+    for (int i = 0; i < readback->capacity; ++i) {
+        FrameReadbackSlot *slot = &readbackInternal->slots[i];
+        if (slot->fence) {
+            glDeleteSync(slot->fence);
+        }
+        glDeleteBuffers(1, &slot->pbo);
+    }
+
+    free(readbackInternal->slots);
+    free(readbackInternal);
+    free(readback);
+
+    *ptr = NULL;
+}
+
+extern int QueueFrameReadback(RenderContext *rc, FrameReadback *readback) {
+    FrameReadbackInternal *readbackInternal = readback->internal;
+
+    if (readback->pendingCount >= readback->capacity) {
+        return 0;
+    }
+
+    FrameReadbackSlot *slot = &readbackInternal->slots[(readbackInternal->first + readback->pendingCount) % readback->capacity];
+    slot->width = (int) (rc->width * rc->pointToPixel);
+    slot->height = (int) (rc->height * rc->pointToPixel);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    GLsizeiptr size = (GLsizeiptr) slot->width * slot->height * 4;
+    if (size > slot->pboSize) {
+        slot->pboSize = size;
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    }
+
+    // Into the buffer, so glReadPixels returns without waiting for the frame to be drawn
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, slot->width, slot->height, GL_RGBA, GL_UNSIGNED_BYTE, (void *) 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback->pendingCount++;
+
+    return 1;
+}
+
+static FrameReadbackSlot *GetReadyFrameReadbackSlot(FrameReadback *readback) {
+    FrameReadbackInternal *readbackInternal = readback->internal;
+
+    if (readback->pendingCount == 0) {
+        return NULL;
+    }
+
+    // A timeout of 0 only checks the fence, flushing makes sure it is signaled eventually
+    FrameReadbackSlot *slot = &readbackInternal->slots[readbackInternal->first];
+    GLenum status = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return NULL;
+    }
+
+    return slot;
+}
+
+extern int PeekFrameReadbackSize(RenderContext *rc, FrameReadback *readback, int *width, int *height) {
+    FrameReadbackSlot *slot = GetReadyFrameReadbackSlot(readback);
+    if (slot == NULL) {
+        return 0;
+    }
+
+    *width = slot->width;
+    *height = slot->height;
+    return 1;
+}
+
+extern int PollFrameReadback(RenderContext *rc, FrameReadback *readback, unsigned char *pixels) {
+    FrameReadbackInternal *readbackInternal = readback->internal;
+
+    FrameReadbackSlot *slot = GetReadyFrameReadbackSlot(readback);
+    if (slot == NULL) {
+        return 0;
+    }
+
+    if (pixels) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+        size_t rowSize = (size_t) slot->width * 4;
+        const unsigned char *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) rowSize * slot->height,
+                                                       GL_MAP_READ_BIT);
+        if (mapped) {
+            // GL rows start from the bottom
+            for (int y = 0; y < slot->height; ++y) {
+                memcpy(pixels + rowSize * y, mapped + rowSize * (slot->height - 1 - y), rowSize);
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    glDeleteSync(slot->fence);
+    slot->fence = NULL;
+    readbackInternal->first = (readbackInternal->first + 1) % readback->capacity;
+    readback->pendingCount--;
+
+    return 1;
+}
@@ -1,17 +1,140 @@
 #ifndef RTD_RENDERER_H
 #define RTD_RENDERER_H
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "cgmath.h"
 #include "image.h"
+#include "path.h"
+
+typedef enum RenderProgramKind {
+    RENDER_PROGRAM_DrawTexture,
+    RENDER_PROGRAM_DrawSprite,
+    RENDER_PROGRAM_DrawParticle,
+    RENDER_PROGRAM_DrawLight,
+    RENDER_PROGRAM_DrawShadow,
+    RENDER_PROGRAM_PostDownsample,
+    RENDER_PROGRAM_PostUpsample,
+    RENDER_PROGRAM_PostGrade,
+    RENDER_PROGRAM_PostVignette,
+    RENDER_PROGRAM_DrawRepeated,
+    // Every material, see CreateMaterial
+    RENDER_PROGRAM_Material,
+
+    RENDER_PROGRAM_COUNT,
+} RenderProgramKind;
+
+#define MAX_RENDER_PASSES 16
+#define MAX_RENDER_LAYERS 8
+
+// Must match RENDER_DEBUG_MODE_* in fragment shaders
+typedef enum RenderDebugMode {
+    RENDER_DEBUG_MODE_NONE,
+    // Each fragment adds a constant, the sum is colorized into a heatmap by EndDrawing
+    RENDER_DEBUG_MODE_OVERDRAW,
+    // Each draw call gets its own color
+    RENDER_DEBUG_MODE_BATCH_ID,
+
+    RENDER_DEBUG_MODE_COUNT,
+} RenderDebugMode;
+
+// Why a draw call had to end before the next sprite
+typedef enum BatchBreakReason {
+    BATCH_BREAK_TEXTURE,
+    BATCH_BREAK_VIEW,
+    // A compatible command exists but translucent sprites queued after it must be drawn first
+    BATCH_BREAK_ORDER,
+    // A static mesh or particles were drawn in between
+    BATCH_BREAK_PROGRAM,
+    // Another material, or the same material with other parameters
+    BATCH_BREAK_MATERIAL,
+    BATCH_BREAK_TARGET,
+    BATCH_BREAK_PASS,
+    // Depth ran out and was reset
+    BATCH_BREAK_DEPTH,
+    BATCH_BREAK_FULL,
+    // Clip rects ran out of slots, or a rotated clip was pushed or popped
+    BATCH_BREAK_CLIP,
+    // Draws of another layer are timed separately, see SetRenderLayer
+    BATCH_BREAK_LAYER,
+
+    BATCH_BREAK_REASON_COUNT,
+} BatchBreakReason;
+
+#define MAX_BATCH_BREAK_LOG_ENTRIES 64
+
+typedef struct BatchBreak {
+    BatchBreakReason reason;
+    // Sprites queued in the frame before the break
+    int spriteIndex;
+} BatchBreak;
+
+typedef struct BatchBreakLog {
+    int counts[BATCH_BREAK_REASON_COUNT];
+    // Can be larger than MAX_BATCH_BREAK_LOG_ENTRIES, only the first breaks are kept
+    int entryCount;
+    BatchBreak entries[MAX_BATCH_BREAK_LOG_ENTRIES];
+} BatchBreakLog;
+
+typedef struct RenderLayerTiming {
+    const char *name;
+    float gpuMs;
+} RenderLayerTiming;
+
+typedef struct RenderPassTiming {
+    const char *name;
+    // -1 if the frame ran out of timer queries before the pass began
+    float gpuMs;
+    float programGPUMs[RENDER_PROGRAM_COUNT];
+    int drawCallCount;
+    // In order of first draw, layers past MAX_RENDER_LAYERS are not reported
+    int layerCount;
+    RenderLayerTiming layers[MAX_RENDER_LAYERS];
+} RenderPassTiming;
+
+// GPU timings of one frame. They are read back a few frames later to never stall on the GPU
+typedef struct RenderTimings {
+    int frameIndex;
+    float gpuMs;
+    // Fragments that passed the depth test, i.e. were shaded and blended, over the frame
+    uint64_t fragmentCount;
+    int passCount;
+    RenderPassTiming passes[MAX_RENDER_PASSES];
+    // Frames whose queries were not available in time and were discarded
+    int droppedFrameCount;
+} RenderTimings;
+
+typedef enum RenderBackend {
+    RENDER_BACKEND_GL,
+    // Rasterized on CPU into memory, see CreateSoftwareRenderContext
+    RENDER_BACKEND_SOFTWARE,
+} RenderBackend;
 
 typedef struct RenderContext {
+    RenderBackend backend;
     float width;
     float height;
     float pointToPixel;
     float pixelToPoint;
     int drawCallCount;
+    // Sprites queued since ClearDrawing, and the vertex and index data streamed to GPU for them
+    int spriteCount;
+    int spriteUploadBytes;
+    float spriteUploadMs;
+    // Transparent pixels skipped by drawing the alpha hull of textures instead of their quad
+    float spriteTrimmedPixels;
+    // Paths tessellated since ClearDrawing because their mesh was not cached
+    int pathTessellationCount;
+    // Lights drawn by DrawLights since ClearDrawing, and those drawn one by one because an occluder is in their radius
+    int lightCount;
+    int shadowedLightCount;
+    // Flushes caused by PushClipRect and PopClipRect since ClearDrawing, see PushClipRect
+    int clipFlushCount;
+    // Draw opaque sprites first with depth writes, see SpriteBatch in renderer.c. Enabled by default.
+    int isOpaquePassEnabled;
+    // Applied from the next ClearDrawing
+    RenderDebugMode debugMode;
     T2 projection;
     T2 camera;
     void *internal;
@@ -22,36 +145,269 @@ typedef struct Texture {
     int height;         // Texture width in pixels
     int actualWidth;    // Texture width with padding in pixels
     int actualHeight;   // Texture height with padding in pixels
+    int isOpaque;       // Every pixel has full alpha. Detected at creation, can be overridden.
+    // Drawn instead of the whole quad when it is inside the source rect. Only computed by CreateTextureFromImage.
+    AlphaHull alphaHull;
     void *internal;
 } Texture;
 
+typedef enum TextureFilter {
+    TEXTURE_FILTER_NEAREST,
+    TEXTURE_FILTER_LINEAR,
+} TextureFilter;
+
+// Offscreen color buffer
+typedef struct RenderTarget {
+    int width;          // in pixels
+    int height;         // in pixels
+    int viewWidth;      // Pixels drawn by the last BeginRenderTarget, starting from bottom left
+    int viewHeight;     // Pixels drawn by the last BeginRenderTarget, starting from bottom left
+    Texture *texture;   // Color buffer, can be drawn with DrawTexture once the target is unbound
+    void *internal;
+} RenderTarget;
+
+// Vertex data uploaded once and kept on GPU until it is uploaded again
+typedef struct StaticMesh {
+    int vertexCount;
+    int indexCount;
+    void *internal;
+} StaticMesh;
+
+// Structure of arrays of particle instances, each array has count elements
+typedef struct ParticleInstances {
+    int count;
+    // Center in world point space
+    const F *posX;
+    const F *posY;
+    // Width and height in point space
+    const F *size;
+    const F *colorR;
+    const F *colorG;
+    const F *colorB;
+    const F *colorA;
+} ParticleInstances;
+
+// Light drawn by DrawLights, 28 bytes
+typedef struct PointLight {
+    // Center in world point space
+    V2 position;
+    F radius;
+    // Straight alpha, alpha scales the intensity
+    V4 color;
+} PointLight;
+
+// Closed polygon blocking lights. Its shadow geometry is kept on GPU until it is uploaded again, lights only change a
+// uniform when they are drawn against it.
+typedef struct LightOccluder {
+    int vertexCount;
+    // Of the polygon in world point space
+    BBox2 bbox;
+    void *internal;
+} LightOccluder;
+
+// 3D color lookup table of DrawColorGrading
+typedef struct ColorLUT {
+    int size;
+    void *internal;
+} ColorLUT;
+
+// Copies of the window read back without waiting for the GPU, see QueueFrameReadback
+typedef struct FrameReadback {
+    // Copies queued and not yet collected by PollFrameReadback
+    int pendingCount;
+    int capacity;
+    void *internal;
+} FrameReadback;
+
 typedef struct Font {
     const char *name;
     void *internal;
 } Font;
 
-extern RenderContext *CreateRenderContext(int width, int height, float pointToPixel);
+#define MAX_MATERIAL_PARAMS 4
+
+// Fragment shader drawing sprites in place of the built-in one, with a block of parameters. Sprites of a material
+// are batched like the others, so only a change of material or parameters costs a draw call.
+typedef struct Material {
+    const char *name;
+    // The shader keeps the alpha of opaque textures, so their sprites can go in the opaque pass
+    int isOpaque;
+    // uniform vec4 params[MAX_MATERIAL_PARAMS] of the shader, read when a sprite is drawn
+    V4 params[MAX_MATERIAL_PARAMS];
+    void *internal;
+} Material;
+
+// Compiled programs are cached in programCacheDir, which must end with a path separator. Pass NULL to disable the cache.
+// The path is copied, so it can be freed once the render context is created.
+extern RenderContext *CreateRenderContext(int width, int height, float pointToPixel, const char *programCacheDir);
+// Render without GL or a window, one point per pixel, e.g. for thumbnails. Frames are rasterized by EndDrawing on
+// threadCount threads, 0 for one per CPU. Render targets, debug views and render passes are not supported.
+extern RenderContext *CreateSoftwareRenderContext(int width, int height, int threadCount);
+// sRGB RGBA pixels of the last frame finished by EndDrawing, top row first. NULL for GL contexts.
+extern const unsigned char *GetSoftwareFramebuffer(RenderContext *rc);
 
 extern void ClearDrawing(RenderContext *rc);
+// Finish the frame started by ClearDrawing
+extern void EndDrawing(RenderContext *rc);
+// Turn what was drawn into the window so far into the view of rc->debugMode, and draw normally for the rest of the
+// frame, e.g. for debug overlays. Called by EndDrawing if not called before.
+extern void ResolveRenderDebugView(RenderContext *rc);
+
+// Draw calls between Begin/EndRenderPass are timed on GPU and reported under name. Passes can't be nested.
+extern void BeginRenderPass(RenderContext *rc, const char *name);
+extern void EndRenderPass(RenderContext *rc);
+// Draw calls of the current pass are also reported under name until the next SetRenderLayer or EndRenderPass.
+// NULL stops reporting. Changing layer breaks the sprite batch.
+extern void SetRenderLayer(RenderContext *rc, const char *name);
+// Return the timings of the latest frame whose GPU timer queries have completed
+extern const RenderTimings *GetRenderTimings(RenderContext *rc);
+extern const char *GetRenderProgramName(RenderProgramKind program);
+// Return the batch breaks of the last finished frame
+extern const BatchBreakLog *GetBatchBreakLog(RenderContext *rc);
+extern const char *GetBatchBreakReasonName(BatchBreakReason reason);
 
 extern Texture *CreateTextureFromMemory(RenderContext *renderContext, const unsigned char *data, int width, int height, int stride, ImageChannel channel);
+// Also compute the alpha hull of the texture
+extern Texture *CreateTextureFromImage(RenderContext *renderContext, Image *image);
 extern void DestroyTexture(RenderContext *renderContext, Texture **texture);
 // dstBBox is in point space
 extern void DrawTexture(RenderContext *rc, T2 transform, BBox2 dstBBox,
                         Texture *tex, BBox2 srcBBox, V4 color);
 
+// fragmentSource gets the inputs of draw_sprite.vert and the ViewConstants block, see draw_sprite_glint.frag. NULL if
+// materials are not supported by rc. Exit if the shader fails to compile, like the built-in ones.
+extern Material *CreateMaterial(RenderContext *rc, const char *name, const char *fragmentSource, int isOpaque);
+extern void DestroyMaterial(RenderContext *rc, Material **material);
+// Like DrawTexture, with the shader of material. Debug views and a NULL material use the built-in shader instead.
+extern void DrawTextureWithMaterial(RenderContext *rc, T2 transform, BBox2 dstBBox, Texture *tex, BBox2 srcBBox,
+                                    V4 color, Material *material);
+
+extern RenderTarget *CreateRenderTarget(RenderContext *rc, int width, int height, TextureFilter filter);
+extern void DestroyRenderTarget(RenderContext *rc, RenderTarget **target);
+// Redirect drawing of a width x height points view into the bottom left of target, at pointToPixel pixels per
+// point, and clear it. The camera is reset to identity. Targets can't be nested.
+extern void BeginRenderTargetView(RenderContext *rc, RenderTarget *target, float width, float height, float pointToPixel);
+// Restore drawing into the window, including the camera set before BeginRenderTarget
+extern void EndRenderTarget(RenderContext *rc);
+// Draw the view of target centered in the window, scaled up by the largest integer factor that fits
+extern void DrawRenderTargetUpscaled(RenderContext *rc, RenderTarget *target);
+// Draw the view of target stretched over the whole window
+extern void DrawRenderTargetStretched(RenderContext *rc, RenderTarget *target);
+
+extern StaticMesh *CreateStaticMesh(RenderContext *rc);
+extern void DestroyStaticMesh(RenderContext *rc, StaticMesh **mesh);
+// Replace the content of mesh with count textured quads. dstBBoxes is in mesh local point space, srcBBoxes is in texture pixels
+extern void UploadStaticMeshQuads(RenderContext *rc, StaticMesh *mesh, Texture *tex,
+                                  const BBox2 *dstBBoxes, const BBox2 *srcBBoxes, int count);
+// Like UploadStaticMeshQuads, with quad i transformed by transforms[i] first. transforms may be NULL.
+extern void UploadStaticMeshTransformedQuads(RenderContext *rc, StaticMesh *mesh, Texture *tex, const T2 *transforms,
+                                             const BBox2 *dstBBoxes, const BBox2 *srcBBoxes, int count);
+extern void DrawStaticMesh(RenderContext *rc, T2 transform, StaticMesh *mesh, Texture *tex);
+
+// Fill the whole view with tex repeated every tileSize points, with a tile corner at origin in world space. Drawn as
+// one triangle covering the view whatever the number of tiles. The camera must not be rotated.
+extern void DrawTextureRepeated(RenderContext *rc, Texture *tex, V2 tileSize, V2 origin, V4 color);
+
+// Draw all instances with one instanced draw call
+extern void DrawParticles(RenderContext *rc, Texture *tex, const ParticleInstances *instances);
+
+// Glyphs are rasterized once into textures of renderContext, so the font must only be drawn with it
 extern Font *LoadFont(RenderContext *renderContext, const char *filename);
 extern float GetFontAscent(RenderContext *renderContext, Font *font, float size);
 extern float GetFontLineHeight(RenderContext *renderContext, Font *font, float size);
 // size, x, y is in point space
 extern void DrawLineText(RenderContext *rc, Font *font, float size, float x, float y, const char *text, V4 color);
 
+// Result of one vertex layout in BenchmarkSpriteUpload
+typedef struct SpriteUploadBenchmark {
+    const char *layout;
+    // Vertices and indices streamed per sprite
+    int bytesPerSprite;
+    // CPU time filling the vertices and indices of a sprite
+    float fillNsPerSprite;
+    // Of glBufferData, waited on with glFinish
+    float uploadMBPerSecond;
+} SpriteUploadBenchmark;
+
+#define SPRITE_UPLOAD_BENCHMARK_LAYOUT_COUNT 2
+
+// Fill and upload spriteCount quads repeatCount times, first with the 68 byte float vertices sprites used before they
+// were packed, then with the current layout. Nothing is drawn. Results are zero for the software renderer.
+extern void BenchmarkSpriteUpload(RenderContext *rc, int spriteCount, int repeatCount,
+                                  SpriteUploadBenchmark results[SPRITE_UPLOAD_BENCHMARK_LAYOUT_COUNT]);
+
 extern void DrawRect(RenderContext *rc, T2 transform, BBox2 bbox, F roundRadius, F thickness, V4 color, V4 borderColor);
 
+// Clip the sprites, text, rects and paths drawn until the matching PopClipRect to rect transformed by transform,
+// intersected with the clips pushed before. Clips that stay axis aligned in world space are applied per vertex and
+// don't break batches, but only apply to what is drawn as sprites. Rotated ones are drawn into the stencil buffer,
+// which clips everything but costs a flush on push and on pop.
+// The stack must be empty when the target changes and at the end of the frame. Ignored by the software renderer.
+extern void PushClipRect(RenderContext *rc, T2 transform, BBox2 rect);
+extern void PopClipRect(RenderContext *rc);
+
+// Paths are tessellated on first draw and cached by their content and the scale they are drawn at, so drawing the
+// same path again, even moved or rotated, is only a copy of its triangles. Edges are not anti-aliased.
+extern void DrawPathFill(RenderContext *rc, T2 transform, const Path *path, V4 color);
+// Translucent strokes blend once where joins and caps overlap, except on the software backend.
+extern void DrawPathStroke(RenderContext *rc, T2 transform, const Path *path, const StrokeStyle *style, V4 color);
+
+extern LightOccluder *CreateLightOccluder(RenderContext *rc);
+extern void DestroyLightOccluder(RenderContext *rc, LightOccluder **occluder);
+// Build the shadow geometry of the polygon, in world point space
+extern void UploadLightOccluder(RenderContext *rc, LightOccluder *occluder, const V2 *vertices, int count);
+// Clear the current target to ambient and add lights to it, normally into a low resolution target later passed to
+// CompositeLighting. Lights away from every occluder are drawn with one instanced draw call, the others one by one
+// after the shadows of the occluders in their radius are drawn into the stencil buffer.
+extern void DrawLights(RenderContext *rc, V4 ambient, const PointLight *lights, int lightCount,
+                       LightOccluder *const *occluders, int occluderCount);
+// Multiply what was drawn into the current view by the light accumulated in lightTarget, stretched over the view
+extern void CompositeLighting(RenderContext *rc, RenderTarget *lightTarget);
+
+// RGBA of size^3 texels indexed by sRGB color: size slices along blue laid out side by side, red along rows and green
+// along columns, so data is size * size texels wide and size texels high
+extern ColorLUT *CreateColorLUT(RenderContext *rc, const unsigned char *data, int size);
+extern void DestroyColorLUT(RenderContext *rc, ColorLUT **lut);
+
+// Full screen passes of a post-processing chain. Each one replaces the whole current view with the result of reading
+// the view of source, which must not be the current target.
+// Quarter the area of source keeping what is brighter than threshold, with a soft transition of knee around it
+extern void DrawBloomDownsample(RenderContext *rc, RenderTarget *source, F threshold, F knee);
+// source plus the smaller level bloom upsampled with a tent filter and scaled by intensity
+extern void DrawBloomUpsample(RenderContext *rc, RenderTarget *source, RenderTarget *bloom, F intensity);
+// Blend source with its color looked up in lut by strength
+extern void DrawColorGrading(RenderContext *rc, RenderTarget *source, ColorLUT *lut, F strength);
+// Darken source from radius to radius + softness away from the center, in heights of the view
+extern void DrawVignette(RenderContext *rc, RenderTarget *source, F intensity, F radius, F softness);
+
+// capacity is the number of frames that can be in flight, each one holds a pixel pack buffer of the window size
+extern FrameReadback *CreateFrameReadback(RenderContext *rc, int capacity);
+extern void DestroyFrameReadback(RenderContext *rc, FrameReadback **readback);
+// Start copying what was drawn into the window, after EndDrawing and before the buffers are swapped. Return 0 if
+// every buffer is still pending, in which case the frame is not captured.
+extern int QueueFrameReadback(RenderContext *rc, FrameReadback *readback);
+// Collect the oldest queued copy if the GPU is done with it, never waits. Pixels are RGBA, top row first, written
+// to pixels with width * 4 bytes per row, or discarded if pixels is NULL. Return 0 if no copy is ready. Check size
+// with PeekFrameReadbackSize first.
+extern int PollFrameReadback(RenderContext *rc, FrameReadback *readback, unsigned char *pixels);
+// Size of the oldest queued copy, 0 if none is ready
+extern int PeekFrameReadbackSize(RenderContext *rc, FrameReadback *readback, int *width, int *height);
+
+// Redirect drawing into the whole target, one point per pixel
+static inline void BeginRenderTarget(RenderContext *rc, RenderTarget *target) {
+    BeginRenderTargetView(rc, target, (float) target->width, (float) target->height, 1.0f);
+}
+
 static inline void SetCameraTransform(RenderContext *rc, T2 transform) {
     rc->camera = transform;
 }
 
+// Return the visible area of the viewport in the local space of transform
+static inline BBox2 GetViewBBox2(RenderContext *rc, T2 transform) {
+    T2 inv = InvertT2(DotT2(rc->camera, transform));
+    return TransformBBox2(inv, MakeBBox2(ZeroV2(), MakeV2(rc->width, rc->height)));
+}
+
 static inline BBox2 MakeBBox2FromTexture(Texture *tex) {
     if (!tex) {
         return ZeroBBox2();
@@ -61,10 +417,6 @@ static inline BBox2 MakeBBox2FromTexture(Texture *tex) {
     return result;
 }
 
-static inline Texture *CreateTextureFromImage(RenderContext *renderContext, Image *image) {
-    return CreateTextureFromMemory(renderContext, image->data, image->width, image->height, image->stride, image->channel);
-}
-
 static inline Texture *LoadTexture(RenderContext *renderContext, const char *filename) {
     Image *image = LoadImageFromFilename(filename);
 
@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec2 vOffset;
+in vec4 vColor;
+
+out vec4 fragColor;
+
+void main() {
+    // Falls off smoothly to 0 at the radius
+    float falloff = max(1 - dot(vOffset, vOffset), 0);
+    falloff *= falloff;
+    // Alpha is left at the ambient the target was cleared to, so lights only add color
+    fragColor = vec4(vColor.rgb * vColor.a * falloff, 0);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+#include "view_constants.glsl"
+
+// Per vertex
+layout (location = 0) in vec2 aCorner;
+// Per instance, one PointLight each
+layout (location = 1) in vec2 aPos;
+layout (location = 2) in float aRadius;
+layout (location = 3) in vec4 aColor;
+
+// Position relative to the light in radii
+out vec2 vOffset;
+out vec4 vColor;
+
+void main() {
+    vec2 pos = aPos + aCorner * aRadius;
+    gl_Position = vec4((viewProjection * vec3(pos, 1)).xy, 0, 1);
+    vOffset = aCorner;
+    vColor = aColor;
+}
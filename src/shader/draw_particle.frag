@@ -0,0 +1,29 @@
+#version 330 core
+
+// Must match RenderDebugMode in renderer.h
+#define RENDER_DEBUG_MODE_OVERDRAW 1
+#define RENDER_DEBUG_MODE_BATCH_ID 2
+
+uniform sampler2D texture0;
+uniform int debugMode;
+uniform vec4 debugColor;
+
+in vec2 vTexCoord;
+in vec4 vColor;
+
+out vec4 fragColor;
+
+void main() {
+    vec4 texColor = texture(texture0, vTexCoord);
+    // Pre-multiply alpha
+    texColor = vec4(texColor.rgb * texColor.a, texColor.a);
+    vec4 color = vec4(vColor.rgb * vColor.a, vColor.a);
+
+    fragColor = texColor * color;
+
+    if (debugMode == RENDER_DEBUG_MODE_OVERDRAW) {
+        fragColor = debugColor;
+    } else if (debugMode == RENDER_DEBUG_MODE_BATCH_ID) {
+        fragColor = debugColor * fragColor.a;
+    }
+}
@@ -0,0 +1,26 @@
+#version 330 core
+
+#include "view_constants.glsl"
+
+uniform vec2 texCoordScale;
+
+// Per vertex
+layout (location = 0) in vec2 aCorner;
+// Per instance, each attribute is sourced from its own array of the particle pool
+layout (location = 1) in float aPosX;
+layout (location = 2) in float aPosY;
+layout (location = 3) in float aSize;
+layout (location = 4) in float aColorR;
+layout (location = 5) in float aColorG;
+layout (location = 6) in float aColorB;
+layout (location = 7) in float aColorA;
+
+out vec2 vTexCoord;
+out vec4 vColor;
+
+void main() {
+    vec2 pos = vec2(aPosX, aPosY) + aCorner * aSize;
+    gl_Position = vec4(viewProjection * vec3(pos, 1), 1);
+    vTexCoord = (aCorner + vec2(0.5)) * texCoordScale;
+    vColor = vec4(aColorR, aColorG, aColorB, aColorA);
+}
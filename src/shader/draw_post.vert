@@ -0,0 +1,16 @@
+#version 330 core
+
+// View of the source over its texture
+uniform vec2 texCoordScale;
+
+// Position in the view of the source, in [0, 1]
+out vec2 vViewCoord;
+out vec2 vTexCoord;
+
+void main() {
+    // One triangle covering the whole view, no vertex buffer needed
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2 - 1, 0, 1);
+    vViewCoord = corner;
+    vTexCoord = corner * texCoordScale;
+}
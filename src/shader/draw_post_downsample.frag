@@ -0,0 +1,32 @@
+#version 330 core
+
+uniform sampler2D source;
+// Texel size of source
+uniform vec2 texelSize;
+// Clamp samples to the view of source, the rest of the texture is stale
+uniform vec2 maxTexCoord;
+// x: threshold, y: knee
+uniform vec4 params;
+
+in vec2 vTexCoord;
+
+out vec4 fragColor;
+
+vec4 Sample(vec2 offset) {
+    return texture(source, min(vTexCoord + offset * texelSize, maxTexCoord));
+}
+
+void main() {
+    // Each bilinear tap averages 2x2 texels, so the four taps cover 4x4 texels
+    vec4 color = (Sample(vec2(-1, -1)) + Sample(vec2(1, -1)) + Sample(vec2(-1, 1)) + Sample(vec2(1, 1))) * 0.25;
+
+    // Soft threshold on the brightest channel, a threshold of 0 keeps everything
+    float threshold = params.x;
+    float knee = params.y;
+    float brightness = max(color.r, max(color.g, color.b));
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4 * knee + 1e-4);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 1e-4);
+
+    fragColor = vec4(color.rgb * contribution, 1);
+}
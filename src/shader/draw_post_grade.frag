@@ -0,0 +1,26 @@
+#version 330 core
+
+uniform sampler2D source;
+uniform sampler3D lut;
+uniform vec2 maxTexCoord;
+// x: strength, y: size of the LUT
+uniform vec4 params;
+
+in vec2 vTexCoord;
+
+out vec4 fragColor;
+
+vec3 LinearToSRGB(vec3 color) {
+    return mix(color * 12.92, 1.055 * pow(color, vec3(1 / 2.4)) - 0.055, step(vec3(0.0031308), color));
+}
+
+void main() {
+    vec4 color = texture(source, min(vTexCoord, maxTexCoord));
+
+    // The LUT is indexed by sRGB color, sample at texel centers so the ends map to the first and last texels
+    float size = params.y;
+    vec3 index = LinearToSRGB(clamp(color.rgb, 0.0, 1.0));
+    vec3 graded = texture(lut, index * ((size - 1) / size) + 0.5 / size).rgb;
+
+    fragColor = vec4(mix(color.rgb, graded, params.x), color.a);
+}
@@ -0,0 +1,36 @@
+#version 330 core
+
+// Level of the same size as the target
+uniform sampler2D source;
+// Smaller level added on top of source
+uniform sampler2D bloom;
+uniform vec2 texelSize;
+uniform vec2 maxTexCoord;
+// View of bloom over its texture, and its texel size
+uniform vec2 bloomTexCoordScale;
+uniform vec2 bloomTexelSize;
+uniform vec2 bloomMaxTexCoord;
+// x: intensity
+uniform vec4 params;
+
+in vec2 vViewCoord;
+in vec2 vTexCoord;
+
+out vec4 fragColor;
+
+vec3 SampleBloom(vec2 texCoord, vec2 offset) {
+    return texture(bloom, min(texCoord + offset * bloomTexelSize, bloomMaxTexCoord)).rgb;
+}
+
+void main() {
+    // 3x3 tent filter
+    vec2 texCoord = vViewCoord * bloomTexCoordScale;
+    vec3 sum = SampleBloom(texCoord, vec2(0, 0)) * 4;
+    sum += (SampleBloom(texCoord, vec2(-1, 0)) + SampleBloom(texCoord, vec2(1, 0)) +
+            SampleBloom(texCoord, vec2(0, -1)) + SampleBloom(texCoord, vec2(0, 1))) * 2;
+    sum += SampleBloom(texCoord, vec2(-1, -1)) + SampleBloom(texCoord, vec2(1, -1)) +
+           SampleBloom(texCoord, vec2(-1, 1)) + SampleBloom(texCoord, vec2(1, 1));
+
+    vec4 color = texture(source, min(vTexCoord, maxTexCoord));
+    fragColor = vec4(color.rgb + sum / 16 * params.x, color.a);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+uniform sampler2D source;
+uniform vec2 maxTexCoord;
+// x: intensity, y: radius, z: softness, w: aspect ratio of the view
+uniform vec4 params;
+
+in vec2 vViewCoord;
+in vec2 vTexCoord;
+
+out vec4 fragColor;
+
+void main() {
+    vec4 color = texture(source, min(vTexCoord, maxTexCoord));
+
+    // Distance from the center, in heights of the view
+    vec2 offset = (vViewCoord - 0.5) * vec2(params.w, 1);
+    float darken = params.x * smoothstep(params.y, params.y + params.z, length(offset));
+
+    fragColor = vec4(color.rgb * (1 - darken), color.a);
+}
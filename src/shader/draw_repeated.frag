@@ -0,0 +1,34 @@
+#version 330 core
+
+// Must match RenderDebugMode in renderer.h
+#define RENDER_DEBUG_MODE_OVERDRAW 1
+#define RENDER_DEBUG_MODE_BATCH_ID 2
+
+uniform sampler2D texture0;
+// xy: tiles across the view, zw: tile coordinate of the bottom left of the view
+uniform vec4 tiling;
+// Part of the texture covered by the image, the rest is padding
+uniform vec2 imageScale;
+uniform vec4 color;
+uniform int debugMode;
+uniform vec4 debugColor;
+
+in vec2 vViewCoord;
+
+out vec4 fragColor;
+
+void main() {
+    // Wrap here instead of GL_REPEAT, which would repeat the padding too
+    vec2 tile = fract(vViewCoord * tiling.xy + tiling.zw);
+    vec4 texColor = texture(texture0, tile * imageScale);
+    // Pre-multiply alpha
+    texColor = vec4(texColor.rgb * texColor.a, texColor.a);
+
+    fragColor = texColor * color;
+
+    if (debugMode == RENDER_DEBUG_MODE_OVERDRAW) {
+        fragColor = debugColor;
+    } else if (debugMode == RENDER_DEBUG_MODE_BATCH_ID) {
+        fragColor = debugColor * fragColor.a;
+    }
+}
@@ -0,0 +1,8 @@
+#version 330 core
+
+out vec4 fragColor;
+
+// Only the stencil buffer is written
+void main() {
+    fragColor = vec4(0);
+}
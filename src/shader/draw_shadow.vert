@@ -0,0 +1,14 @@
+#version 330 core
+
+#include "view_constants.glsl"
+
+uniform vec2 lightPos;
+
+// z is 1 on the edge of the occluder and 0 on the copy of the edge projected away from the light to infinity
+layout (location = 0) in vec3 aPos;
+
+void main() {
+    // Points at infinity have w = 0, so their direction from the light is all that is kept
+    vec2 pos = aPos.z > 0 ? aPos.xy : aPos.xy - lightPos;
+    gl_Position = vec4((viewProjection * vec3(pos, aPos.z)).xy, 0, aPos.z);
+}
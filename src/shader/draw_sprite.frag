@@ -0,0 +1,131 @@
+#version 330 core
+
+// Rect features some sprites of a command need, the others are compiled out. Must match SpriteFeature in renderer.c
+#pragma variants SPRITE_HAS_ROUNDING SPRITE_HAS_BORDER
+
+#include "sprite_kind.glsl"
+
+// Must match RenderDebugMode in renderer.h
+#define RENDER_DEBUG_MODE_OVERDRAW 1
+#define RENDER_DEBUG_MODE_BATCH_ID 2
+
+// Must match OVERDRAW_MAX_LAYERS in renderer.c
+#define OVERDRAW_MAX_LAYERS 16.0
+
+uniform sampler2D texture0;
+uniform sampler2DArray textureArray;
+uniform int debugMode;
+uniform vec4 debugColor;
+
+in vec2 vTexCoord;
+in vec4 vColor;
+in vec2 vRoundRadius;
+in vec2 vThickness;
+in vec4 vBorderColor;
+flat in int vKind;
+flat in int vLayer;
+
+out vec4 fragColor;
+
+float CalcEllipseDelta(vec2 p, vec2 r) {
+    if (r.x == 0 || r.y == 0) {
+        return 0;
+    }
+
+    float d = (p.x / r.x) * (p.x / r.x) + (p.y / r.y) * (p.y / r.y);
+    float e = fwidth(d);
+    return 1 - smoothstep(1 - e, 1, d);
+}
+
+vec4 CalcBorderColor(vec2 p, vec2 roundRadius, vec2 thickness, vec4 borderColor, vec4 color) {
+    // Outer ellipse
+    float t = CalcEllipseDelta(p, roundRadius);
+    // Inner ellipse
+    float t2 = CalcEllipseDelta(p, roundRadius - thickness);
+    vec4 c = borderColor * (1 - t2);
+    // Blend between borderColor and color
+    c = c + color * (1 - c.a);
+    c = c * t;
+    return c;
+}
+
+vec4 CalcRectColor() {
+    // Pre-multiply alpha
+    vec4 color = vec4(vColor.rgb * vColor.a, vColor.a);
+#if defined(SPRITE_HAS_ROUNDING) || defined(SPRITE_HAS_BORDER)
+    vec4 borderColor = vec4(vBorderColor.rgb * vBorderColor.a, vBorderColor.a);
+#endif
+
+#ifdef SPRITE_HAS_ROUNDING
+    if (vTexCoord.x <= vRoundRadius.x && vTexCoord.y <= vRoundRadius.y) {
+        return CalcBorderColor(vTexCoord - vRoundRadius, vRoundRadius, vThickness, borderColor, color);
+    } else if (vTexCoord.x >= 1 - vRoundRadius.x && vTexCoord.y <= vRoundRadius.y) {
+        return CalcBorderColor(vec2(1 - vTexCoord.x, vTexCoord.y) - vRoundRadius, vRoundRadius, vThickness, borderColor, color);
+    } else if (vTexCoord.x <= vRoundRadius.x && vTexCoord.y >= 1 - vRoundRadius.y) {
+        return CalcBorderColor(vec2(vTexCoord.x, 1 - vTexCoord.y) - vRoundRadius, vRoundRadius, vThickness, borderColor, color);
+    } else if (vTexCoord.x >= 1 - vRoundRadius.x && vTexCoord.y >= 1 - vRoundRadius.y) {
+        return CalcBorderColor(vec2(1) - vTexCoord - vRoundRadius, vRoundRadius, vThickness, borderColor, color);
+    }
+#endif
+
+#ifdef SPRITE_HAS_BORDER
+    if (vTexCoord.x <= vThickness.x || vTexCoord.x >= 1.0 - vThickness.x || vTexCoord.y <= vThickness.y || vTexCoord.y >= 1.0 - vThickness.y) {
+        return borderColor;
+    }
+#endif
+
+    return color;
+}
+
+// Black for no overdraw, then blue at 1 layer, green at 2, yellow at 4, red at 8 and white at 16
+vec4 CalcHeatmapColor(float layers) {
+    vec3 ramp[6] = vec3[6](vec3(0, 0, 0), vec3(0, 0, 1), vec3(0, 1, 0), vec3(1, 1, 0), vec3(1, 0, 0), vec3(1, 1, 1));
+
+    if (layers < 1) {
+        return vec4(mix(ramp[0], ramp[1], max(layers, 0.0)), 1);
+    }
+
+    float level = min(log2(layers), 4.0);
+    int index = min(int(level), 3);
+    return vec4(mix(ramp[index + 1], ramp[index + 2], level - float(index)), 1);
+}
+
+void main() {
+    if (vKind == SPRITE_KIND_HEATMAP) {
+        fragColor = CalcHeatmapColor(texture(texture0, vTexCoord).r * OVERDRAW_MAX_LAYERS);
+        return;
+    }
+
+    if (vKind == SPRITE_KIND_RECT) {
+        fragColor = CalcRectColor();
+    } else if (vKind == SPRITE_KIND_SOLID) {
+        // Pre-multiply alpha
+        fragColor = vec4(vColor.rgb * vColor.a, vColor.a);
+    } else {
+        vec4 texColor;
+        if (vKind == SPRITE_KIND_TEXTURE_LAYER) {
+            texColor = texture(textureArray, vec3(vTexCoord, float(vLayer)));
+        } else {
+            texColor = texture(texture0, vTexCoord);
+        }
+        if (vKind == SPRITE_KIND_GLYPH) {
+            // Glyphs only carry coverage
+            texColor = vec4(1, 1, 1, texColor.a);
+        }
+        // Pre-multiply alpha
+        texColor = vec4(texColor.rgb * texColor.a, texColor.a);
+
+        fragColor = texColor * vColor;
+    }
+
+    // Render targets already went through the debug mode when they were drawn
+    if (vKind == SPRITE_KIND_COMPOSITE) {
+        return;
+    }
+
+    if (debugMode == RENDER_DEBUG_MODE_OVERDRAW) {
+        fragColor = debugColor;
+    } else if (debugMode == RENDER_DEBUG_MODE_BATCH_ID) {
+        fragColor = debugColor * fragColor.a;
+    }
+}
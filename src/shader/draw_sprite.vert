@@ -0,0 +1,59 @@
+#version 330 core
+
+#include "view_constants.glsl"
+#include "sprite_kind.glsl"
+
+// Must match MAX_SPRITE_CLIP_RECTS and GLClipRects in renderer.c
+#define MAX_CLIP_RECTS 31
+
+// World space min in xy and max in zw. Clip rect i of a vertex is clipRects[i - 1], 0 is none.
+layout (std140) uniform ClipRects {
+    vec4 clipRects[MAX_CLIP_RECTS];
+};
+
+// Positions are already transformed into world space, so quads of different transforms share one batch
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in vec2 aRoundRadius;
+layout (location = 4) in vec2 aThickness;
+layout (location = 5) in vec4 aBorderColor;
+layout (location = 6) in uint aKind;
+// 1 is the back, later sprites are closer
+layout (location = 7) in float aDepth;
+layout (location = 8) in uint aLayer;
+
+out vec2 vTexCoord;
+out vec4 vColor;
+out vec2 vRoundRadius;
+out vec2 vThickness;
+out vec4 vBorderColor;
+flat out int vKind;
+flat out int vLayer;
+out float gl_ClipDistance[4];
+
+void main() {
+    gl_Position = vec4((viewProjection * vec3(aPos, 1)).xy, aDepth * 2 - 1, 1);
+    vTexCoord = aTexCoord;
+    vColor = aColor;
+    vRoundRadius = aRoundRadius;
+    vThickness = aThickness;
+    vBorderColor = aBorderColor;
+    vKind = int(aKind & ((1u << SPRITE_KIND_BITS) - 1u));
+    vLayer = int(aLayer);
+
+    // Positive inside every edge of the rect, interpolated so the rect cuts through triangles
+    uint clip = aKind >> SPRITE_KIND_BITS;
+    if (clip > 0u) {
+        vec4 rect = clipRects[clip - 1u];
+        gl_ClipDistance[0] = aPos.x - rect.x;
+        gl_ClipDistance[1] = aPos.y - rect.y;
+        gl_ClipDistance[2] = rect.z - aPos.x;
+        gl_ClipDistance[3] = rect.w - aPos.y;
+    } else {
+        gl_ClipDistance[0] = 1;
+        gl_ClipDistance[1] = 1;
+        gl_ClipDistance[2] = 1;
+        gl_ClipDistance[3] = 1;
+    }
+}
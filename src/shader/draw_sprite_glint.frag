@@ -0,0 +1,37 @@
+#version 330 core
+
+// Material sweeping a band of light across textured sprites, see CreateMaterial
+
+#include "view_constants.glsl"
+#include "sprite_kind.glsl"
+
+uniform sampler2D texture0;
+uniform sampler2DArray textureArray;
+// params[0] is the color of the band, alpha scales it. params[1] is sweeps per second, band width and slope.
+// Must match MAX_MATERIAL_PARAMS in renderer.h
+uniform vec4 params[4];
+
+in vec2 vTexCoord;
+in vec4 vColor;
+flat in int vKind;
+flat in int vLayer;
+
+out vec4 fragColor;
+
+void main() {
+    vec4 texColor;
+    if (vKind == SPRITE_KIND_TEXTURE_LAYER) {
+        texColor = texture(textureArray, vec3(vTexCoord, float(vLayer)));
+    } else {
+        texColor = texture(texture0, vTexCoord);
+    }
+
+    // Texture coordinates are of the whole texture or page, which is fine for a band crossing it
+    float position = fract(time * params[1].x) * 3 - 1;
+    float offset = abs(vTexCoord.x + vTexCoord.y * params[1].z - position);
+    float band = 1 - smoothstep(0, params[1].y, offset);
+
+    // Pre-multiply alpha, the band only lights up what is already there so alpha is kept
+    vec3 rgb = texColor.rgb + params[0].rgb * params[0].a * band;
+    fragColor = vec4(rgb * texColor.a, texColor.a) * vColor;
+}
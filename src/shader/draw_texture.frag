@@ -1,6 +1,12 @@
 #version 330 core
 
+// Must match RenderDebugMode in renderer.h
+#define RENDER_DEBUG_MODE_OVERDRAW 1
+#define RENDER_DEBUG_MODE_BATCH_ID 2
+
 uniform sampler2D texture0;
+uniform int debugMode;
+uniform vec4 debugColor;
 
 in vec2 vTexCoord;
 in vec4 vColor;
@@ -13,4 +19,10 @@ void main() {
     texColor = vec4(texColor.rgb * texColor.a, texColor.a);
 
     fragColor = texColor * vColor;
+
+    if (debugMode == RENDER_DEBUG_MODE_OVERDRAW) {
+        fragColor = debugColor;
+    } else if (debugMode == RENDER_DEBUG_MODE_BATCH_ID) {
+        fragColor = debugColor * fragColor.a;
+    }
 }
@@ -0,0 +1,10 @@
+// Must match SpriteKind in renderer.c
+#define SPRITE_KIND_TEXTURE 0
+#define SPRITE_KIND_RECT 1
+#define SPRITE_KIND_GLYPH 2
+#define SPRITE_KIND_COMPOSITE 3
+#define SPRITE_KIND_HEATMAP 4
+#define SPRITE_KIND_SOLID 5
+#define SPRITE_KIND_TEXTURE_LAYER 6
+// The kind attribute holds the kind in its low SPRITE_KIND_BITS bits and the clip rect above them
+#define SPRITE_KIND_BITS 3
@@ -0,0 +1,9 @@
+// Must match GLViewConstants in renderer.c
+layout (std140) uniform ViewConstants {
+    mat3 viewProjection;
+    // In points
+    vec2 viewSize;
+    float pointToPixel;
+    // Seconds since the render context was created
+    float time;
+};
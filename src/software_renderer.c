@@ -0,0 +1,827 @@
+#include "software_renderer.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "time.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SOFTWARE_RENDERER_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// Tiles are rasterized independently, each by one thread, so they never share cache lines
+#define SOFTWARE_TILE_SIZE 64
+#define SOFTWARE_TILE_PIXELS (SOFTWARE_TILE_SIZE * SOFTWARE_TILE_SIZE)
+// Planes of a tile, R, G, B and A
+#define SOFTWARE_TILE_PLANES 4
+#define SOFTWARE_TILE_ALIGNMENT 32
+#define SOFTWARE_MAX_THREADS 64
+#define SOFTWARE_SRGB_TABLE_SIZE 4096
+
+// Pixels are processed SOFTWARE_LANES at a time along a row. Lane holds one float per pixel and LaneMask one bool.
+#if defined(__AVX__)
+
+#define SOFTWARE_LANES 8
+
+typedef __m256 Lane;
+typedef __m256 LaneMask;
+
+static inline Lane LaneSet(F x) { return _mm256_set1_ps(x); }
+static inline Lane LaneLoad(const F *p) { return _mm256_load_ps(p); }
+static inline Lane LaneLoadUnaligned(const F *p) { return _mm256_loadu_ps(p); }
+static inline void LaneStore(F *p, Lane x) { _mm256_store_ps(p, x); }
+static inline void LaneStoreUnaligned(F *p, Lane x) { _mm256_storeu_ps(p, x); }
+static inline Lane LaneAdd(Lane a, Lane b) { return _mm256_add_ps(a, b); }
+static inline Lane LaneSub(Lane a, Lane b) { return _mm256_sub_ps(a, b); }
+static inline Lane LaneMul(Lane a, Lane b) { return _mm256_mul_ps(a, b); }
+static inline Lane LaneDiv(Lane a, Lane b) { return _mm256_div_ps(a, b); }
+static inline Lane LaneMin(Lane a, Lane b) { return _mm256_min_ps(a, b); }
+static inline Lane LaneMax(Lane a, Lane b) { return _mm256_max_ps(a, b); }
+static inline Lane LaneAbs(Lane a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+static inline LaneMask LaneLess(Lane a, Lane b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline LaneMask LaneLessEqual(Lane a, Lane b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline LaneMask LaneMaskAnd(LaneMask a, LaneMask b) { return _mm256_and_ps(a, b); }
+static inline LaneMask LaneMaskOr(LaneMask a, LaneMask b) { return _mm256_or_ps(a, b); }
+static inline int LaneMaskBits(LaneMask m) { return _mm256_movemask_ps(m); }
+static inline Lane LaneSelect(LaneMask m, Lane a, Lane b) { return _mm256_blendv_ps(b, a, m); }
+// a where m is set, 0 elsewhere
+static inline Lane LaneKeep(LaneMask m, Lane a) { return _mm256_and_ps(m, a); }
+
+#elif defined(SOFTWARE_RENDERER_USE_SSE)
+
+#define SOFTWARE_LANES 4
+
+typedef __m128 Lane;
+typedef __m128 LaneMask;
+
+static inline Lane LaneSet(F x) { return _mm_set1_ps(x); }
+static inline Lane LaneLoad(const F *p) { return _mm_load_ps(p); }
+static inline Lane LaneLoadUnaligned(const F *p) { return _mm_loadu_ps(p); }
+static inline void LaneStore(F *p, Lane x) { _mm_store_ps(p, x); }
+static inline void LaneStoreUnaligned(F *p, Lane x) { _mm_storeu_ps(p, x); }
+static inline Lane LaneAdd(Lane a, Lane b) { return _mm_add_ps(a, b); }
+static inline Lane LaneSub(Lane a, Lane b) { return _mm_sub_ps(a, b); }
+static inline Lane LaneMul(Lane a, Lane b) { return _mm_mul_ps(a, b); }
+static inline Lane LaneDiv(Lane a, Lane b) { return _mm_div_ps(a, b); }
+static inline Lane LaneMin(Lane a, Lane b) { return _mm_min_ps(a, b); }
+static inline Lane LaneMax(Lane a, Lane b) { return _mm_max_ps(a, b); }
+static inline Lane LaneAbs(Lane a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline LaneMask LaneLess(Lane a, Lane b) { return _mm_cmplt_ps(a, b); }
+static inline LaneMask LaneLessEqual(Lane a, Lane b) { return _mm_cmple_ps(a, b); }
+static inline LaneMask LaneMaskAnd(LaneMask a, LaneMask b) { return _mm_and_ps(a, b); }
+static inline LaneMask LaneMaskOr(LaneMask a, LaneMask b) { return _mm_or_ps(a, b); }
+static inline int LaneMaskBits(LaneMask m) { return _mm_movemask_ps(m); }
+// SSE has no blend instruction, so select with and/andnot
+static inline Lane LaneSelect(LaneMask m, Lane a, Lane b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+static inline Lane LaneKeep(LaneMask m, Lane a) { return _mm_and_ps(m, a); }
+
+#else
+
+#define SOFTWARE_LANES 1
+
+typedef F Lane;
+typedef int LaneMask;
+
+static inline Lane LaneSet(F x) { return x; }
+static inline Lane LaneLoad(const F *p) { return *p; }
+static inline Lane LaneLoadUnaligned(const F *p) { return *p; }
+static inline void LaneStore(F *p, Lane x) { *p = x; }
+static inline void LaneStoreUnaligned(F *p, Lane x) { *p = x; }
+static inline Lane LaneAdd(Lane a, Lane b) { return a + b; }
+static inline Lane LaneSub(Lane a, Lane b) { return a - b; }
+static inline Lane LaneMul(Lane a, Lane b) { return a * b; }
+static inline Lane LaneDiv(Lane a, Lane b) { return a / b; }
+static inline Lane LaneMin(Lane a, Lane b) { return a < b ? a : b; }
+static inline Lane LaneMax(Lane a, Lane b) { return a > b ? a : b; }
+static inline Lane LaneAbs(Lane a) { return fabsf(a); }
+static inline LaneMask LaneLess(Lane a, Lane b) { return a < b; }
+static inline LaneMask LaneLessEqual(Lane a, Lane b) { return a <= b; }
+static inline LaneMask LaneMaskAnd(LaneMask a, LaneMask b) { return a && b; }
+static inline LaneMask LaneMaskOr(LaneMask a, LaneMask b) { return a || b; }
+static inline int LaneMaskBits(LaneMask m) { return m; }
+static inline Lane LaneSelect(LaneMask m, Lane a, Lane b) { return m ? a : b; }
+static inline Lane LaneKeep(LaneMask m, Lane a) { return m ? a : 0.0f; }
+
+#endif
+
+// Premultiplied color of SOFTWARE_LANES pixels
+typedef struct LaneColor {
+    Lane r;
+    Lane g;
+    Lane b;
+    Lane a;
+} LaneColor;
+
+typedef enum SoftwareCommandKind {
+    SOFTWARE_COMMAND_QUAD,
+    SOFTWARE_COMMAND_TRIANGLES,
+} SoftwareCommandKind;
+
+typedef struct SoftwareCommand {
+    SoftwareCommandKind kind;
+    // Pixels that may be touched, clamped to the framebuffer. max is exclusive.
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+
+    // SOFTWARE_COMMAND_QUAD. u and v of the pixel center (x, y) are u0 + dudx * x + dudy * y and likewise for v.
+    SoftwareQuad quad;
+    F u0, dudx, dudy;
+    F v0, dvdx, dvdy;
+    // Colors premultiplied
+    V4 color;
+    V4 borderColor;
+
+    // SOFTWARE_COMMAND_TRIANGLES, range of triangleVertices with 3 vertices per triangle
+    int firstVertex;
+    int vertexCount;
+} SoftwareCommand;
+
+struct SoftwareRenderer {
+    int width;
+    int height;
+    int tileCountX;
+    int tileCountY;
+    // Planar RGBA floats of every tile, one tile after another
+    void *tileMemory;
+    F *tiles;
+    unsigned char *pixels;
+
+    int commandCount;
+    int commandCapacity;
+    SoftwareCommand *commands;
+    int triangleVertexCount;
+    int triangleVertexCapacity;
+    V2 *triangleVertices;
+
+    // Textures destroyed while queued commands may still sample them
+    int pendingTextureCount;
+    int pendingTextureCapacity;
+    SoftwareTexture **pendingTextures;
+
+    // Workers and the thread calling EndSoftwareFrame claim tiles from nextTile until every tile is done
+    int threadCount;
+    SDL_Thread *threads[SOFTWARE_MAX_THREADS];
+    SDL_sem *startSem;
+    SDL_sem *doneSem;
+    SDL_atomic_t nextTile;
+    SDL_atomic_t fragmentCount;
+    int isQuitting;
+
+    RenderTimings timings;
+};
+
+static F SRGB_TO_LINEAR[256];
+static unsigned char LINEAR_TO_SRGB[SOFTWARE_SRGB_TABLE_SIZE];
+static int isSRGBTableReady;
+
+static void SetupSRGBTables(void) {
+    if (isSRGBTableReady) {
+        return;
+    }
+
+    for (int i = 0; i < 256; ++i) {
+        F c = (F) i / 255.0f;
+        SRGB_TO_LINEAR[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i < SOFTWARE_SRGB_TABLE_SIZE; ++i) {
+        F c = (F) i / (SOFTWARE_SRGB_TABLE_SIZE - 1);
+        F s = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+        LINEAR_TO_SRGB[i] = (unsigned char) (s * 255.0f + 0.5f);
+    }
+    isSRGBTableReady = 1;
+}
+
+static inline int MinInt(int a, int b) {
+    return a < b ? a : b;
+}
+
+static inline int MaxInt(int a, int b) {
+    return a > b ? a : b;
+}
+
+static inline int ClampInt(int x, int min, int max) {
+    return x < min ? min : (x > max ? max : x);
+}
+
+static inline BBox2 ExtendBBox2(BBox2 bbox, V2 p) {
+    return MakeBBox2(MakeV2(fminf(bbox.min.x, p.x), fminf(bbox.min.y, p.y)),
+                     MakeV2(fmaxf(bbox.max.x, p.x), fmaxf(bbox.max.y, p.y)));
+}
+
+static inline int CountMaskBits(int bits) {
+    int count = 0;
+    for (; bits; bits &= bits - 1) {
+        ++count;
+    }
+    return count;
+}
+
+static inline V4 PremultiplyV4(V4 c) {
+    return MakeV4(c.r * c.a, c.g * c.a, c.b * c.a, c.a);
+}
+
+// Centers of the pixels starting at x along a row
+static inline Lane GetLanePixelCenters(int x) {
+#if SOFTWARE_LANES == 1
+    return (F) x + 0.5f;
+#else
+    F centers[SOFTWARE_LANES];
+    for (int i = 0; i < SOFTWARE_LANES; ++i) {
+        centers[i] = (F) (x + i) + 0.5f;
+    }
+    return LaneLoadUnaligned(centers);
+#endif
+}
+
+static void SetSoftwareCommandBBox(SoftwareRenderer *sr, SoftwareCommand *command, BBox2 bbox) {
+    command->minX = ClampInt((int) FloorF(bbox.min.x), 0, sr->width);
+    command->minY = ClampInt((int) FloorF(bbox.min.y), 0, sr->height);
+    command->maxX = ClampInt((int) CeilF(bbox.max.x), 0, sr->width);
+    command->maxY = ClampInt((int) CeilF(bbox.max.y), 0, sr->height);
+}
+
+static SoftwareCommand *PushSoftwareCommand(SoftwareRenderer *sr, SoftwareCommandKind kind) {
+    if (sr->commandCount == sr->commandCapacity) {
+        sr->commandCapacity = sr->commandCapacity * 2 + 256;
+        sr->commands = realloc(sr->commands, sizeof(SoftwareCommand) * sr->commandCapacity);
+    }
+
+    SoftwareCommand *command = &sr->commands[sr->commandCount++];
+    memset(command, 0, sizeof(SoftwareCommand));
+    command->kind = kind;
+    return command;
+}
+
+// Blend premultiplied src over the pixels of the masked lanes
+static inline void BlendSoftwarePixels(F *planes, int offset, LaneMask mask, LaneColor src) {
+    F *r = planes + offset;
+    F *g = r + SOFTWARE_TILE_PIXELS;
+    F *b = g + SOFTWARE_TILE_PIXELS;
+    F *a = b + SOFTWARE_TILE_PIXELS;
+
+    Lane invA = LaneSub(LaneSet(1.0f), LaneKeep(mask, src.a));
+    LaneStore(r, LaneAdd(LaneKeep(mask, src.r), LaneMul(LaneLoad(r), invA)));
+    LaneStore(g, LaneAdd(LaneKeep(mask, src.g), LaneMul(LaneLoad(g), invA)));
+    LaneStore(b, LaneAdd(LaneKeep(mask, src.b), LaneMul(LaneLoad(b), invA)));
+    LaneStore(a, LaneAdd(LaneKeep(mask, src.a), LaneMul(LaneLoad(a), invA)));
+}
+
+// Nearest texels at texel coordinates s and t, clamped to the edge. There is no gather before AVX2, so the lanes are
+// fetched one by one.
+static inline LaneColor SampleSoftwareTexture(const SoftwareTexture *texture, Lane s, Lane t) {
+    F ss[SOFTWARE_LANES], ts[SOFTWARE_LANES];
+    F r[SOFTWARE_LANES], g[SOFTWARE_LANES], b[SOFTWARE_LANES], a[SOFTWARE_LANES];
+    LaneStoreUnaligned(ss, s);
+    LaneStoreUnaligned(ts, t);
+
+    for (int i = 0; i < SOFTWARE_LANES; ++i) {
+        int x = ClampInt((int) FloorF(ss[i]), 0, texture->width - 1);
+        int y = ClampInt((int) FloorF(ts[i]), 0, texture->height - 1);
+        const F *texel = texture->texels + ((size_t) y * texture->width + x) * 4;
+        r[i] = texel[0];
+        g[i] = texel[1];
+        b[i] = texel[2];
+        a[i] = texel[3];
+    }
+
+    LaneColor result;
+    result.r = LaneLoadUnaligned(r);
+    result.g = LaneLoadUnaligned(g);
+    result.b = LaneLoadUnaligned(b);
+    result.a = LaneLoadUnaligned(a);
+    return result;
+}
+
+// 1 inside the ellipse of radius r centered at p = 0, fading out over one pixel, like CalcEllipseDelta in
+// draw_sprite.frag. dpdx and dpdy are the derivatives of p along screen x and y.
+static inline Lane CalcSoftwareEllipseDelta(Lane px, Lane py, V2 r, Lane dpxdx, Lane dpxdy, Lane dpydx, Lane dpydy) {
+    if (r.x == 0.0f || r.y == 0.0f) {
+        return LaneSet(0.0f);
+    }
+
+    Lane kx = LaneSet(1.0f / (r.x * r.x));
+    Lane ky = LaneSet(1.0f / (r.y * r.y));
+    Lane d = LaneAdd(LaneMul(LaneMul(px, px), kx), LaneMul(LaneMul(py, py), ky));
+
+    // fwidth(d), d is quadratic so its derivative is taken analytically
+    Lane two = LaneSet(2.0f);
+    Lane gx = LaneMul(two, LaneMul(px, kx));
+    Lane gy = LaneMul(two, LaneMul(py, ky));
+    Lane e = LaneAdd(LaneAbs(LaneAdd(LaneMul(gx, dpxdx), LaneMul(gy, dpydx))),
+                     LaneAbs(LaneAdd(LaneMul(gx, dpxdy), LaneMul(gy, dpydy))));
+    e = LaneMax(e, LaneSet(1e-6f));
+
+    // 1 - smoothstep(1 - e, 1, d)
+    Lane one = LaneSet(1.0f);
+    Lane t = LaneDiv(LaneSub(d, LaneSub(one, e)), e);
+    t = LaneMin(LaneMax(t, LaneSet(0.0f)), one);
+    return LaneSub(one, LaneMul(LaneMul(t, t), LaneSub(LaneSet(3.0f), LaneMul(two, t))));
+}
+
+// Shade a rect like CalcRectColor in draw_sprite.frag. u and v span [0, 1) over the quad.
+static inline LaneColor ShadeSoftwareRect(const SoftwareCommand *command, Lane u, Lane v) {
+    const SoftwareQuad *quad = &command->quad;
+    V2 r = quad->roundRadius;
+    V2 th = quad->thickness;
+    Lane one = LaneSet(1.0f);
+    Lane half = LaneSet(0.5f);
+
+    // Distance to the closest edge, mirrored into the bottom left quarter of the rect
+    LaneMask isLeft = LaneLess(u, half);
+    LaneMask isBottom = LaneLess(v, half);
+    Lane qx = LaneMin(u, LaneSub(one, u));
+    Lane qy = LaneMin(v, LaneSub(one, v));
+
+    LaneColor color = {LaneSet(command->color.r), LaneSet(command->color.g), LaneSet(command->color.b),
+                       LaneSet(command->color.a)};
+    LaneColor border = {LaneSet(command->borderColor.r), LaneSet(command->borderColor.g),
+                        LaneSet(command->borderColor.b), LaneSet(command->borderColor.a)};
+
+    LaneMask isBorder = LaneMaskOr(LaneLessEqual(qx, LaneSet(th.x)), LaneLessEqual(qy, LaneSet(th.y)));
+    LaneColor result;
+    result.r = LaneSelect(isBorder, border.r, color.r);
+    result.g = LaneSelect(isBorder, border.g, color.g);
+    result.b = LaneSelect(isBorder, border.b, color.b);
+    result.a = LaneSelect(isBorder, border.a, color.a);
+
+    if (r.x <= 0.0f || r.y <= 0.0f) {
+        return result;
+    }
+
+    LaneMask isCorner = LaneMaskAnd(LaneLessEqual(qx, LaneSet(r.x)), LaneLessEqual(qy, LaneSet(r.y)));
+    if (!LaneMaskBits(isCorner)) {
+        return result;
+    }
+
+    // Mirroring flips the derivatives of the mirrored coordinate
+    Lane dqxdx = LaneSelect(isLeft, LaneSet(command->dudx), LaneSet(-command->dudx));
+    Lane dqxdy = LaneSelect(isLeft, LaneSet(command->dudy), LaneSet(-command->dudy));
+    Lane dqydx = LaneSelect(isBottom, LaneSet(command->dvdx), LaneSet(-command->dvdx));
+    Lane dqydy = LaneSelect(isBottom, LaneSet(command->dvdy), LaneSet(-command->dvdy));
+
+    Lane px = LaneSub(qx, LaneSet(r.x));
+    Lane py = LaneSub(qy, LaneSet(r.y));
+    Lane t = CalcSoftwareEllipseDelta(px, py, r, dqxdx, dqxdy, dqydx, dqydy);
+    Lane t2 = CalcSoftwareEllipseDelta(px, py, SubV2(r, th), dqxdx, dqxdy, dqydx, dqydy);
+
+    // Border outside of the inner ellipse, blended over color, cut by the outer ellipse
+    Lane borderWeight = LaneSub(one, t2);
+    Lane cornerA = LaneMul(border.a, borderWeight);
+    Lane colorWeight = LaneSub(one, cornerA);
+    LaneColor corner;
+    corner.r = LaneMul(LaneAdd(LaneMul(border.r, borderWeight), LaneMul(color.r, colorWeight)), t);
+    corner.g = LaneMul(LaneAdd(LaneMul(border.g, borderWeight), LaneMul(color.g, colorWeight)), t);
+    corner.b = LaneMul(LaneAdd(LaneMul(border.b, borderWeight), LaneMul(color.b, colorWeight)), t);
+    corner.a = LaneMul(LaneAdd(cornerA, LaneMul(color.a, colorWeight)), t);
+
+    result.r = LaneSelect(isCorner, corner.r, result.r);
+    result.g = LaneSelect(isCorner, corner.g, result.g);
+    result.b = LaneSelect(isCorner, corner.b, result.b);
+    result.a = LaneSelect(isCorner, corner.a, result.a);
+    return result;
+}
+
+// Return the number of pixels shaded
+static int RasterizeSoftwareQuad(const SoftwareCommand *command, F *planes, int tileX, int tileY,
+                                 int minX, int minY, int maxX, int maxY) {
+    const SoftwareQuad *quad = &command->quad;
+    int fragmentCount = 0;
+
+    Lane zero = LaneSet(0.0f);
+    Lane one = LaneSet(1.0f);
+    Lane dudx = LaneSet(command->dudx);
+    Lane dvdx = LaneSet(command->dvdx);
+
+    // Texel coordinates of u, v = 0 and their change over u, v = 1
+    V2 texSize = quad->texture ? MakeV2((F) quad->texture->width, (F) quad->texture->height) : ZeroV2();
+    Lane s0 = LaneSet(quad->texBBox.min.x * texSize.x);
+    Lane t0 = LaneSet(quad->texBBox.min.y * texSize.y);
+    Lane ds = LaneSet((quad->texBBox.max.x - quad->texBBox.min.x) * texSize.x);
+    Lane dt = LaneSet((quad->texBBox.max.y - quad->texBBox.min.y) * texSize.y);
+
+    // Start at a lane boundary of the tile so loads and stores stay aligned
+    int startX = tileX + (minX - tileX) / SOFTWARE_LANES * SOFTWARE_LANES;
+
+    for (int y = minY; y < maxY; ++y) {
+        F centerY = (F) y + 0.5f;
+        Lane rowU = LaneSet(command->u0 + command->dudy * centerY);
+        Lane rowV = LaneSet(command->v0 + command->dvdy * centerY);
+        int rowOffset = (y - tileY) * SOFTWARE_TILE_SIZE - tileX;
+
+        for (int x = startX; x < maxX; x += SOFTWARE_LANES) {
+            Lane centerX = GetLanePixelCenters(x);
+            Lane u = LaneAdd(rowU, LaneMul(dudx, centerX));
+            Lane v = LaneAdd(rowV, LaneMul(dvdx, centerX));
+
+            LaneMask mask = LaneMaskAnd(LaneMaskAnd(LaneLessEqual(zero, u), LaneLess(u, one)),
+                                        LaneMaskAnd(LaneLessEqual(zero, v), LaneLess(v, one)));
+            int bits = LaneMaskBits(mask);
+            if (!bits) {
+                continue;
+            }
+
+            LaneColor src;
+            if (quad->kind == SOFTWARE_QUAD_RECT) {
+                src = ShadeSoftwareRect(command, u, v);
+            } else {
+                src = SampleSoftwareTexture(quad->texture, LaneAdd(s0, LaneMul(u, ds)), LaneAdd(t0, LaneMul(v, dt)));
+                src.r = LaneMul(src.r, LaneSet(command->color.r));
+                src.g = LaneMul(src.g, LaneSet(command->color.g));
+                src.b = LaneMul(src.b, LaneSet(command->color.b));
+                src.a = LaneMul(src.a, LaneSet(command->color.a));
+            }
+
+            BlendSoftwarePixels(planes, rowOffset + x, mask, src);
+            fragmentCount += CountMaskBits(bits);
+        }
+    }
+
+    return fragmentCount;
+}
+
+// Edge a -> b of a counter-clockwise triangle, positive inside. Pixel centers exactly on the edge belong to the
+// triangle only for top and left edges, so triangles sharing an edge never blend twice.
+typedef struct SoftwareEdge {
+    F e0;
+    F dedx;
+    F dedy;
+    int isTopLeft;
+} SoftwareEdge;
+
+static SoftwareEdge MakeSoftwareEdge(V2 a, V2 b) {
+    SoftwareEdge edge;
+    V2 d = SubV2(b, a);
+    edge.dedx = -d.y;
+    edge.dedy = d.x;
+    edge.e0 = d.y * a.x - d.x * a.y;
+    edge.isTopLeft = d.y < 0.0f || (d.y == 0.0f && d.x < 0.0f);
+    return edge;
+}
+
+static inline LaneMask IsInsideSoftwareEdge(const SoftwareEdge *edge, Lane centerX, F centerY) {
+    Lane e = LaneAdd(LaneSet(edge->e0 + edge->dedy * centerY), LaneMul(LaneSet(edge->dedx), centerX));
+    return edge->isTopLeft ? LaneLessEqual(LaneSet(0.0f), e) : LaneLess(LaneSet(0.0f), e);
+}
+
+static int RasterizeSoftwareTriangles(const SoftwareRenderer *sr, const SoftwareCommand *command, F *planes,
+                                      int tileX, int tileY, int minX, int minY, int maxX, int maxY) {
+    int fragmentCount = 0;
+    LaneColor src = {LaneSet(command->color.r), LaneSet(command->color.g), LaneSet(command->color.b),
+                     LaneSet(command->color.a)};
+
+    for (int i = 0; i < command->vertexCount; i += 3) {
+        const V2 *p = &sr->triangleVertices[command->firstVertex + i];
+        V2 a = p[0], b = p[1], c = p[2];
+        F area = CrossV2(SubV2(b, a), SubV2(c, a));
+        if (area == 0.0f) {
+            continue;
+        }
+        if (area < 0.0f) {
+            V2 tmp = b;
+            b = c;
+            c = tmp;
+        }
+
+        int triMinX = MaxInt(minX, (int) FloorF(fminf(a.x, fminf(b.x, c.x))));
+        int triMinY = MaxInt(minY, (int) FloorF(fminf(a.y, fminf(b.y, c.y))));
+        int triMaxX = MinInt(maxX, (int) CeilF(fmaxf(a.x, fmaxf(b.x, c.x))));
+        int triMaxY = MinInt(maxY, (int) CeilF(fmaxf(a.y, fmaxf(b.y, c.y))));
+        if (triMinX >= triMaxX || triMinY >= triMaxY) {
+            continue;
+        }
+
+        SoftwareEdge edges[3] = {MakeSoftwareEdge(a, b), MakeSoftwareEdge(b, c), MakeSoftwareEdge(c, a)};
+        int startX = tileX + (triMinX - tileX) / SOFTWARE_LANES * SOFTWARE_LANES;
+
+        for (int y = triMinY; y < triMaxY; ++y) {
+            F centerY = (F) y + 0.5f;
+            int rowOffset = (y - tileY) * SOFTWARE_TILE_SIZE - tileX;
+
+            for (int x = startX; x < triMaxX; x += SOFTWARE_LANES) {
+                Lane centerX = GetLanePixelCenters(x);
+                LaneMask mask = LaneMaskAnd(IsInsideSoftwareEdge(&edges[0], centerX, centerY),
+                                            LaneMaskAnd(IsInsideSoftwareEdge(&edges[1], centerX, centerY),
+                                                        IsInsideSoftwareEdge(&edges[2], centerX, centerY)));
+                int bits = LaneMaskBits(mask);
+                if (!bits) {
+                    continue;
+                }
+
+                BlendSoftwarePixels(planes, rowOffset + x, mask, src);
+                fragmentCount += CountMaskBits(bits);
+            }
+        }
+    }
+
+    return fragmentCount;
+}
+
+// Encode the tile to sRGB bytes into the framebuffer, flipping rows since the framebuffer starts from the top
+static void ResolveSoftwareTile(SoftwareRenderer *sr, const F *planes, int tileX, int tileY, int maxX, int maxY) {
+    const F *r = planes;
+    const F *g = r + SOFTWARE_TILE_PIXELS;
+    const F *b = g + SOFTWARE_TILE_PIXELS;
+    const F *a = b + SOFTWARE_TILE_PIXELS;
+    const F scale = SOFTWARE_SRGB_TABLE_SIZE - 1;
+
+    for (int y = tileY; y < maxY; ++y) {
+        unsigned char *dst = sr->pixels + ((size_t) (sr->height - 1 - y) * sr->width + tileX) * 4;
+        int offset = (y - tileY) * SOFTWARE_TILE_SIZE;
+        for (int x = tileX; x < maxX; ++x, ++offset, dst += 4) {
+            dst[0] = LINEAR_TO_SRGB[(int) (ClampF(r[offset], 0.0f, 1.0f) * scale + 0.5f)];
+            dst[1] = LINEAR_TO_SRGB[(int) (ClampF(g[offset], 0.0f, 1.0f) * scale + 0.5f)];
+            dst[2] = LINEAR_TO_SRGB[(int) (ClampF(b[offset], 0.0f, 1.0f) * scale + 0.5f)];
+            dst[3] = (unsigned char) (ClampF(a[offset], 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+}
+
+static int RasterizeSoftwareTile(SoftwareRenderer *sr, int tileIndex) {
+    int tileX = tileIndex % sr->tileCountX * SOFTWARE_TILE_SIZE;
+    int tileY = tileIndex / sr->tileCountX * SOFTWARE_TILE_SIZE;
+    int tileMaxX = MinInt(tileX + SOFTWARE_TILE_SIZE, sr->width);
+    int tileMaxY = MinInt(tileY + SOFTWARE_TILE_SIZE, sr->height);
+
+    F *planes = sr->tiles + (size_t) tileIndex * SOFTWARE_TILE_PLANES * SOFTWARE_TILE_PIXELS;
+    memset(planes, 0, sizeof(F) * SOFTWARE_TILE_PLANES * SOFTWARE_TILE_PIXELS);
+
+    int fragmentCount = 0;
+    for (int i = 0; i < sr->commandCount; ++i) {
+        const SoftwareCommand *command = &sr->commands[i];
+        int minX = MaxInt(command->minX, tileX);
+        int minY = MaxInt(command->minY, tileY);
+        int maxX = MinInt(command->maxX, tileMaxX);
+        int maxY = MinInt(command->maxY, tileMaxY);
+        if (minX >= maxX || minY >= maxY) {
+            continue;
+        }
+
+        switch (command->kind) {
+            case SOFTWARE_COMMAND_QUAD: {
+                fragmentCount += RasterizeSoftwareQuad(command, planes, tileX, tileY, minX, minY, maxX, maxY);
+            } break;
+            case SOFTWARE_COMMAND_TRIANGLES: {
+                fragmentCount += RasterizeSoftwareTriangles(sr, command, planes, tileX, tileY, minX, minY, maxX, maxY);
+            } break;
+        }
+    }
+
+    ResolveSoftwareTile(sr, planes, tileX, tileY, tileMaxX, tileMaxY);
+
+    return fragmentCount;
+}
+
+static void RasterizeSoftwareTiles(SoftwareRenderer *sr) {
+    int tileCount = sr->tileCountX * sr->tileCountY;
+    int fragmentCount = 0;
+
+    for (;;) {
+        int tileIndex = SDL_AtomicAdd(&sr->nextTile, 1);
+        if (tileIndex >= tileCount) {
+            break;
+        }
+        fragmentCount += RasterizeSoftwareTile(sr, tileIndex);
+    }
+
+    SDL_AtomicAdd(&sr->fragmentCount, fragmentCount);
+}
+
+static int RunSoftwareWorker(void *data) {
+    SoftwareRenderer *sr = data;
+
+    for (;;) {
+        SDL_SemWait(sr->startSem);
+        if (sr->isQuitting) {
+            break;
+        }
+        RasterizeSoftwareTiles(sr);
+        SDL_SemPost(sr->doneSem);
+    }
+
+    return 0;
+}
+
+extern SoftwareRenderer *CreateSoftwareRenderer(int width, int height, int threadCount) {
+    assert(width > 0 && height > 0);
+
+    SetupSRGBTables();
+
+    SoftwareRenderer *sr = malloc(sizeof(SoftwareRenderer));
+    memset(sr, 0, sizeof(SoftwareRenderer));
+    sr->width = width;
+    sr->height = height;
+    sr->tileCountX = (width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    sr->tileCountY = (height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+
+    // Tiles are multiple of 32 bytes, so every plane starts at an aligned address
+    size_t tileMemorySize = sizeof(F) * SOFTWARE_TILE_PLANES * SOFTWARE_TILE_PIXELS * sr->tileCountX * sr->tileCountY;
+    sr->tileMemory = malloc(tileMemorySize + SOFTWARE_TILE_ALIGNMENT);
+    sr->tiles = (F *) (((uintptr_t) sr->tileMemory + SOFTWARE_TILE_ALIGNMENT - 1) &
+                       ~(uintptr_t) (SOFTWARE_TILE_ALIGNMENT - 1));
+    sr->pixels = calloc((size_t) width * height, 4);
+
+    if (threadCount <= 0) {
+        threadCount = SDL_GetCPUCount();
+    }
+    sr->threadCount = ClampInt(threadCount, 1, SOFTWARE_MAX_THREADS);
+    sr->startSem = SDL_CreateSemaphore(0);
+    sr->doneSem = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&sr->nextTile, 0);
+    SDL_AtomicSet(&sr->fragmentCount, 0);
+
+    // The thread calling EndSoftwareFrame is one of them
+    for (int i = 1; i < sr->threadCount; ++i) {
+        sr->threads[i] = SDL_CreateThread(RunSoftwareWorker, "SoftwareRenderer", sr);
+        if (sr->threads[i] == NULL) {
+            printf("Failed to create software renderer thread: %s\n", SDL_GetError());
+            sr->threadCount = i;
+            break;
+        }
+    }
+
+    return sr;
+}
+
+extern void DestroySoftwareRenderer(SoftwareRenderer *sr) {
+    sr->isQuitting = 1;
+    for (int i = 1; i < sr->threadCount; ++i) {
+        SDL_SemPost(sr->startSem);
+    }
+    for (int i = 1; i < sr->threadCount; ++i) {
+        SDL_WaitThread(sr->threads[i], NULL);
+    }
+    SDL_DestroySemaphore(sr->startSem);
+    SDL_DestroySemaphore(sr->doneSem);
+
+    for (int i = 0; i < sr->pendingTextureCount; ++i) {
+        free(sr->pendingTextures[i]->texels);
+        free(sr->pendingTextures[i]);
+    }
+    free(sr->pendingTextures);
+    free(sr->commands);
+    free(sr->triangleVertices);
+    free(sr->pixels);
+    free(sr->tileMemory);
+    free(sr);
+}
+
+extern SoftwareTexture *CreateSoftwareTexture(const unsigned char *data, int width, int height, int stride, ImageChannel channel) {
+    SoftwareTexture *texture = malloc(sizeof(SoftwareTexture));
+    texture->width = MaxInt(width, 1);
+    texture->height = MaxInt(height, 1);
+    texture->texels = calloc((size_t) texture->width * texture->height, sizeof(F) * 4);
+
+    UpdateSoftwareTexture(texture, 0, 0, data, width, height, stride, channel);
+
+    return texture;
+}
+
+extern void UpdateSoftwareTexture(SoftwareTexture *texture, int x0, int y0, const unsigned char *data, int width,
+                                  int height, int stride, ImageChannel channel) {
+    SetupSRGBTables();
+
+    for (int y = 0; y < height; ++y) {
+        // Flip image vertically
+        const unsigned char *src = data + (size_t) stride * (height - 1 - y);
+        F *dst = texture->texels + ((size_t) (y0 + y) * texture->width + x0) * 4;
+        for (int x = 0; x < width; ++x, dst += 4) {
+            if (channel == IMAGE_CHANNEL_A) {
+                F a = src[x] / 255.0f;
+                dst[0] = dst[1] = dst[2] = dst[3] = a;
+            } else {
+                F a = src[x * 4 + 3] / 255.0f;
+                dst[0] = SRGB_TO_LINEAR[src[x * 4 + 0]] * a;
+                dst[1] = SRGB_TO_LINEAR[src[x * 4 + 1]] * a;
+                dst[2] = SRGB_TO_LINEAR[src[x * 4 + 2]] * a;
+                dst[3] = a;
+            }
+        }
+    }
+}
+
+extern void DestroySoftwareTexture(SoftwareRenderer *sr, SoftwareTexture *texture) {
+    if (sr->commandCount == 0) {
+        free(texture->texels);
+        free(texture);
+        return;
+    }
+
+    if (sr->pendingTextureCount == sr->pendingTextureCapacity) {
+        sr->pendingTextureCapacity = sr->pendingTextureCapacity * 2 + 16;
+        sr->pendingTextures = realloc(sr->pendingTextures, sizeof(SoftwareTexture *) * sr->pendingTextureCapacity);
+    }
+    sr->pendingTextures[sr->pendingTextureCount++] = texture;
+}
+
+extern void BeginSoftwareFrame(SoftwareRenderer *sr) {
+    sr->commandCount = 0;
+    sr->triangleVertexCount = 0;
+}
+
+extern void PushSoftwareQuad(SoftwareRenderer *sr, const SoftwareQuad *quad) {
+    F det = CrossV2(quad->xAxis, quad->yAxis);
+    if (det == 0.0f || (quad->color.a <= 0.0f && (quad->kind != SOFTWARE_QUAD_RECT || quad->borderColor.a <= 0.0f))) {
+        return;
+    }
+    assert(quad->kind != SOFTWARE_QUAD_TEXTURE || quad->texture);
+
+    V2 o = quad->origin;
+    V2 corners[4] = {o, AddV2(o, quad->xAxis), AddV2(o, quad->yAxis), AddV2(AddV2(o, quad->xAxis), quad->yAxis)};
+    BBox2 bbox = MakeBBox2(corners[0], corners[0]);
+    for (int i = 1; i < 4; ++i) {
+        bbox = ExtendBBox2(bbox, corners[i]);
+    }
+
+    SoftwareCommand *command = PushSoftwareCommand(sr, SOFTWARE_COMMAND_QUAD);
+    SetSoftwareCommandBBox(sr, command, bbox);
+    command->quad = *quad;
+
+    // Solve p - origin = u * xAxis + v * yAxis
+    V2 x = quad->xAxis, y = quad->yAxis;
+    command->dudx = y.y / det;
+    command->dudy = -y.x / det;
+    command->u0 = -(o.x * command->dudx + o.y * command->dudy);
+    command->dvdx = -x.y / det;
+    command->dvdy = x.x / det;
+    command->v0 = -(o.x * command->dvdx + o.y * command->dvdy);
+
+    // Texels are premultiplied already and multiplied by color as is, like in draw_sprite.frag
+    if (quad->kind == SOFTWARE_QUAD_RECT) {
+        command->color = PremultiplyV4(quad->color);
+        command->borderColor = PremultiplyV4(quad->borderColor);
+    } else {
+        command->color = quad->color;
+    }
+}
+
+extern void PushSoftwareTriangles(SoftwareRenderer *sr, const V2 *positions, const uint16_t *indices, int indexCount, V4 color) {
+    if (indexCount < 3 || color.a <= 0.0f) {
+        return;
+    }
+
+    int vertexCount = indexCount / 3 * 3;
+    if (sr->triangleVertexCount + vertexCount > sr->triangleVertexCapacity) {
+        sr->triangleVertexCapacity = MaxInt(sr->triangleVertexCapacity * 2, sr->triangleVertexCount + vertexCount);
+        sr->triangleVertices = realloc(sr->triangleVertices, sizeof(V2) * sr->triangleVertexCapacity);
+    }
+
+    V2 *vertices = sr->triangleVertices + sr->triangleVertexCount;
+    BBox2 bbox = MakeBBox2(positions[indices[0]], positions[indices[0]]);
+    for (int i = 0; i < vertexCount; ++i) {
+        vertices[i] = positions[indices[i]];
+        bbox = ExtendBBox2(bbox, vertices[i]);
+    }
+
+    SoftwareCommand *command = PushSoftwareCommand(sr, SOFTWARE_COMMAND_TRIANGLES);
+    SetSoftwareCommandBBox(sr, command, bbox);
+    command->color = PremultiplyV4(color);
+    command->firstVertex = sr->triangleVertexCount;
+    command->vertexCount = vertexCount;
+
+    sr->triangleVertexCount += vertexCount;
+}
+
+extern void EndSoftwareFrame(SoftwareRenderer *sr) {
+    Tick startTick = GetCurrentTick();
+
+    SDL_AtomicSet(&sr->nextTile, 0);
+    SDL_AtomicSet(&sr->fragmentCount, 0);
+    for (int i = 1; i < sr->threadCount; ++i) {
+        SDL_SemPost(sr->startSem);
+    }
+    RasterizeSoftwareTiles(sr);
+    for (int i = 1; i < sr->threadCount; ++i) {
+        SDL_SemWait(sr->doneSem);
+    }
+
+    for (int i = 0; i < sr->pendingTextureCount; ++i) {
+        free(sr->pendingTextures[i]->texels);
+        free(sr->pendingTextures[i]);
+    }
+    sr->pendingTextureCount = 0;
+    sr->commandCount = 0;
+    sr->triangleVertexCount = 0;
+
+    RenderTimings *timings = &sr->timings;
+    timings->gpuMs = TickToSecond(GetCurrentTick() - startTick) * 1000.0f;
+    timings->fragmentCount = (uint64_t) SDL_AtomicGet(&sr->fragmentCount);
+    timings->passCount = 0;
+    timings->frameIndex++;
+}
+
+extern const unsigned char *GetSoftwareRendererPixels(SoftwareRenderer *sr) {
+    return sr->pixels;
+}
+
+extern const RenderTimings *GetSoftwareRendererTimings(SoftwareRenderer *sr) {
+    return &sr->timings;
+}
@@ -0,0 +1,69 @@
+#ifndef RTD_SOFTWARE_RENDERER_H
+#define RTD_SOFTWARE_RENDERER_H
+
+#include <stdint.h>
+
+#include "cgmath.h"
+#include "image.h"
+#include "renderer.h"
+
+// CPU rasterizer used by renderer.c for contexts created by CreateSoftwareRenderContext. Draws are queued and
+// rasterized by EndSoftwareFrame, tile by tile on a pool of threads, into a linear float framebuffer.
+
+typedef enum SoftwareQuadKind {
+    SOFTWARE_QUAD_TEXTURE,
+    SOFTWARE_QUAD_RECT,
+} SoftwareQuadKind;
+
+// Texels are linear color with premultiplied alpha, bottom row first like textures uploaded to GL. Alpha only
+// textures are stored as white with that alpha, so glyphs sample like any other texture.
+typedef struct SoftwareTexture {
+    int width;
+    int height;
+    // RGBA
+    F *texels;
+} SoftwareTexture;
+
+// Parallelogram covering origin + u * xAxis + v * yAxis for u, v in [0, 1), in pixels from the bottom left
+typedef struct SoftwareQuad {
+    SoftwareQuadKind kind;
+    V2 origin;
+    V2 xAxis;
+    V2 yAxis;
+    const SoftwareTexture *texture;
+    // Normalized texture coordinates at u, v = 0 and u, v = 1
+    BBox2 texBBox;
+    V4 color;
+    // SOFTWARE_QUAD_RECT only, normalized to the quad like the DrawSprite program
+    V2 roundRadius;
+    V2 thickness;
+    V4 borderColor;
+} SoftwareQuad;
+
+typedef struct SoftwareRenderer SoftwareRenderer;
+
+// threadCount includes the calling thread, 0 for one per CPU
+extern SoftwareRenderer *CreateSoftwareRenderer(int width, int height, int threadCount);
+extern void DestroySoftwareRenderer(SoftwareRenderer *sr);
+
+extern SoftwareTexture *CreateSoftwareTexture(const unsigned char *data, int width, int height, int stride, ImageChannel channel);
+// Replace width x height texels whose bottom left is x0, y0 with data, laid out like for CreateSoftwareTexture.
+// Queued draws sample the new texels, so only texels they don't use should be replaced.
+extern void UpdateSoftwareTexture(SoftwareTexture *texture, int x0, int y0, const unsigned char *data, int width,
+                                  int height, int stride, ImageChannel channel);
+// Queued draws may still sample the texture, so it is freed after the next EndSoftwareFrame
+extern void DestroySoftwareTexture(SoftwareRenderer *sr, SoftwareTexture *texture);
+
+// Drop queued draws, the next frame starts from transparent black
+extern void BeginSoftwareFrame(SoftwareRenderer *sr);
+extern void PushSoftwareQuad(SoftwareRenderer *sr, const SoftwareQuad *quad);
+// Solid triangles, positions are in pixels
+extern void PushSoftwareTriangles(SoftwareRenderer *sr, const V2 *positions, const uint16_t *indices, int indexCount, V4 color);
+extern void EndSoftwareFrame(SoftwareRenderer *sr);
+
+// sRGB RGBA of the last frame, top row first, width * 4 bytes per row
+extern const unsigned char *GetSoftwareRendererPixels(SoftwareRenderer *sr);
+// gpuMs is the time EndSoftwareFrame took to rasterize
+extern const RenderTimings *GetSoftwareRendererTimings(SoftwareRenderer *sr);
+
+#endif // RTD_SOFTWARE_RENDERER_H
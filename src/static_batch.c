@@ -0,0 +1,149 @@
+#include "static_batch.h"
+
+#include <string.h>
+
+#include "parallax.h"
+#include "particle.h"
+#include "tilemap.h"
+
+static int IsStaticSpriteNode(GameNode *node) {
+    SpriteComponent *sprite = GetGameNodeComponent(node, SpriteComponent);
+    return node->isStatic && sprite && sprite->material == NULL;
+}
+
+// Nodes drawing anything else end the batch before them
+static int IsDrawingNode(GameNode *node) {
+    return GetGameNodeComponent(node, SpriteComponent) || GetGameNodeComponent(node, TilemapComponent) ||
+           GetGameNodeComponent(node, ParticleEmitterComponent) || GetGameNodeComponent(node, ParallaxLayerComponent);
+}
+
+static void ClearStaticBatches(RenderContext *rc, StaticBatches *batches) {
+    for (int i = 0; i < batches->batchCount; ++i) {
+        StaticSpriteBatch *batch = &batches->batches[i];
+        DestroyStaticMesh(rc, &batch->mesh);
+        if (batch->texture) {
+            DestroyTexture(rc, &batch->texture);
+        }
+    }
+    batches->batchCount = 0;
+    batches->nodeCount = 0;
+}
+
+static StaticSpriteBatch *AddStaticSpriteBatch(RenderContext *rc, StaticBatches *batches, GameNode *node) {
+    if (batches->batchCount == batches->batchCapacity) {
+        batches->batchCapacity = batches->batchCapacity ? batches->batchCapacity * 2 : 8;
+        batches->batches = realloc(batches->batches, sizeof(StaticSpriteBatch) * batches->batchCapacity);
+    }
+
+    StaticSpriteBatch *batch = &batches->batches[batches->batchCount++];
+    batch->firstNode = node;
+    batch->nodeCount = 0;
+    batch->texture = LoadTexture(rc, GetGameNodeComponent(node, SpriteComponent)->texturePath);
+    batch->mesh = CreateStaticMesh(rc);
+    return batch;
+}
+
+static void RebuildStaticBatches(RenderContext *rc, StaticBatches *batches, GameNode *root) {
+    ClearStaticBatches(rc, batches);
+
+    int quadCount = 0;
+    int quadCapacity = 0;
+    T2 *transforms = NULL;
+    BBox2 *dstBBoxes = NULL;
+    BBox2 *srcBBoxes = NULL;
+
+    StaticSpriteBatch *batch = NULL;
+    GameNodeTreeWalker walker;
+    for (BeginWalkGameNodeTree(&walker, root); ; WalkToNextGameNode(&walker)) {
+        GameNode *node = HasNextGameNode(&walker) ? walker.node : NULL;
+        SpriteComponent *sprite = node && IsStaticSpriteNode(node) ? GetGameNodeComponent(node, SpriteComponent) : NULL;
+
+        // Upload the batch when the run of static sprites of its texture ends
+        if (batch && (node == NULL || (sprite == NULL && IsDrawingNode(node)) ||
+                      (sprite && strcmp(sprite->texturePath,
+                                        GetGameNodeComponent(batch->firstNode, SpriteComponent)->texturePath) != 0))) {
+            if (batch->texture) {
+                UploadStaticMeshTransformedQuads(rc, batch->mesh, batch->texture, transforms, dstBBoxes, srcBBoxes,
+                                                 quadCount);
+            }
+            batch = NULL;
+            quadCount = 0;
+        }
+
+        if (node == NULL) {
+            break;
+        }
+        if (sprite == NULL) {
+            continue;
+        }
+
+        if (batch == NULL) {
+            batch = AddStaticSpriteBatch(rc, batches, node);
+        }
+        batch->nodeCount++;
+        batches->nodeCount++;
+
+        if (batch->texture == NULL) {
+            continue;
+        }
+
+        if (quadCount == quadCapacity) {
+            quadCapacity = quadCapacity ? quadCapacity * 2 : 64;
+            transforms = realloc(transforms, sizeof(T2) * quadCapacity);
+            dstBBoxes = realloc(dstBBoxes, sizeof(BBox2) * quadCapacity);
+            srcBBoxes = realloc(srcBBoxes, sizeof(BBox2) * quadCapacity);
+        }
+        transforms[quadCount] = GetGameNodeWorldTransform(node);
+        GetSpriteQuad(sprite, batch->texture, &transforms[quadCount], &dstBBoxes[quadCount], &srcBBoxes[quadCount]);
+        quadCount++;
+    }
+
+    free(transforms);
+    free(dstBBoxes);
+    free(srcBBoxes);
+
+    batches->rebuildCount++;
+}
+
+extern StaticBatches *CreateStaticBatches(void) {
+    StaticBatches *batches = malloc(sizeof(StaticBatches));
+    memset(batches, 0, sizeof(StaticBatches));
+    return batches;
+}
+
+extern void DestroyStaticBatches(RenderContext *rc, StaticBatches **ptr) {
+    StaticBatches *batches = *ptr;
+
+    ClearStaticBatches(rc, batches);
+    free(batches->batches);
+    free(batches);
+
+    *ptr = NULL;
+}
+
+extern void UpdateStaticBatches(RenderContext *rc, StaticBatches *batches, GameNode *root) {
+    if (batches->rebuildCount > 0 && root == batches->root && root->revision == batches->revision) {
+        return;
+    }
+
+    RebuildStaticBatches(rc, batches, root);
+    batches->root = root;
+    batches->revision = root->revision;
+}
+
+extern int RenderStaticBatchOfNode(RenderContext *rc, StaticBatches *batches, GameNode *node) {
+    if (!IsStaticSpriteNode(node)) {
+        return 0;
+    }
+
+    for (int i = 0; i < batches->batchCount; ++i) {
+        StaticSpriteBatch *batch = &batches->batches[i];
+        if (batch->firstNode == node) {
+            // Vertices are in world space already
+            DrawStaticMesh(rc, IdentityT2(), batch->mesh, batch->texture);
+            break;
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,44 @@
+#ifndef RTD_STATIC_BATCH_H
+#define RTD_STATIC_BATCH_H
+
+#include <stdint.h>
+
+#include "game_node.h"
+#include "renderer.h"
+
+// Sprites of static nodes drawn one after the other with the same texture, merged into one mesh in world space
+typedef struct StaticSpriteBatch {
+    // The batch is drawn in place of its first node, which keeps the drawing order with the other nodes
+    GameNode *firstNode;
+    int nodeCount;
+    // NULL if the texture failed to load
+    Texture *texture;
+    StaticMesh *mesh;
+} StaticSpriteBatch;
+
+// Sprites of the nodes marked isStatic, kept on GPU so they are neither loaded, transformed nor uploaded every frame.
+// Each batch is drawn with one draw call. Sprites with a material are not batched.
+//
+// The batches are rebuilt when the revision of the root changes, that is when a node is added to the tree or marked
+// changed with MarkGameNodeChanged. The tree is not walked otherwise.
+typedef struct StaticBatches {
+    int batchCount;
+    int batchCapacity;
+    StaticSpriteBatch *batches;
+    // The tree the batches were built from and its revision
+    GameNode *root;
+    uint32_t revision;
+    int nodeCount;
+    int rebuildCount;
+} StaticBatches;
+
+extern StaticBatches *CreateStaticBatches(void);
+extern void DestroyStaticBatches(RenderContext *rc, StaticBatches **batches);
+// Rebuild the batches if the tree under root changed since the last update. Must be called every frame
+// before the nodes are rendered.
+extern void UpdateStaticBatches(RenderContext *rc, StaticBatches *batches, GameNode *root);
+// Return 1 if the sprite of node is in a batch, drawing the batch if node is its first node. Otherwise the sprite
+// has to be drawn by the caller.
+extern int RenderStaticBatchOfNode(RenderContext *rc, StaticBatches *batches, GameNode *node);
+
+#endif // RTD_STATIC_BATCH_H
@@ -0,0 +1,131 @@
+#include "tilemap.h"
+
+#include <assert.h>
+#include <string.h>
+
+extern TilemapComponent *CreateTilemapComponent(const char *tilesetPath, V2 tileSize, int width, int height) {
+    assert(width > 0 && height > 0);
+
+    TilemapComponent *tilemap = malloc(sizeof(TilemapComponent));
+    tilemap->tilesetPath = tilesetPath;
+    tilemap->tileSize = tileSize;
+    tilemap->width = width;
+    tilemap->height = height;
+    tilemap->tiles = calloc((size_t) width * height, sizeof(TileIndex));
+
+    tilemap->chunkColumns = (width + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    tilemap->chunkRows = (height + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    tilemap->chunks = calloc((size_t) tilemap->chunkColumns * tilemap->chunkRows, sizeof(TilemapChunk));
+
+    tilemap->revision = 0;
+    tilemap->tileset = NULL;
+
+    return tilemap;
+}
+
+extern void DestroyTilemapComponent(RenderContext *rc, TilemapComponent **ptr) {
+    TilemapComponent *tilemap = *ptr;
+
+    for (int i = 0; i < tilemap->chunkColumns * tilemap->chunkRows; ++i) {
+        if (tilemap->chunks[i].mesh) {
+            DestroyStaticMesh(rc, &tilemap->chunks[i].mesh);
+        }
+    }
+
+    if (tilemap->tileset) {
+        DestroyTexture(rc, &tilemap->tileset);
+    }
+
+    free(tilemap->chunks);
+    free(tilemap->tiles);
+    free(tilemap);
+
+    *ptr = NULL;
+}
+
+extern void SetTilemapTile(TilemapComponent *tilemap, int x, int y, TileIndex tile) {
+    assert(x >= 0 && x < tilemap->width && y >= 0 && y < tilemap->height);
+
+    TileIndex *dst = &tilemap->tiles[y * tilemap->width + x];
+    if (*dst == tile) {
+        return;
+    }
+    *dst = tile;
+    tilemap->revision++;
+
+    tilemap->chunks[(y / TILEMAP_CHUNK_SIZE) * tilemap->chunkColumns + x / TILEMAP_CHUNK_SIZE].dirty = 1;
+}
+
+static void BuildTilemapChunk(RenderContext *rc, TilemapComponent *tilemap, int chunkX, int chunkY) {
+    TilemapChunk *chunk = &tilemap->chunks[chunkY * tilemap->chunkColumns + chunkX];
+    Texture *tileset = tilemap->tileset;
+
+    int tilesetColumns = (int) (tileset->width / tilemap->tileSize.x);
+    int tilesetRows = (int) (tileset->height / tilemap->tileSize.y);
+
+    BBox2 dstBBoxes[TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE];
+    BBox2 srcBBoxes[TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE];
+    int count = 0;
+
+    int minX = chunkX * TILEMAP_CHUNK_SIZE;
+    int minY = chunkY * TILEMAP_CHUNK_SIZE;
+    int maxX = minX + TILEMAP_CHUNK_SIZE < tilemap->width ? minX + TILEMAP_CHUNK_SIZE : tilemap->width;
+    int maxY = minY + TILEMAP_CHUNK_SIZE < tilemap->height ? minY + TILEMAP_CHUNK_SIZE : tilemap->height;
+
+    for (int y = minY; y < maxY; ++y) {
+        for (int x = minX; x < maxX; ++x) {
+            TileIndex tile = tilemap->tiles[y * tilemap->width + x];
+            if (tile == 0 || tile > tilesetColumns * tilesetRows) {
+                continue;
+            }
+
+            int column = (tile - 1) % tilesetColumns;
+            int row = (tile - 1) / tilesetColumns;
+
+            // Tileset rows count from top while texture space counts from bottom
+            V2 srcMin = MakeV2(column * tilemap->tileSize.x, tileset->height - (row + 1) * tilemap->tileSize.y);
+            V2 dstMin = MakeV2(x * tilemap->tileSize.x, y * tilemap->tileSize.y);
+
+            srcBBoxes[count] = MakeBBox2MinSize(srcMin, tilemap->tileSize);
+            dstBBoxes[count] = MakeBBox2MinSize(dstMin, tilemap->tileSize);
+            ++count;
+        }
+    }
+
+    if (chunk->mesh == NULL) {
+        chunk->mesh = CreateStaticMesh(rc);
+    }
+
+    UploadStaticMeshQuads(rc, chunk->mesh, tileset, dstBBoxes, srcBBoxes, count);
+
+    chunk->dirty = 0;
+}
+
+extern void RenderTilemap(RenderContext *rc, T2 transform, TilemapComponent *tilemap) {
+    if (tilemap->tileset == NULL) {
+        tilemap->tileset = LoadTexture(rc, tilemap->tilesetPath);
+        if (tilemap->tileset == NULL) {
+            return;
+        }
+    }
+
+    // Cull chunks against the viewport in the tilemap local space
+    BBox2 view = GetViewBBox2(rc, transform);
+    V2 chunkSize = MulV2(TILEMAP_CHUNK_SIZE, tilemap->tileSize);
+
+    int minChunkX = (int) ClampF(FloorF(view.min.x / chunkSize.x), 0.0f, (F) tilemap->chunkColumns);
+    int minChunkY = (int) ClampF(FloorF(view.min.y / chunkSize.y), 0.0f, (F) tilemap->chunkRows);
+    int maxChunkX = (int) ClampF(CeilF(view.max.x / chunkSize.x), 0.0f, (F) tilemap->chunkColumns);
+    int maxChunkY = (int) ClampF(CeilF(view.max.y / chunkSize.y), 0.0f, (F) tilemap->chunkRows);
+
+    for (int chunkY = minChunkY; chunkY < maxChunkY; ++chunkY) {
+        for (int chunkX = minChunkX; chunkX < maxChunkX; ++chunkX) {
+            TilemapChunk *chunk = &tilemap->chunks[chunkY * tilemap->chunkColumns + chunkX];
+            if (chunk->mesh == NULL || chunk->dirty) {
+                BuildTilemapChunk(rc, tilemap, chunkX, chunkY);
+            }
+
+            DrawStaticMesh(rc, transform, chunk->mesh, tilemap->tileset);
+        }
+    }
+}
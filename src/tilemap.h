@@ -0,0 +1,52 @@
+#ifndef RTD_TILEMAP_H
+#define RTD_TILEMAP_H
+
+#include <stdint.h>
+
+#include "cgmath.h"
+#include "renderer.h"
+
+// Width and height of a chunk in tiles
+#define TILEMAP_CHUNK_SIZE 32
+
+// Index into the tileset, counting from the top left tile in row-major order. 0 means empty tile.
+typedef uint16_t TileIndex;
+
+typedef struct TilemapChunk {
+    StaticMesh *mesh;
+    int dirty;
+} TilemapChunk;
+
+typedef struct TilemapComponent {
+    const char *tilesetPath;
+    // Tile size in pixels of the tileset, which is also the tile size in points of the map
+    V2 tileSize;
+    // Map size in tiles
+    int width;
+    int height;
+    TileIndex *tiles;
+
+    int chunkColumns;
+    int chunkRows;
+    TilemapChunk *chunks;
+    // Incremented by every tile change, so a change is seen without comparing the tiles
+    uint32_t revision;
+
+    Texture *tileset;
+} TilemapComponent;
+
+extern TilemapComponent *CreateTilemapComponent(const char *tilesetPath, V2 tileSize, int width, int height);
+extern void DestroyTilemapComponent(RenderContext *rc, TilemapComponent **tilemap);
+extern void SetTilemapTile(TilemapComponent *tilemap, int x, int y, TileIndex tile);
+// Render visible chunks, rebuilding the vertex data of the chunks whose tiles were changed
+extern void RenderTilemap(RenderContext *rc, T2 transform, TilemapComponent *tilemap);
+
+static inline TileIndex GetTilemapTile(TilemapComponent *tilemap, int x, int y) {
+    if (x < 0 || x >= tilemap->width || y < 0 || y >= tilemap->height) {
+        return 0;
+    }
+
+    return tilemap->tiles[y * tilemap->width + x];
+}
+
+#endif // RTD_TILEMAP_H
@@ -10,6 +10,10 @@ extern float TickToSecond(Tick tick) {
     return tick * 1.0f / SDL_GetPerformanceFrequency();
 }
 
+extern Tick SecondToTick(float second) {
+    return (Tick) ((double) second * SDL_GetPerformanceFrequency());
+}
+
 extern void InitFPSCounter(FPSCounter *fpsCounter) {
     fpsCounter->lastTick = GetCurrentTick();
     fpsCounter->duration = 0.0f;
@@ -7,6 +7,7 @@ typedef uint64_t Tick;
 
 extern Tick GetCurrentTick(void);
 extern float TickToSecond(Tick tick);
+extern Tick SecondToTick(float second);
 
 typedef struct FPSCounter {
     Tick lastTick;
@@ -1,5 +1,118 @@
+// Embed a shader source as a hex array, to be included in a char array initializer.
+//
+// Lines of the form `#include "file"` are replaced by the content of file, relative to the file including it.
+//
+// A line of the form `#pragma variants NAME...` makes a variant matrix of up to MAX_VARIANT_DEFINES names. The output
+// then holds one source per combination, one after the other, each ending with 0x00. Variant i has `#define NAME`
+// in place of the pragma line for every NAME whose bit is set in i, the first NAME being bit 0.
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#define MAX_INCLUDE_DEPTH 16
+#define MAX_VARIANT_DEFINES 8
+#define MAX_NAME_SIZE 64
+
+typedef struct Buffer {
+    char *data;
+    size_t size;
+    size_t capacity;
+} Buffer;
+
+static void Append(Buffer *buffer, const char *data, size_t size) {
+    if (buffer->size + size > buffer->capacity) {
+        buffer->capacity = (buffer->size + size) * 2;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+static const char *SkipSpaces(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+// Return the length of the directive if the line starting at p is it, 0 otherwise
+static size_t MatchDirective(const char *p, const char *end, const char *directive) {
+    p = SkipSpaces(p, end);
+    size_t length = strlen(directive);
+    if ((size_t) (end - p) > length && memcmp(p, directive, length) == 0 && (p[length] == ' ' || p[length] == '\t')) {
+        return length;
+    }
+    return 0;
+}
+
+static void ExpandFile(Buffer *output, const char *path, int depth) {
+    if (depth > MAX_INCLUDE_DEPTH) {
+        fprintf(stderr, "%s: includes nested too deep\n", path);
+        exit(1);
+    }
+
+    FILE *fin = fopen(path, "rb");
+    if (fin == NULL) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        exit(1);
+    }
+
+    Buffer input = {0};
+#define READ_BUF_SIZE 4096
+    char read_buf[READ_BUF_SIZE];
+    while (!feof(fin)) {
+        size_t nread = fread(read_buf, 1, READ_BUF_SIZE, fin);
+        Append(&input, read_buf, nread);
+    }
+    fclose(fin);
+
+    const char *end = input.data + input.size;
+    const char *line = input.data;
+    while (line < end) {
+        const char *lineEnd = memchr(line, '\n', (size_t) (end - line));
+        lineEnd = lineEnd ? lineEnd + 1 : end;
+
+        size_t length = MatchDirective(line, lineEnd, "#include");
+        if (length) {
+            const char *name = strchr(SkipSpaces(line, lineEnd) + length, '"');
+            const char *nameEnd = name && name < lineEnd ? memchr(name + 1, '"', (size_t) (lineEnd - name - 1)) : NULL;
+            if (nameEnd == NULL) {
+                fprintf(stderr, "%s: malformed #include\n", path);
+                exit(1);
+            }
+
+            // Relative to the directory of path
+            const char *slash = strrchr(path, '/');
+            size_t dirLength = slash ? (size_t) (slash - path + 1) : 0;
+            size_t nameLength = (size_t) (nameEnd - name - 1);
+            char *includePath = malloc(dirLength + nameLength + 1);
+            memcpy(includePath, path, dirLength);
+            memcpy(includePath + dirLength, name + 1, nameLength);
+            includePath[dirLength + nameLength] = 0;
+
+            ExpandFile(output, includePath, depth + 1);
+            if (output->size > 0 && output->data[output->size - 1] != '\n') {
+                Append(output, "\n", 1);
+            }
+            free(includePath);
+        } else {
+            Append(output, line, (size_t) (lineEnd - line));
+        }
+
+        line = lineEnd;
+    }
+
+    free(input.data);
+}
+
+static void WriteHex(FILE *fout, const char *data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        fprintf(fout, "0x%02X, ", (unsigned char) data[i]);
+        if (i % 13 == 12) {
+            fprintf(fout, "\n");
+        }
+    }
+}
 
 int main(int argc, const char **argv) {
     if (argc != 3) {
@@ -9,27 +122,84 @@ int main(int argc, const char **argv) {
     const char *output = argv[1];
     const char *input = argv[2];
 
-    FILE *fin = fopen(input, "rb");
-    FILE *fout = fopen(output, "wb");
+    Buffer source = {0};
+    ExpandFile(&source, input, 0);
 
-#define READ_BUF_SIZE 4096
-    char read_buf[READ_BUF_SIZE];
-    while (!feof(fin)) {
-        size_t nread = fread(read_buf, 1, READ_BUF_SIZE, fin);
+    // Find the variant matrix
+    const char *end = source.data + source.size;
+    const char *pragma = NULL;
+    const char *pragmaEnd = NULL;
+    int defineCount = 0;
+    char defines[MAX_VARIANT_DEFINES][MAX_NAME_SIZE];
+    for (const char *line = source.data; line < end && pragma == NULL;) {
+        const char *lineEnd = memchr(line, '\n', (size_t) (end - line));
+        lineEnd = lineEnd ? lineEnd + 1 : end;
 
-        for (size_t i = 0; i < nread; ++i) {
-            char c = read_buf[i];
-            fprintf(fout, "0x%02X, ", c);
-            if (i % 13 == 12) {
-                fprintf(fout, "\n");
+        size_t length = MatchDirective(line, lineEnd, "#pragma");
+        const char *p = length ? SkipSpaces(SkipSpaces(line, lineEnd) + length, lineEnd) : NULL;
+        if (p && (size_t) (lineEnd - p) > 8 && memcmp(p, "variants", 8) == 0 && (p[8] == ' ' || p[8] == '\t')) {
+            pragma = line;
+            pragmaEnd = lineEnd;
+            p += 8;
+            for (;;) {
+                p = SkipSpaces(p, lineEnd);
+                const char *nameEnd = p;
+                while (nameEnd < lineEnd && *nameEnd != ' ' && *nameEnd != '\t' && *nameEnd != '\r' &&
+                       *nameEnd != '\n') {
+                    nameEnd++;
+                }
+                if (nameEnd == p) {
+                    break;
+                }
+                if (defineCount == MAX_VARIANT_DEFINES || nameEnd - p >= MAX_NAME_SIZE) {
+                    fprintf(stderr, "%s: too many or too long variant names\n", input);
+                    exit(1);
+                }
+                memcpy(defines[defineCount], p, (size_t) (nameEnd - p));
+                defines[defineCount][nameEnd - p] = 0;
+                defineCount++;
+                p = nameEnd;
             }
         }
+
+        line = lineEnd;
     }
 
-    fprintf(fout, "0x00");
+    FILE *fout = fopen(output, "wb");
+    if (fout == NULL) {
+        fprintf(stderr, "Failed to open %s\n", output);
+        exit(1);
+    }
+
+    if (pragma == NULL) {
+        WriteHex(fout, source.data, source.size);
+        fprintf(fout, "0x00");
+    } else {
+        int variantCount = 1 << defineCount;
+        for (int variant = 0; variant < variantCount; ++variant) {
+            fprintf(fout, "/* variant %d", variant);
+            for (int i = 0; i < defineCount; ++i) {
+                if (variant & (1 << i)) {
+                    fprintf(fout, " %s", defines[i]);
+                }
+            }
+            fprintf(fout, " */\n");
+
+            WriteHex(fout, source.data, (size_t) (pragma - source.data));
+            for (int i = 0; i < defineCount; ++i) {
+                if (variant & (1 << i)) {
+                    char define[MAX_NAME_SIZE + 16];
+                    int length = snprintf(define, sizeof(define), "#define %s\n", defines[i]);
+                    WriteHex(fout, define, (size_t) length);
+                }
+            }
+            WriteHex(fout, pragmaEnd, (size_t) (end - pragmaEnd));
+            fprintf(fout, variant + 1 < variantCount ? "0x00,\n" : "0x00");
+        }
+    }
 
-    fclose(fin);
     fclose(fout);
+    free(source.data);
 
     return 0;
-}
\ No newline at end of file
+}